@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+    // keeps the optimizer from discarding results whose only purpose is to be measured
+    template<typename T>
+    inline auto doNotOptimize(const T &value) -> void {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T *sink;
+        sink = &value;
+#endif
+    }
+
+    // runs fn(iterations) once and returns nanoseconds per iteration
+    template<typename F>
+    auto measure(std::uint64_t iterations, F &&fn) -> double {
+        auto begin = std::chrono::steady_clock::now();
+        fn(iterations);
+        auto end = std::chrono::steady_clock::now();
+        return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double) iterations;
+    }
+
+    inline auto fixed(double value, int precision = 2) -> std::string {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(precision) << value;
+        return os.str();
+    }
+
+    inline auto report(std::string_view name, double nsPerOp, std::string_view extra = {}) -> void {
+        std::cout << std::left << std::setw(36) << name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(2) << nsPerOp << " ns/op";
+        if (!extra.empty()) std::cout << "  " << extra;
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,102 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/render/commandQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Frame of 200k draws across 4 programs x 8 texture sets x 4 meshes, recorded in scene order from
+// 1..N threads, then sorted and submitted. Reports per-command cost of each phase and the draw calls left.
+auto main() -> int {
+    bench::glStub::install();
+    bench::glStub::declareUniforms({{"view",       GL_FLOAT_MAT4},
+                                    {"projection", GL_FLOAT_MAT4}});
+
+    const char *vPath = STATIC_FILE_PATH"/static/shader/instancedVertexShader.vert";
+    const char *fPath = STATIC_FILE_PATH"/static/shader/fragmentShader.frag";
+    std::array<shader::ShaderProgram, 4> programs;
+    for (auto &program: programs) {
+        program.add(shader::Shader{vPath, GL_VERTEX_SHADER}).add(shader::Shader{fPath, GL_FRAGMENT_SHADER}).load();
+    }
+    std::array<texture::texture2DLoader, 8> textureSets;
+
+    render::CommandQueue queue;
+    std::vector<render::materialHandle> materials;
+    for (auto &program: programs) {
+        for (auto &textures: textureSets) materials.push_back(queue.addMaterial({&program, &textures}));
+    }
+    std::vector<render::meshHandle> meshes;
+    for (unsigned int vao = 1; vao <= 4; vao++) meshes.push_back(queue.addMesh(render::mesh{vao, 36}));
+
+    constexpr std::size_t commands = 200'000;
+    struct object {
+        render::materialHandle material;
+        render::meshHandle mesh;
+        glm::mat4 model;
+        float depth;
+    };
+    std::vector<object> scene(commands);
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-100, 100};
+    for (auto &entry: scene) {
+        glm::vec3 at{position(random), position(random), position(random)};
+        entry = {materials[random() % materials.size()], meshes[random() % meshes.size()],
+                 glm::translate(glm::mat4{1}, at), glm::length(at)};
+    }
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    constexpr int frames = 10;
+    for (auto threads: threadCounts) {
+        double recordNs = 0, sortNs = 0, submitNs = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            queue.beginFrame();
+            recordNs += bench::measure(commands, [&](std::uint64_t) {
+                std::vector<std::thread> workers;
+                for (unsigned int t = 0; t < threads; t++) {
+                    workers.emplace_back([&, t] {
+                        auto &recorder = queue.recorder();
+                        for (std::size_t i = commands * t / threads; i < commands * (t + 1) / threads; i++) {
+                            recorder.draw(scene[i].material, scene[i].mesh, scene[i].depth, scene[i].model);
+                        }
+                    });
+                }
+                for (auto &worker: workers) worker.join();
+            });
+            sortNs += bench::measure(commands, [&](std::uint64_t) { queue.sort(); });
+            bench::glStub::reset();
+            submitNs += bench::measure(commands, [&](std::uint64_t) { queue.submit(); });
+        }
+        std::cout << std::endl << threads << " recording thread(s)" << std::endl;
+        bench::report("record", recordNs / frames, "per command, includes thread start");
+        bench::report("merge + radix sort", sortNs / frames, "per command");
+        bench::report("submit", submitNs / frames,
+                      std::to_string(queue.drawCalls()) + " draws, " + std::to_string(bench::glStub::totalCalls()) +
+                      " gl calls for " + std::to_string(commands) + " commands");
+    }
+
+    std::vector<std::uint64_t> keys(commands);
+    for (std::size_t i = 0; i < commands; i++) {
+        keys[i] = render::sortKey::make(scene[i].material.program, scene[i].material.textures, scene[i].mesh,
+                                        scene[i].depth);
+    }
+    auto stdSortNs = bench::measure(commands, [&](std::uint64_t) {
+        auto copy = keys;
+        std::sort(copy.begin(), copy.end());
+        bench::doNotOptimize(copy.front());
+    });
+    std::cout << std::endl;
+    bench::report("reference: std::sort of the keys", stdSortNs, "per command");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchCommon.hpp"
+#include "../src/scene/bvh.hpp"
+#include "../src/transform/transformSoA.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Frustum culling of 1M boxes spread through a 1000^3 world: a linear test of every box against the BVH
+// at each kernel and worker count, plus the refit after 10% of the objects moved.
+auto main() -> int {
+    constexpr std::size_t count = 1'000'000;
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-500.0f, 500.0f}, size{0.25f, 1.5f};
+
+    scene::BVH bvh;
+    std::vector<scene::aabb> boxes(count);
+    for (auto &box: boxes) {
+        glm::vec3 center{position(random), position(random), position(random)};
+        box = scene::aabb::around(center, size(random));
+        bvh.add(box);
+    }
+    auto buildNs = bench::measure(count, [&](std::uint64_t) { bvh.build(); });
+    bench::report("build", buildNs, "per object");
+
+    auto viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 400.0f) *
+                          glm::lookAt(glm::vec3{0, 0, 0}, glm::vec3{1, 0.2f, 0.5f}, glm::vec3{0, 1, 0});
+    auto view = scene::frustum::fromMatrix(viewProjection);
+
+    std::vector<std::uint32_t> visible;
+    auto linearNs = bench::measure(count, [&](std::uint64_t) {
+        visible.clear();
+        for (std::uint32_t i = 0; i < count; i++) {
+            bool in = true;
+            for (const auto &plane: view.planes) {
+                glm::vec3 far{plane.x >= 0 ? boxes[i].max.x : boxes[i].min.x,
+                              plane.y >= 0 ? boxes[i].max.y : boxes[i].min.y,
+                              plane.z >= 0 ? boxes[i].max.z : boxes[i].min.z};
+                in = in && glm::dot(glm::vec3{plane}, far) + plane.w >= 0;
+            }
+            if (in) visible.push_back(i);
+        }
+    });
+    auto expected = visible.size();
+    bench::report("linear scalar test", linearNs, "per object, " + std::to_string(expected) + " visible");
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    constexpr int repeat = 20;
+    for (auto k: {transform::kernel::scalar, transform::kernel::sse, transform::kernel::avx2}) {
+        if (transform::setKernel(k) != k) continue;
+        for (auto threads: threadCounts) {
+            auto ns = bench::measure(repeat * count, [&](std::uint64_t) {
+                for (int r = 0; r < repeat; r++) {
+                    visible.clear();
+                    bvh.cull(view, visible, threads);
+                }
+            });
+            auto name = std::string{"bvh "} + transform::kernelName(k) + ", " + std::to_string(threads) + " thread(s)";
+            bench::report(name, ns, "per object, " + bench::fixed(1e3 / ns, 1) + " M objects/s, speedup " +
+                                    bench::fixed(linearNs / ns) + "x" +
+                                    (visible.size() == expected ? "" : ", MISMATCH"));
+        }
+    }
+
+    std::vector<std::uint32_t> moved;
+    for (std::uint32_t i = 0; i < count; i += 10) moved.push_back(i);
+    auto refitNs = bench::measure(moved.size(), [&](std::uint64_t) {
+        for (auto i: moved) {
+            boxes[i].min += glm::vec3{0.5f};
+            boxes[i].max += glm::vec3{0.5f};
+            bvh.update(i, boxes[i]);
+        }
+        bvh.refit();
+    });
+    bench::report("update + refit, 10% moved", refitNs, "per moved object");
+    return 0;
+}
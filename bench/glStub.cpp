@@ -0,0 +1,423 @@
+#include "glStub.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace bench::glStub {
+
+    namespace {
+        std::array<std::uint64_t, (std::size_t) call::count> counters{};
+        std::vector<uniformDecl> declared;
+        GLuint nextName = 1;
+        // uploads are copied here so the stub costs at least what a driver-side copy would
+        unsigned char sink[256];
+        // backing store for buffer objects so mapped pointers are real memory
+        std::unordered_map<GLuint, std::vector<unsigned char>> buffers;
+        std::unordered_map<GLenum, GLuint> boundBuffers;
+
+        auto record(call entry) -> void {
+            counters[(std::size_t) entry]++;
+        }
+
+        auto APIENTRY createShader(GLenum) -> GLuint {
+            record(call::createShader);
+            return nextName++;
+        }
+
+        auto APIENTRY shaderSource(GLuint, GLsizei, const GLchar *const *, const GLint *) -> void {}
+
+        auto APIENTRY compileShader(GLuint) -> void {
+            record(call::compileShader);
+        }
+
+        auto APIENTRY getShaderiv(GLuint, GLenum, GLint *params) -> void {
+            *params = GL_TRUE;
+        }
+
+        auto APIENTRY getInfoLog(GLuint, GLsizei bufSize, GLsizei *length, GLchar *log) -> void {
+            if (length) *length = 0;
+            if (bufSize > 0) log[0] = '\0';
+        }
+
+        auto APIENTRY createProgram() -> GLuint {
+            record(call::createProgram);
+            return nextName++;
+        }
+
+        auto APIENTRY attachShader(GLuint, GLuint) -> void {}
+
+        auto APIENTRY linkProgram(GLuint) -> void {
+            record(call::linkProgram);
+        }
+
+        auto APIENTRY getProgramiv(GLuint, GLenum pname, GLint *params) -> void {
+            switch (pname) {
+                case GL_ACTIVE_UNIFORMS:
+                    *params = (GLint) declared.size();
+                    break;
+                case GL_ACTIVE_UNIFORM_MAX_LENGTH: {
+                    std::size_t length = 0;
+                    for (const auto &uniform: declared) length = std::max(length, uniform.name.size() + 4);
+                    *params = (GLint) length;
+                    break;
+                }
+                default:
+                    *params = GL_TRUE;
+            }
+        }
+
+        auto APIENTRY getActiveUniform(GLuint, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size,
+                                       GLenum *type, GLchar *name) -> void {
+            record(call::getActiveUniform);
+            const auto &uniform = declared[index];
+            auto reported = uniform.size > 1 ? uniform.name + "[0]" : uniform.name;
+            auto written = std::min<std::size_t>(reported.size(), bufSize - 1);
+            std::memcpy(name, reported.c_str(), written);
+            name[written] = '\0';
+            if (length) *length = (GLsizei) written;
+            *size = uniform.size;
+            *type = uniform.type;
+        }
+
+        auto APIENTRY getUniformLocation(GLuint, const GLchar *name) -> GLint {
+            record(call::getUniformLocation);
+            auto length = std::strlen(name);
+            if (length > 3 && std::strcmp(name + length - 3, "[0]") == 0) length -= 3;
+            for (std::size_t i = 0; i < declared.size(); i++) {
+                if (declared[i].name.size() == length && std::memcmp(declared[i].name.data(), name, length) == 0)
+                    return (GLint) i;
+            }
+            return -1;
+        }
+
+        template<typename T, std::size_t N>
+        auto APIENTRY uniformv(GLint, GLsizei count, const T *value) -> void {
+            record(call::uniform);
+            std::memcpy(sink, value, sizeof(T) * N * count);
+        }
+
+        template<std::size_t N>
+        auto APIENTRY uniformMatrixv(GLint, GLsizei count, GLboolean, const GLfloat *value) -> void {
+            record(call::uniform);
+            std::memcpy(sink, value, sizeof(GLfloat) * N * N * count);
+        }
+
+        auto APIENTRY uniform1f(GLint, GLfloat value) -> void {
+            record(call::uniform);
+            std::memcpy(sink, &value, sizeof(value));
+        }
+
+        auto APIENTRY uniform1i(GLint, GLint value) -> void {
+            record(call::uniform);
+            std::memcpy(sink, &value, sizeof(value));
+        }
+
+        // programs declare no uniform blocks
+        auto APIENTRY getUniformBlockIndex(GLuint, const GLchar *) -> GLuint {
+            return GL_INVALID_INDEX;
+        }
+
+        auto APIENTRY uniformBlockBinding(GLuint, GLuint, GLuint) -> void {}
+
+        auto APIENTRY useProgram(GLuint) -> void {
+            record(call::useProgram);
+        }
+
+        auto APIENTRY bindVertexArray(GLuint) -> void {
+            record(call::bindVertexArray);
+        }
+
+        auto APIENTRY bindBuffer(GLenum target, GLuint buffer) -> void {
+            record(call::bindBuffer);
+            boundBuffers[target] = buffer;
+        }
+
+        auto APIENTRY genBuffers(GLsizei n, GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) names[i] = nextName++;
+        }
+
+        auto APIENTRY deleteBuffers(GLsizei n, const GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) buffers.erase(names[i]);
+        }
+
+        auto APIENTRY bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum) -> void {
+            record(call::bufferData);
+            auto &storage = buffers[boundBuffers[target]];
+            storage.resize(size);
+            if (data) std::memcpy(storage.data(), data, size);
+        }
+
+        auto APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) -> void {
+            record(call::bufferData);
+            std::memcpy(buffers[boundBuffers[target]].data() + offset, data, size);
+        }
+
+        auto APIENTRY mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr, GLbitfield) -> void * {
+            record(call::mapBuffer);
+            return buffers[boundBuffers[target]].data() + offset;
+        }
+
+        auto APIENTRY unmapBuffer(GLenum) -> GLboolean {
+            return GL_TRUE;
+        }
+
+        auto APIENTRY bufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield) -> void {
+            record(call::bufferData);
+            auto &storage = buffers[boundBuffers[target]];
+            storage.resize(size);
+            if (data) std::memcpy(storage.data(), data, size);
+        }
+
+        // the GPU is never behind: every fence is signaled as soon as it is placed
+        auto APIENTRY fenceSync(GLenum, GLbitfield) -> GLsync {
+            record(call::fence);
+            return (GLsync) (std::uintptr_t) nextName++;
+        }
+
+        auto APIENTRY clientWaitSync(GLsync, GLbitfield, GLuint64) -> GLenum {
+            return GL_ALREADY_SIGNALED;
+        }
+
+        auto APIENTRY deleteSync(GLsync) -> void {}
+
+        auto APIENTRY genTextures(GLsizei n, GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) names[i] = nextName++;
+        }
+
+        // client-memory uploads are copied like a driver would, PBO-sourced ones are not
+        std::vector<unsigned char> textureStore;
+
+        auto APIENTRY texImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum,
+                                 const void *pixels) -> void {
+            record(call::texImage);
+            if (!pixels || boundBuffers[GL_PIXEL_UNPACK_BUFFER]) return;
+            std::size_t bytesPerPixel = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_RG ? 2 : 1;
+            textureStore.resize((std::size_t) width * height * bytesPerPixel);
+            std::memcpy(textureStore.data(), pixels, textureStore.size());
+        }
+
+        auto APIENTRY texImage3D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint,
+                                 GLenum format, GLenum, const void *pixels) -> void {
+            record(call::texImage);
+            if (!pixels || boundBuffers[GL_PIXEL_UNPACK_BUFFER]) return;
+            std::size_t bytesPerPixel = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_RG ? 2 : 1;
+            textureStore.resize((std::size_t) width * height * depth * bytesPerPixel);
+            std::memcpy(textureStore.data(), pixels, textureStore.size());
+        }
+
+        auto APIENTRY deleteTextures(GLsizei, const GLuint *) -> void {}
+
+        auto APIENTRY compressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei size,
+                                           const void *data) -> void {
+            record(call::texImage);
+            if (!data || boundBuffers[GL_PIXEL_UNPACK_BUFFER]) return;
+            textureStore.resize(size);
+            std::memcpy(textureStore.data(), data, size);
+        }
+
+        auto APIENTRY texParameteri(GLenum, GLenum, GLint) -> void {}
+
+        auto APIENTRY pixelStorei(GLenum, GLint) -> void {}
+
+        auto APIENTRY generateMipmap(GLenum) -> void {}
+
+        auto APIENTRY activeTexture(GLenum) -> void {
+            record(call::activeTexture);
+        }
+
+        auto APIENTRY bindTexture(GLenum, GLuint) -> void {
+            record(call::bindTexture);
+        }
+
+        auto APIENTRY bindSampler(GLuint, GLuint) -> void {
+            record(call::bindSampler);
+        }
+
+        auto APIENTRY capability(GLenum) -> void {
+            record(call::capability);
+        }
+
+        auto APIENTRY genVertexArrays(GLsizei n, GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) names[i] = nextName++;
+        }
+
+        auto APIENTRY deleteVertexArrays(GLsizei, const GLuint *) -> void {}
+
+        auto APIENTRY drawElementsInstanced(GLenum, GLsizei, GLenum, const void *, GLsizei) -> void {
+            record(call::drawArrays);
+        }
+
+        auto APIENTRY vertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void *) -> void {}
+
+        auto APIENTRY vertexAttrib(GLuint) -> void {}
+
+        auto APIENTRY vertexAttribDivisor(GLuint, GLuint) -> void {}
+
+        auto APIENTRY drawArraysInstanced(GLenum, GLint, GLsizei, GLsizei) -> void {
+            record(call::drawArrays);
+        }
+
+        auto APIENTRY drawArrays(GLenum, GLint, GLsizei) -> void {
+            record(call::drawArrays);
+        }
+
+        auto APIENTRY genQueries(GLsizei n, GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) names[i] = nextName++;
+        }
+
+        auto APIENTRY beginQuery(GLenum, GLuint) -> void {
+            record(call::query);
+        }
+
+        auto APIENTRY endQuery(GLenum) -> void {}
+
+        // every query is complete and took one microsecond
+        auto APIENTRY getQueryObjectiv(GLuint, GLenum, GLint *params) -> void {
+            *params = 1;
+        }
+
+        auto APIENTRY getQueryObjectui64v(GLuint, GLenum pname, GLuint64 *params) -> void {
+            *params = pname == GL_QUERY_RESULT ? 1000 : 1;
+        }
+
+        auto APIENTRY queryCounter(GLuint, GLenum) -> void {
+            record(call::query);
+        }
+
+        auto APIENTRY deleteQueries(GLsizei, const GLuint *) -> void {}
+
+        auto APIENTRY genFramebuffers(GLsizei n, GLuint *names) -> void {
+            for (GLsizei i = 0; i < n; i++) names[i] = nextName++;
+        }
+
+        auto APIENTRY deleteFramebuffers(GLsizei, const GLuint *) -> void {}
+
+        auto APIENTRY bindFramebuffer(GLenum, GLuint) -> void {
+            record(call::bindFramebuffer);
+        }
+
+        auto APIENTRY framebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint) -> void {}
+
+        auto APIENTRY drawBuffers(GLsizei, const GLenum *) -> void {}
+
+        auto APIENTRY colorBuffer(GLenum) -> void {}
+
+        // every attachment combination is supported
+        auto APIENTRY checkFramebufferStatus(GLenum) -> GLenum {
+            return GL_FRAMEBUFFER_COMPLETE;
+        }
+
+        auto APIENTRY viewport(GLint, GLint, GLsizei, GLsizei) -> void {}
+
+        // the extensions the tree checks for, all present
+        constexpr const char *extensions[] = {"GL_EXT_texture_compression_s3tc"};
+
+        auto APIENTRY getIntegerv(GLenum name, GLint *value) -> void {
+            if (name == GL_NUM_EXTENSIONS) *value = (GLint) std::size(extensions);
+        }
+
+        auto APIENTRY getStringi(GLenum name, GLuint index) -> const GLubyte * {
+            if (name != GL_EXTENSIONS || index >= std::size(extensions)) return nullptr;
+            return (const GLubyte *) extensions[index];
+        }
+    }
+
+    auto install() -> void {
+        glad_glCreateShader = createShader;
+        glad_glShaderSource = shaderSource;
+        glad_glCompileShader = compileShader;
+        glad_glGetShaderiv = getShaderiv;
+        glad_glGetShaderInfoLog = getInfoLog;
+        glad_glCreateProgram = createProgram;
+        glad_glAttachShader = attachShader;
+        glad_glLinkProgram = linkProgram;
+        glad_glGetProgramiv = getProgramiv;
+        glad_glGetProgramInfoLog = getInfoLog;
+        glad_glGetActiveUniform = getActiveUniform;
+        glad_glGetUniformLocation = getUniformLocation;
+        glad_glUniform1f = uniform1f;
+        glad_glUniform1i = uniform1i;
+        glad_glUniform2fv = uniformv<GLfloat, 2>;
+        glad_glUniform3fv = uniformv<GLfloat, 3>;
+        glad_glUniform4fv = uniformv<GLfloat, 4>;
+        glad_glUniform2iv = uniformv<GLint, 2>;
+        glad_glUniform3iv = uniformv<GLint, 3>;
+        glad_glUniform4iv = uniformv<GLint, 4>;
+        glad_glUniformMatrix2fv = uniformMatrixv<2>;
+        glad_glUniformMatrix3fv = uniformMatrixv<3>;
+        glad_glUniformMatrix4fv = uniformMatrixv<4>;
+        glad_glGetUniformBlockIndex = getUniformBlockIndex;
+        glad_glUniformBlockBinding = uniformBlockBinding;
+        glad_glUseProgram = useProgram;
+        glad_glBindVertexArray = bindVertexArray;
+        glad_glBindBuffer = bindBuffer;
+        glad_glGenBuffers = genBuffers;
+        glad_glDeleteBuffers = deleteBuffers;
+        glad_glBufferData = bufferData;
+        glad_glBufferSubData = bufferSubData;
+        glad_glMapBufferRange = mapBufferRange;
+        glad_glUnmapBuffer = unmapBuffer;
+        glad_glBufferStorage = bufferStorage;
+        glad_glFenceSync = fenceSync;
+        glad_glClientWaitSync = clientWaitSync;
+        glad_glDeleteSync = deleteSync;
+        glad_glGenTextures = genTextures;
+        glad_glTexImage2D = texImage2D;
+        glad_glTexImage3D = texImage3D;
+        glad_glDeleteTextures = deleteTextures;
+        glad_glCompressedTexImage2D = compressedTexImage2D;
+        glad_glTexParameteri = texParameteri;
+        glad_glPixelStorei = pixelStorei;
+        glad_glGenerateMipmap = generateMipmap;
+        glad_glActiveTexture = activeTexture;
+        glad_glBindTexture = bindTexture;
+        glad_glDrawArrays = drawArrays;
+        glad_glDrawArraysInstanced = drawArraysInstanced;
+        glad_glBindSampler = bindSampler;
+        glad_glEnable = capability;
+        glad_glDisable = capability;
+        glad_glGenVertexArrays = genVertexArrays;
+        glad_glDeleteVertexArrays = deleteVertexArrays;
+        glad_glDrawElementsInstanced = drawElementsInstanced;
+        glad_glVertexAttribPointer = vertexAttribPointer;
+        glad_glEnableVertexAttribArray = vertexAttrib;
+        glad_glVertexAttribDivisor = vertexAttribDivisor;
+        glad_glGenQueries = genQueries;
+        glad_glBeginQuery = beginQuery;
+        glad_glEndQuery = endQuery;
+        glad_glGetQueryObjectiv = getQueryObjectiv;
+        glad_glGetQueryObjectui64v = getQueryObjectui64v;
+        glad_glQueryCounter = queryCounter;
+        glad_glDeleteQueries = deleteQueries;
+        glad_glGenFramebuffers = genFramebuffers;
+        glad_glDeleteFramebuffers = deleteFramebuffers;
+        glad_glBindFramebuffer = bindFramebuffer;
+        glad_glFramebufferTexture2D = framebufferTexture2D;
+        glad_glDrawBuffers = drawBuffers;
+        glad_glDrawBuffer = colorBuffer;
+        glad_glReadBuffer = colorBuffer;
+        glad_glCheckFramebufferStatus = checkFramebufferStatus;
+        glad_glViewport = viewport;
+        glad_glGetIntegerv = getIntegerv;
+        glad_glGetStringi = getStringi;
+    }
+
+    auto declareUniforms(std::vector<uniformDecl> uniforms) -> void {
+        declared = std::move(uniforms);
+    }
+
+    auto reset() -> void {
+        counters.fill(0);
+    }
+
+    auto calls(call entry) -> std::uint64_t {
+        return counters[(std::size_t) entry];
+    }
+
+    auto totalCalls() -> std::uint64_t {
+        std::uint64_t total = 0;
+        for (auto count: counters) total += count;
+        return total;
+    }
+}
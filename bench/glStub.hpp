@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    // Points the glad entry points at recording no-ops, so GL-facing code can be timed without a context.
+    namespace glStub {
+
+        enum class call : std::size_t {
+            createShader,
+            compileShader,
+            createProgram,
+            linkProgram,
+            getActiveUniform,
+            getUniformLocation,
+            uniform,
+            useProgram,
+            bindVertexArray,
+            bindBuffer,
+            activeTexture,
+            bindTexture,
+            drawArrays,
+            texImage,
+            bufferData,
+            mapBuffer,
+            capability,
+            bindSampler,
+            query,
+            fence,
+            bindFramebuffer,
+            count
+        };
+
+        struct uniformDecl {
+            std::string name;
+            GLenum type;
+            GLint size = 1;
+        };
+
+        auto install() -> void;
+
+        // uniforms reported by glGetActiveUniform for every program linked afterwards
+        auto declareUniforms(std::vector<uniformDecl> uniforms) -> void;
+
+        auto reset() -> void;
+
+        [[nodiscard]] auto calls(call entry) -> std::uint64_t;
+
+        [[nodiscard]] auto totalCalls() -> std::uint64_t;
+    }
+}
@@ -0,0 +1,110 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchCommon.hpp"
+#include "../src/job/jobSystem.hpp"
+#include "../src/scene/bvh.hpp"
+#include "../src/transform/transformSoA.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Scheduler overhead for empty jobs and dependency chains, then a synthetic frame of 256k spinning objects
+// (transforms, BVH culling and per-object draw preparation, the same job graph as CubeScene) at 1..N threads
+// against the serial loop.
+auto main() -> int {
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    constexpr std::size_t emptyJobs = 100'000;
+    for (auto threads: threadCounts) {
+        job::JobSystem jobs{threads - 1};
+        std::atomic<std::size_t> ran{0};
+        auto runNs = bench::measure(emptyJobs, [&](std::uint64_t n) {
+            job::counter done;
+            for (std::uint64_t i = 0; i < n; i++) jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, &done);
+            jobs.wait(done);
+        });
+        auto chainNs = bench::measure(emptyJobs / 10, [&](std::uint64_t n) {
+            std::vector<job::counter> links(n + 1);
+            for (std::uint64_t i = 0; i < n; i++) {
+                jobs.run([&] { ran.fetch_add(1, std::memory_order_relaxed); }, &links[i + 1], &links[i]);
+            }
+            for (auto &link: links) jobs.wait(link);
+        });
+        bench::report("empty jobs, " + std::to_string(threads) + " thread(s)", runNs,
+                      "per job, chained " + bench::fixed(chainNs) + " ns" +
+                      (ran.load() == emptyJobs + emptyJobs / 10 ? "" : ", LOST JOBS"));
+    }
+
+    constexpr std::size_t count = 256 * 1024;
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-200.0f, 200.0f}, unit{-1.0f, 1.0f};
+    transform::transformSoA objects;
+    scene::BVH bounds;
+    for (std::size_t i = 0; i < count; i++) {
+        glm::vec3 at{position(random), position(random), position(random)};
+        objects.add(at, glm::vec3{unit(random), unit(random), 1.0f}, unit(random), unit(random));
+        bounds.add(scene::aabb::around(at, 0.87f));
+    }
+    bounds.build();
+    std::vector<glm::mat4> models(count);
+    std::vector<std::uint32_t> visible;
+    std::vector<std::vector<float>> depths;
+
+    glm::vec3 eye{0, 0, 0};
+    auto view = scene::frustum::fromMatrix(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f) *
+                                           glm::lookAt(eye, glm::vec3{1, 0.1f, 0.3f}, glm::vec3{0, 1, 0}));
+    auto prepare = [&](std::size_t begin, std::size_t end, std::vector<float> &out) {
+        for (auto i = begin; i < end; i++) out.push_back(glm::distance(eye, glm::vec3{models[visible[i]][3]}));
+    };
+
+    constexpr int frames = 20;
+    std::size_t expected = 0;
+    auto serialNs = bench::measure(frames * count, [&](std::uint64_t) {
+        for (int frame = 0; frame < frames; frame++) {
+            transform::computeModels(objects, (float) frame / 60.0f, &models[0][0][0]);
+            visible.clear();
+            bounds.cull(view, visible);
+            depths.assign(1, {});
+            prepare(0, visible.size(), depths[0]);
+        }
+    });
+    expected = depths[0].size();
+    bench::report("serial frame", serialNs, "per object, " + std::to_string(expected) + " visible");
+
+    constexpr std::size_t modelGrain = 4096, prepareGrain = 2048;
+    for (auto threads: threadCounts) {
+        job::JobSystem jobs{threads - 1};
+        std::size_t prepared = 0;
+        auto ns = bench::measure(frames * count, [&](std::uint64_t) {
+            for (int frame = 0; frame < frames; frame++) {
+                job::counter transformed, culled;
+                jobs.parallelFor(count, modelGrain, [&, frame](std::size_t begin, std::size_t end) {
+                    transform::computeModels(objects, begin, end, (float) frame / 60.0f, &models[0][0][0]);
+                }, &transformed);
+                jobs.run([&] {
+                    visible.clear();
+                    bounds.cull(view, visible, jobs);
+                }, &culled, &transformed);
+                jobs.wait(culled);
+                jobs.wait(transformed);
+                depths.assign((visible.size() + prepareGrain - 1) / prepareGrain, {});
+                jobs.parallelFor(visible.size(), prepareGrain, [&](std::size_t begin, std::size_t end) {
+                    prepare(begin, end, depths[begin / prepareGrain]);
+                });
+            }
+        });
+        prepared = 0;
+        for (const auto &chunk: depths) prepared += chunk.size();
+        bench::report("jobs, " + std::to_string(threads) + " thread(s)", ns,
+                      "per object, speedup " + bench::fixed(serialNs / ns) + "x" +
+                      (prepared == expected ? "" : ", MISMATCH"));
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/mesh/mesh.hpp"
+#include "../src/render/commandQueue.hpp"
+#include "../src/shader/shader.hpp"
+#include "../src/texture/texture2D.hpp"
+
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+    // UV sphere with a few bumps on it, so coarser levels have something to lose
+    auto bumpySoup(int rings, int segments) -> std::vector<mesh::vertex> {
+        auto corner = [&](int ring, int segment) {
+            float theta = glm::pi<float>() * (float) ring / (float) rings;
+            float phi = glm::two_pi<float>() * (float) segment / (float) segments;
+            glm::vec3 normal{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            float radius = 1.0f + 0.05f * std::sin(6.0f * theta) * std::cos(5.0f * phi);
+            glm::vec2 uv{(float) segment / (float) segments, (float) ring / (float) rings};
+            return mesh::vertex{normal * radius, normal, uv};
+        };
+        std::vector<mesh::vertex> soup;
+        for (int ring = 0; ring < rings; ring++) {
+            for (int segment = 0; segment < segments; segment++) {
+                for (auto [r, s]: {std::array{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}}) {
+                    soup.push_back(corner(ring + r, segment + s));
+                }
+            }
+        }
+        return soup;
+    }
+}
+
+// A 130k-triangle sphere with up to nine levels of detail: build cost, triangles and error per level, then a frame
+// of 10k instances of unit radius spread up to 130 units away recorded through the CommandQueue, full detail against a
+// level per instance from a 1 px screen-space error at 1200 px and 45 degrees. Levels are separate meshes
+// in the queue, so each populated level is one instanced draw.
+auto main() -> int {
+    bench::glStub::install();
+
+    auto soup = bumpySoup(256, 256);
+    mesh::lodOptions lods;
+    lods.levels = 9;
+    std::unique_ptr<mesh::Mesh> sphere;
+    auto buildNs = bench::measure(1, [&](std::uint64_t) {
+        sphere = std::make_unique<mesh::Mesh>(soup, mesh::vertexFormat{}, mesh::attributeLocations{}, lods);
+    });
+    bench::report("build with levels", buildNs, std::to_string(soup.size() / 3) + " triangles in");
+    const auto &levels = sphere->levels();
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        std::cout << "  level " << i << ": " << levels[i].indexCount / 3 << " triangles, error "
+                  << bench::fixed(levels[i].error, 5) << std::endl;
+    }
+
+    constexpr std::size_t instances = 10'000;
+    std::mt19937 random{5};
+    std::uniform_real_distribution<float> across{-60.0f, 60.0f}, depth{1.5f, 120.0f};
+    std::vector<glm::mat4> models(instances);
+    std::vector<float> distances(instances);
+    for (std::size_t i = 0; i < instances; i++) {
+        glm::vec3 position{across(random), across(random) * 0.2f, -depth(random)};
+        models[i] = glm::translate(glm::mat4{1}, position);
+        distances[i] = glm::length(position);
+    }
+    auto projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 500.0f);
+    mesh::LodSelector selector{projection, 1200, 1.0f};
+
+    bench::glStub::declareUniforms({{"view",       GL_FLOAT_MAT4},
+                                    {"projection", GL_FLOAT_MAT4}});
+    shader::ShaderProgram program;
+    program.add(shader::Shader{STATIC_FILE_PATH"/static/shader/instancedVertexShader.vert", GL_VERTEX_SHADER})
+            .add(shader::Shader{STATIC_FILE_PATH"/static/shader/fragmentShader.frag", GL_FRAGMENT_SHADER}).load();
+    texture::texture2DLoader textures;
+
+    render::CommandQueue queue;
+    auto material = queue.addMaterial({&program, &textures});
+    std::vector<render::meshHandle> handles;
+    for (std::size_t i = 0; i < levels.size(); i++) handles.push_back(queue.addMesh(sphere->drawable(i)));
+
+    auto run = [&](const char *name, bool useLods) {
+        constexpr int frames = 20;
+        double ns = 0;
+        std::uint64_t triangles = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            queue.beginFrame();
+            ns += bench::measure(instances, [&](std::uint64_t) {
+                auto &recorder = queue.recorder();
+                for (std::size_t i = 0; i < instances; i++) {
+                    auto level = useLods ? selector.select(levels, distances[i]) : 0;
+                    recorder.draw(material, handles[level], distances[i], models[i]);
+                    triangles += levels[level].indexCount / 3;
+                }
+            });
+            queue.sort();
+            queue.submit();
+        }
+        bench::report(name, ns / frames, "per instance (select + record), " +
+                                         bench::fixed((double) triangles / frames / 1e6) + "M triangles, " +
+                                         std::to_string(queue.drawCalls()) + " draws per frame");
+        return (double) triangles;
+    };
+    auto full = run("full detail", false);
+    auto reduced = run("screen-space error LOD", true);
+    std::cout << "triangles submitted: " << bench::fixed(reduced / full * 100.0) << "% of full detail" << std::endl;
+    return 0;
+}
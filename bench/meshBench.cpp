@@ -0,0 +1,70 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/mesh/mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+    // UV sphere as a triangle soup, triangles shuffled like an exporter that does not care about order
+    auto sphereSoup(int rings, int segments) -> std::vector<mesh::vertex> {
+        auto corner = [&](int ring, int segment) {
+            float theta = glm::pi<float>() * (float) ring / (float) rings;
+            float phi = glm::two_pi<float>() * (float) segment / (float) segments;
+            glm::vec3 normal{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            return mesh::vertex{normal * 2.0f, normal, {(float) segment / (float) segments, (float) ring / (float) rings}};
+        };
+        std::vector<std::array<mesh::vertex, 3>> triangles;
+        for (int ring = 0; ring < rings; ring++) {
+            for (int segment = 0; segment < segments; segment++) {
+                triangles.push_back({corner(ring, segment), corner(ring + 1, segment), corner(ring + 1, segment + 1)});
+                triangles.push_back({corner(ring, segment), corner(ring + 1, segment + 1), corner(ring, segment + 1)});
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937{7});
+        std::vector<mesh::vertex> soup;
+        for (const auto &triangle: triangles) soup.insert(soup.end(), triangle.begin(), triangle.end());
+        return soup;
+    }
+}
+
+// Vertex memory and post-transform cache efficiency of a 130k-triangle sphere, raw soup against the
+// welded, reordered and quantized Mesh.
+auto main() -> int {
+    bench::glStub::install();
+    auto soup = sphereSoup(256, 256);
+
+    struct variant {
+        const char *name;
+        mesh::vertexFormat format;
+    };
+    const variant variants[] = {
+            {"float32",                  {mesh::positionFormat::float32, mesh::normalFormat::float32,
+                                                 mesh::uvFormat::float32}},
+            {"half pos, oct normal, uv16", {mesh::positionFormat::half16,  mesh::normalFormat::octahedral16,
+                                                 mesh::uvFormat::unorm16}},
+            {"snorm pos, oct normal, uv16", {mesh::positionFormat::snorm16, mesh::normalFormat::octahedral16,
+                                                 mesh::uvFormat::unorm16}},
+    };
+    for (const auto &entry: variants) {
+        mesh::meshStatistics stats;
+        auto ns = bench::measure(1, [&](std::uint64_t) {
+            mesh::Mesh built{soup, entry.format};
+            stats = built.statistics();
+        });
+        std::cout << std::endl << entry.name << " (" << entry.format.stride() << " bytes/vertex)" << std::endl;
+        bench::report("weld + optimize + upload", ns / (double) (soup.size() / 3), "per triangle");
+        std::cout << "  vertices " << stats.vertexCountBefore << " -> " << stats.vertexCountAfter
+                  << ", vertex bytes " << stats.vertexBytesBefore << " -> " << stats.vertexBytesAfter
+                  << " + " << stats.indexBytes << " index bytes" << std::endl
+                  << "  ACMR (16-entry FIFO) " << bench::fixed(stats.acmrBefore, 3) << " -> "
+                  << bench::fixed(stats.acmrAfter, 3) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchCommon.hpp"
+#include "../src/scene/bvh.hpp"
+#include "../src/scene/occlusion.hpp"
+#include "../src/transform/transformSoA.hpp"
+#include "../src/job/jobSystem.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Occlusion culling in a city: a 24x24 grid of buildings (box occluders, 20 units wide with 10 unit streets)
+// and 200k small objects on the streets, seen from a camera walking down one of them at eye height. Per
+// frame the BVH frustum-culls objects and buildings, the visible buildings are rasterized at 256x128 and the
+// surviving objects are tested. For every kernel and worker count: raster time per frame, test time per
+// object and the share of frustum-visible objects found hidden.
+auto main() -> int {
+    constexpr int blocks = 24;
+    constexpr float blockSize = 20.0f, street = 10.0f, pitch = blockSize + street;
+    constexpr float cityHalf = blocks * pitch * 0.5f;
+    constexpr std::size_t objects = 200'000;
+    std::mt19937 random{17};
+
+    scene::BVH buildings, props;
+    std::vector<scene::occluderMesh> buildingMeshes;
+    std::uniform_real_distribution<float> height{8.0f, 40.0f};
+    for (int bz = 0; bz < blocks; bz++) {
+        for (int bx = 0; bx < blocks; bx++) {
+            glm::vec3 min{-cityHalf + (float) bx * pitch + street, 0.0f, -cityHalf + (float) bz * pitch + street};
+            glm::vec3 max = min + glm::vec3{blockSize, height(random), blockSize};
+            buildingMeshes.push_back(scene::occluderMesh::box(min, max));
+            buildings.add({min, max});
+        }
+    }
+    // objects only stand on the streets, never inside a building
+    std::uniform_real_distribution<float> across{-cityHalf, cityHalf}, size{0.3f, 1.5f};
+    for (std::size_t i = 0; i < objects;) {
+        glm::vec3 center{across(random), 0.0f, across(random)};
+        auto inBlockX = std::fmod(center.x + cityHalf, pitch) >= street;
+        auto inBlockZ = std::fmod(center.z + cityHalf, pitch) >= street;
+        if (inBlockX && inBlockZ) continue;
+        auto radius = size(random);
+        center.y = radius;
+        props.add(scene::aabb::around(center, radius));
+        i++;
+    }
+    buildings.build();
+    props.build();
+
+    auto projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    constexpr int frames = 60;
+    auto viewAt = [&](int frame) {
+        // down the street at x = street / 2 between the first two columns, looking slightly off its axis
+        glm::vec3 eye{-cityHalf + street * 0.5f, 1.7f, cityHalf - 5.0f - (float) frame * 4.0f};
+        auto yaw = std::sin((float) frame * 0.1f) * 0.6f;
+        return projection * glm::lookAt(eye, eye + glm::vec3{std::sin(yaw) + 0.3f, 0.0f, -std::cos(yaw)},
+                                        glm::vec3{0, 1, 0});
+    };
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    scene::OcclusionBuffer buffer{256, 128};
+    std::vector<std::uint32_t> visibleBuildings, visibleProps;
+    for (auto k: {transform::kernel::scalar, transform::kernel::sse, transform::kernel::avx2}) {
+        if (transform::setKernel(k) != k) continue;
+        for (auto threads: threadCounts) {
+            job::JobSystem jobs{threads - 1};
+            double rasterNs = 0, testNs = 0;
+            std::size_t tested = 0, occluded = 0, triangles = 0;
+            for (int frame = 0; frame < frames; frame++) {
+                auto viewProjection = viewAt(frame);
+                auto view = scene::frustum::fromMatrix(viewProjection);
+                visibleBuildings.clear();
+                buildings.cull(view, visibleBuildings);
+                visibleProps.clear();
+                props.cull(view, visibleProps);
+
+                rasterNs += bench::measure(1, [&](std::uint64_t) {
+                    buffer.begin(viewProjection);
+                    for (auto b: visibleBuildings) buffer.addOccluder(buildingMeshes[b], glm::mat4{1});
+                    buffer.render(&jobs);
+                });
+                auto candidates = visibleProps.size();
+                testNs += bench::measure(1, [&](std::uint64_t) { buffer.cull(props, visibleProps); });
+                tested += candidates;
+                occluded += buffer.statistics().occluded;
+                triangles += buffer.statistics().rasterized;
+            }
+            auto name = std::string{transform::kernelName(k)} + ", " + std::to_string(threads) + " thread(s)";
+            bench::report(name + " raster", rasterNs / frames,
+                          "per frame, " + std::to_string(triangles / frames) + " occluder triangles");
+            bench::report(name + " test", testNs / (double) tested,
+                          "per object, " + std::to_string(tested / frames) + " in frustum, " +
+                          bench::fixed((double) occluded / (double) tested * 100.0) + "% occluded");
+        }
+    }
+    return 0;
+}
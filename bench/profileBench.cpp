@@ -0,0 +1,90 @@
+#include <glad/glad.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/profile/profiler.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+// Cost of CPU scopes, GPU scopes and counters against an empty loop, on one thread and with workers writing
+// their own rings while the main thread closes frames, then the frame-time summary and the trace export.
+auto main() -> int {
+    bench::glStub::install();
+    constexpr std::uint64_t scopes = 1'000'000, perFrame = 1000;
+
+    volatile std::uint64_t sink = 0;
+    auto emptyNs = bench::measure(scopes, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) sink = sink + i;
+    });
+    bench::report("empty loop", emptyNs, "per iteration");
+
+    auto cpuNs = bench::measure(scopes, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) {
+            {
+                PROFILE_SCOPE("work");
+                sink = sink + i;
+            }
+            if (i % perFrame == perFrame - 1) PROFILE_FRAME();
+        }
+    });
+    bench::report("cpu scope", cpuNs - emptyNs, "per scope, frame close included");
+
+    auto counterNs = bench::measure(scopes, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) PROFILE_COUNT(draws, 1);
+    });
+    bench::report("counter", counterNs, "per add");
+
+    auto gpuNs = bench::measure(scopes / 10, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) {
+            {
+                PROFILE_GPU_SCOPE("pass");
+            }
+            if (i % 100 == 99) PROFILE_FRAME();
+        }
+    });
+    bench::report("gpu scope (stub driver)", gpuNs, "per scope, readback included");
+
+    auto workers = std::max(2u, std::thread::hardware_concurrency());
+    std::atomic<bool> running{true};
+    std::atomic<std::uint64_t> emitted{0};
+    std::vector<std::thread> threads;
+    auto threadedNs = bench::measure(1, [&](std::uint64_t) {
+        for (unsigned int w = 0; w < workers; w++) {
+            threads.emplace_back([&] {
+                std::uint64_t local = 0;
+                while (running.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 256; i++) {
+                        PROFILE_SCOPE("job");
+                        local++;
+                    }
+                    std::this_thread::yield();
+                }
+                emitted.fetch_add(local);
+            });
+        }
+        for (int frame = 0; frame < 200; frame++) {
+            PROFILE_SCOPE("main");
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            PROFILE_FRAME();
+        }
+        running = false;
+        for (auto &thread: threads) thread.join();
+    });
+    bench::report(std::to_string(workers) + " writer threads, 200 frames", threadedNs / 200.0,
+                  "per frame, " + std::to_string(emitted.load()) + " scopes");
+
+    auto summary = profile::summary();
+    std::cout << "frame ms over " << summary.frames << " frames: p50 " << bench::fixed(summary.p50, 3)
+              << ", p95 " << bench::fixed(summary.p95, 3) << ", p99 " << bench::fixed(summary.p99, 3)
+              << ", mean " << bench::fixed(summary.mean, 3) << std::endl;
+
+    auto path = std::filesystem::temp_directory_path() / "profileBench.json";
+    auto exportNs = bench::measure(1, [&](std::uint64_t) { PROFILE_EXPORT(path.c_str()); });
+    std::cout << "trace export of the last 300 frames: " << bench::fixed(exportNs / 1e6, 1) << " ms, "
+              << std::filesystem::file_size(path) << " bytes" << std::endl;
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/glm.hpp>
+
+#include "benchCommon.hpp"
+#include "../src/render/frameCapture.hpp"
+#include "../src/render/glState.hpp"
+#include "../src/render/renderGraph.hpp"
+#include "../src/scene/cubeScene.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+    // Surfaceless EGL (Mesa llvmpipe on a build machine), falling back to the default display
+    class HeadlessContext {
+    public:
+        HeadlessContext() {
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+                std::cerr << "ERROR::EGL::NO_DISPLAY" << std::endl;
+                throw contextException();
+            }
+
+            // no surface is ever created, so any config that renders desktop GL will do
+            const EGLint configAttributes[] = {EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+            EGLConfig config;
+            EGLint configs = 0;
+            eglBindAPI(EGL_OPENGL_API);
+            // same 3.3 core context the app asks GLFW for
+            const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                                EGL_NONE};
+            if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0 ||
+                (context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes)) == EGL_NO_CONTEXT ||
+                !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+                std::cerr << "ERROR::EGL::NO_CONTEXT: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+                eglTerminate(display);
+                throw contextException();
+            }
+            if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+                std::cerr << "ERROR::EGL::GLAD_LOAD_FAILED" << std::endl;
+                throw contextException();
+            }
+        }
+
+        HeadlessContext(const HeadlessContext &) = delete;
+
+        auto operator=(const HeadlessContext &) -> HeadlessContext & = delete;
+
+        ~HeadlessContext() {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+        }
+
+        class contextException : std::exception {
+        };
+
+    private:
+        EGLDisplay display = EGL_NO_DISPLAY;
+        EGLContext context = EGL_NO_CONTEXT;
+    };
+
+    // color + depth renderbuffers standing in for the window's default framebuffer
+    class OffscreenTarget {
+    public:
+        OffscreenTarget(int width, int height) : width(width), height(height) {
+            glGenFramebuffers(1, &fbo);
+            glGenRenderbuffers(2, renderbuffers);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+            glViewport(0, 0, width, height);
+        }
+
+        OffscreenTarget(const OffscreenTarget &) = delete;
+
+        auto operator=(const OffscreenTarget &) -> OffscreenTarget & = delete;
+
+        ~OffscreenTarget() {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(2, renderbuffers);
+        }
+
+        [[nodiscard]] auto framebuffer() const -> GLuint {
+            return fbo;
+        }
+
+        // FNV-1a over the RGBA8 pixels, bottom row first
+        [[nodiscard]] auto checksum() const -> std::uint64_t {
+            std::vector<unsigned char> pixels((std::size_t) width * height * 4);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            std::uint64_t hash = 0xcbf29ce484222325ull;
+            for (auto byte: pixels) hash = (hash ^ byte) * 0x100000001b3ull;
+            return hash;
+        }
+
+    private:
+        int width, height;
+        GLuint fbo{}, renderbuffers[2]{};
+    };
+
+    // slow orbit around the cube cluster with a bob, looking at its center
+    auto placeCamera(scene::Camera &camera, float time) -> void {
+        glm::vec3 center{0, 0, -5};
+        camera.setPosition(center + glm::vec3{9.0f * std::sin(time * 0.4f), 2.0f * std::sin(time * 0.9f),
+                                              9.0f * std::cos(time * 0.4f)});
+        camera.lookAt(center);
+    }
+
+    auto percentile(std::vector<double> sorted, double fraction) -> double {
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[std::min(sorted.size() - 1, (std::size_t) (fraction * (double) (sorted.size() - 1) + 0.5))];
+    }
+}
+
+// The app's render loop without a window: offscreen 3.3 core context, simulated 60 Hz clock and a scripted
+// camera, so frame cost and the final image are reproducible on a machine without a GPU.
+//   renderBench [frames] [width height] [--expect <checksum>] [--orphaning]
+//               [--capture <dir> | --capture-raw <file> | --capture-pipe <command>]
+// --orphaning streams instances through the GL 3.3 fallback even when the context has buffer storage;
+// --capture* record every frame as PNGs, one raw RGBA stream or into an encoder's stdin, e.g.
+// --capture-pipe "ffmpeg -f rawvideo -pix_fmt rgba -s 1600x1200 -r 60 -i - run.mp4";
+// exits 1 when the final framebuffer does not hash to the expected value
+auto main(int argc, char **argv) -> int {
+    int frames = 600, width = 1600, height = 1200;
+    const char *expect = nullptr;
+    std::optional<render::captureOptions> recording;
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--expect") == 0 && i + 1 < argc) {
+            expect = argv[++i];
+        } else if (std::strcmp(argv[i], "--orphaning") == 0) {
+            render::StreamBuffer::setDefaultMode(render::streamMode::orphaning);
+        } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            recording = render::captureOptions{render::captureFormat::pngSequence, argv[++i]};
+        } else if (std::strcmp(argv[i], "--capture-raw") == 0 && i + 1 < argc) {
+            recording = render::captureOptions{render::captureFormat::rawStream, argv[++i]};
+        } else if (std::strcmp(argv[i], "--capture-pipe") == 0 && i + 1 < argc) {
+            recording = render::captureOptions{render::captureFormat::pipe, argv[++i]};
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() >= 1) frames = std::max(1, std::atoi(positional[0]));
+    if (positional.size() >= 3) {
+        width = std::max(1, std::atoi(positional[1]));
+        height = std::max(1, std::atoi(positional[2]));
+    }
+
+    HeadlessContext context;
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+    OffscreenTarget target{width, height};
+    auto &glState = render::GLState::current();
+    job::JobSystem jobs;
+    scene::CubeScene cubes{&jobs};
+    render::RenderGraph frameGraph;
+    scene::Camera camera;
+    camera.setViewport(width, height);
+    std::unique_ptr<render::FrameCapture> capture;
+    if (recording) capture = std::make_unique<render::FrameCapture>(width, height, *recording);
+
+    constexpr float step = 1.0f / 60.0f;
+    std::vector<double> cpuMs, finishMs;
+    std::uint64_t drawCalls = 0, stateCalls = 0, visible = 0, occluded = 0;
+    // per pass: frames timed, CPU and GPU milliseconds
+    std::map<std::string, std::array<double, 3>> passMs;
+    for (int frame = 0; frame < frames; frame++) {
+        float time = (float) frame * step;
+        placeCamera(camera, time);
+
+        auto cpuNs = bench::measure(1, [&](std::uint64_t) {
+            auto backbuffer = frameGraph.importTarget("backbuffer", target.framebuffer(), width, height);
+            frameGraph.addPass("cubes", [&](render::RenderGraph::PassBuilder &pass) { pass.write(backbuffer); },
+                               [&](const render::RenderGraph &) {
+                                   glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+                                   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                                   cubes.frame(time, camera);
+                               });
+            frameGraph.execute();
+            if (capture) capture->capture();
+        });
+        // the software rasterizer does its work here, a GPU would overlap it with the next frame
+        auto finishNs = bench::measure(1, [&](std::uint64_t) { glFinish(); });
+        cpuMs.push_back(cpuNs / 1e6);
+        finishMs.push_back((cpuNs + finishNs) / 1e6);
+
+        drawCalls += cubes.drawCalls();
+        visible += cubes.visible();
+        occluded += cubes.occlusion().statistics().occluded;
+        stateCalls += glState.counters().totalIssued();
+        glState.endFrame();
+        for (const auto &pass: frameGraph.timings()) {
+            auto &sums = passMs[pass.name];
+            sums[0]++;
+            sums[1] += pass.cpuMs;
+            sums[2] += pass.gpuMs;
+        }
+    }
+
+    auto checksum = target.checksum();
+    if (capture) capture->finish();
+    std::cout << frames << " frames at " << width << "x" << height << std::endl
+              << "cpu frame ms        p50 " << bench::fixed(percentile(cpuMs, 0.5), 3) << ", p95 "
+              << bench::fixed(percentile(cpuMs, 0.95), 3) << ", p99 " << bench::fixed(percentile(cpuMs, 0.99), 3)
+              << std::endl
+              << "frame + finish ms   p50 " << bench::fixed(percentile(finishMs, 0.5), 3) << ", p95 "
+              << bench::fixed(percentile(finishMs, 0.95), 3) << ", p99 "
+              << bench::fixed(percentile(finishMs, 0.99), 3) << std::endl
+              << "per frame           " << bench::fixed((double) drawCalls / frames) << " draw calls, "
+              << bench::fixed((double) visible / frames) << " visible cubes, "
+              << bench::fixed((double) stateCalls / frames) << " state calls issued" << std::endl;
+    const auto &stream = cubes.instanceStream();
+    std::cout << "instance stream     " << (stream.persistent() ? "persistent" : "orphaning") << ", "
+              << stream.statistics().stalls << " stalls, " << stream.statistics().orphans << " orphans, "
+              << bench::fixed((double) stream.statistics().bytes / frames) << " bytes per frame" << std::endl;
+    std::cout << "occlusion           " << cubes.occlusion().width() << "x" << cubes.occlusion().height() << ", "
+              << bench::fixed((double) occluded / frames) << " cubes hidden per frame" << std::endl;
+    const auto &graph = frameGraph.statistics();
+    std::cout << "render graph        " << graph.passes << " passes, " << graph.culled << " culled, "
+              << graph.transients << " transient targets on " << graph.textures << " textures, "
+              << bench::fixed((double) graph.allocatedBytes / (1 << 20)) << " of "
+              << bench::fixed((double) graph.requestedBytes / (1 << 20)) << " MiB, " << graph.lateTimings
+              << " frames timed late" << std::endl;
+    for (const auto &[name, sums]: passMs) {
+        std::cout << "  pass " << name << std::string(name.size() < 14 ? 14 - name.size() : 0, ' ')
+                  << "cpu ms " << bench::fixed(sums[1] / sums[0], 3) << ", gpu ms "
+                  << bench::fixed(sums[2] / sums[0], 3) << " over " << (std::uint64_t) sums[0] << " timed frames"
+                  << std::endl;
+    }
+    const auto &residency = cubes.residency().statistics();
+    std::cout << "texture residency   " << bench::fixed((double) residency.resident / 1024.0) << " KiB resident, "
+              << bench::fixed(residency.hitRate() * 100.0) << "% hits, " << residency.uploads << " level uploads, "
+              << residency.evictions << " evictions" << std::endl;
+
+    if (capture) {
+        auto recorded = capture->statistics();
+        std::cout << "capture             " << recorded.encoded << " of " << recorded.requested << " frames written, "
+                  << recorded.droppedRing << " dropped waiting for the GPU, " << recorded.droppedQueue
+                  << " for the encoder, " << bench::fixed((double) recorded.bytesWritten / (1 << 20)) << " MiB"
+                  << (recorded.writeErrors ? ", WRITE ERRORS" : "") << (recorded.outputClosed ? ", OUTPUT CLOSED" : "")
+                  << std::endl;
+    }
+
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) checksum);
+    std::cout << "framebuffer checksum " << hex << std::endl;
+    if (expect && std::strcmp(expect, hex) != 0) {
+        std::cerr << "ERROR::RENDER_BENCH::CHECKSUM_MISMATCH: expected " << expect << std::endl;
+        return 1;
+    }
+    return 0;
+}
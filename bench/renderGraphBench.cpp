@@ -0,0 +1,143 @@
+#include <glad/glad.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/render/glState.hpp"
+#include "../src/render/renderGraph.hpp"
+
+#include <initializer_list>
+#include <vector>
+
+namespace {
+    using render::RenderGraph;
+    using render::resourceHandle;
+
+    // every pass samples its inputs and draws one fullscreen triangle
+    auto fullscreen(std::initializer_list<resourceHandle> inputs) -> RenderGraph::executeFunction {
+        std::vector<resourceHandle> sampled{inputs};
+        return [sampled](const RenderGraph &graph) {
+            auto &state = render::GLState::current();
+            for (GLuint unit = 0; unit < sampled.size(); unit++) {
+                state.bindTexture(unit, GL_TEXTURE_2D, graph.texture(sampled[unit]));
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        };
+    }
+
+    // A deferred frame: shadow map, depth pre-pass, G-buffer, SSAO, lighting, bloom, tonemapping and an
+    // anti-aliased present, plus a debug view nothing reads
+    auto declare(RenderGraph &graph, GLsizei width, GLsizei height) -> void {
+        GLsizei halfWidth = width / 2, halfHeight = height / 2;
+        auto backbuffer = graph.importTarget("backbuffer", 0, width, height);
+        resourceHandle shadow, depth, albedo, normal, ao, aoBlurred, hdr, bright, quarter, bloom, ldr;
+
+        graph.addPass("shadow", [&](auto &pass) {
+            shadow = pass.write(pass.create("shadow map", {2048, 2048, GL_DEPTH_COMPONENT32F}));
+        }, fullscreen({}));
+        graph.addPass("depth pre-pass", [&](auto &pass) {
+            depth = pass.write(pass.create("depth", {width, height, GL_DEPTH24_STENCIL8}));
+        }, fullscreen({}));
+        graph.addPass("gbuffer", [&](auto &pass) {
+            albedo = pass.write(pass.create("albedo", {width, height, GL_RGBA8}));
+            normal = pass.write(pass.create("normal", {width, height, GL_RGBA16F}));
+            depth = pass.write(depth);
+        }, fullscreen({}));
+        graph.addPass("ssao", [&](auto &pass) {
+            pass.read(normal);
+            pass.read(depth);
+            ao = pass.write(pass.create("ao", {width, height, GL_R8}));
+        }, fullscreen({normal, depth}));
+        graph.addPass("ssao blur", [&](auto &pass) {
+            pass.read(ao);
+            aoBlurred = pass.write(pass.create("ao blurred", {width, height, GL_R8}));
+        }, fullscreen({ao}));
+        graph.addPass("lighting", [&](auto &pass) {
+            for (auto input: {albedo, normal, aoBlurred, shadow, depth}) pass.read(input);
+            hdr = pass.write(pass.create("hdr", {width, height, GL_RGBA16F}));
+        }, fullscreen({albedo, normal, aoBlurred, shadow, depth}));
+        graph.addPass("debug normals", [&](auto &pass) {
+            pass.read(normal);
+            pass.write(pass.create("normal view", {width, height, GL_RGBA8}));
+        }, fullscreen({normal}));
+        graph.addPass("bloom bright", [&](auto &pass) {
+            pass.read(hdr);
+            bright = pass.write(pass.create("bright", {halfWidth, halfHeight, GL_RGBA16F}));
+        }, fullscreen({hdr}));
+        graph.addPass("bloom down", [&](auto &pass) {
+            pass.read(bright);
+            quarter = pass.write(pass.create("bloom quarter", {width / 4, height / 4, GL_RGBA16F}));
+        }, fullscreen({bright}));
+        graph.addPass("bloom up", [&](auto &pass) {
+            pass.read(quarter);
+            bloom = pass.write(pass.create("bloom", {halfWidth, halfHeight, GL_RGBA16F}));
+        }, fullscreen({quarter}));
+        graph.addPass("tonemap", [&](auto &pass) {
+            pass.read(hdr);
+            pass.read(bloom);
+            ldr = pass.write(pass.create("ldr", {width, height, GL_RGBA8}));
+        }, fullscreen({hdr, bloom}));
+        graph.addPass("fxaa", [&](auto &pass) {
+            pass.read(ldr);
+            pass.write(backbuffer);
+        }, fullscreen({ldr}));
+    }
+
+    auto mib(std::size_t bytes) -> std::string {
+        return bench::fixed((double) bytes / (1 << 20), 1) + " MiB";
+    }
+}
+
+// Per-frame cost of declaring, compiling and running a 12-pass deferred frame through render::RenderGraph,
+// and the target memory that aliasing transients with disjoint lifetimes saves.
+auto main() -> int {
+    bench::glStub::install();
+    constexpr GLsizei width = 1920, height = 1080;
+    constexpr std::uint64_t frames = 20'000;
+
+    RenderGraph graph;
+    auto declareNs = bench::measure(frames, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) {
+            RenderGraph scratch;
+            declare(scratch, width, height);
+            bench::doNotOptimize(scratch);
+        }
+    });
+    bench::report("declare", declareNs, "fresh graph, nothing compiled or pooled");
+
+    // warm: the pool already holds every texture and framebuffer the frame needs
+    declare(graph, width, height);
+    graph.execute();
+    bench::glStub::reset();
+    auto compileNs = bench::measure(frames, [&](std::uint64_t n) {
+        for (std::uint64_t i = 0; i < n; i++) {
+            declare(graph, width, height);
+            graph.compile();
+            graph.execute();
+        }
+    });
+    bench::report("declare + compile + execute", compileNs,
+                  "gl calls/frame: " + bench::fixed((double) bench::glStub::totalCalls() / frames, 1) +
+                  ", framebuffer binds/frame: " +
+                  bench::fixed((double) bench::glStub::calls(bench::glStub::call::bindFramebuffer) / frames, 1));
+
+    const auto &stats = graph.statistics();
+    std::cout << "passes: " << stats.passes << " declared, " << stats.culled << " culled" << std::endl
+              << "transient targets: " << stats.transients << " on " << stats.textures << " textures, "
+              << mib(stats.requestedBytes) << " requested, " << mib(stats.allocatedBytes) << " allocated ("
+              << bench::fixed(100.0 * (1.0 - (double) stats.allocatedBytes / (double) stats.requestedBytes), 1)
+              << "% saved)" << std::endl
+              << "pool: " << stats.pooledTextures << " textures, " << mib(stats.pooledBytes) << ", "
+              << stats.texturesCreated << " created, " << stats.framebuffersCreated << " framebuffers over "
+              << frames + 1 << " frames" << std::endl;
+
+    // one frame at a different resolution leaves the old textures idle until they age out of the pool
+    declare(graph, 1280, 720);
+    graph.execute();
+    for (int i = 0; i < 64; i++) {
+        declare(graph, 1280, 720);
+        graph.execute();
+    }
+    std::cout << "after resizing to 1280x720: " << stats.pooledTextures << " pooled textures, "
+              << mib(stats.pooledBytes) << ", " << stats.texturesReleased << " released" << std::endl;
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <glad/glad.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/render/glState.hpp"
+
+#include <vector>
+
+// Binding calls per frame for a scene drawn in material order: every draw binding everything it needs
+// directly, against the same sequence going through render::GLState.
+auto main() -> int {
+    bench::glStub::install();
+
+    struct draw {
+        GLuint program, vao, diffuse, detail;
+    };
+    // 4 programs x 8 texture pairs x 4 meshes, sorted by program then textures like a batched frame
+    std::vector<draw> frame;
+    for (GLuint program = 1; program <= 4; program++) {
+        for (GLuint material = 0; material < 8; material++) {
+            for (GLuint vao = 1; vao <= 4; vao++) {
+                frame.push_back({program, vao, 100 + material, 200 + material % 2});
+            }
+        }
+    }
+    constexpr std::uint64_t frames = 20'000;
+
+    auto run = [&](std::string_view name, auto &&submit) {
+        bench::glStub::reset();
+        auto ns = bench::measure(frames, [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                for (const auto &entry: frame) {
+                    submit(entry);
+                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                }
+            }
+        });
+        auto perFrame = (double) bench::glStub::totalCalls() / (double) frames;
+        bench::report(name, ns, "gl calls/frame: " + bench::fixed(perFrame, 1) + " (" +
+                                std::to_string(frame.size()) + " draws)");
+    };
+
+    run("unconditional binds", [](const draw &entry) {
+        glUseProgram(entry.program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, entry.diffuse);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, entry.detail);
+        glBindVertexArray(entry.vao);
+    });
+
+    auto &state = render::GLState::current();
+    state.invalidate();
+    run("render::GLState", [&](const draw &entry) {
+        state.useProgram(entry.program);
+        state.bindTexture(0, GL_TEXTURE_2D, entry.diffuse);
+        state.bindTexture(1, GL_TEXTURE_2D, entry.detail);
+        state.bindVertexArray(entry.vao);
+    });
+
+    // per-frame counters as the render loop sees them, after one more frame
+    state.endFrame();
+    for (const auto &entry: frame) {
+        state.useProgram(entry.program);
+        state.bindTexture(0, GL_TEXTURE_2D, entry.diffuse);
+        state.bindTexture(1, GL_TEXTURE_2D, entry.detail);
+        state.bindVertexArray(entry.vao);
+    }
+    state.endFrame();
+    const auto &counters = state.lastFrame();
+    std::cout << "last frame: issued " << counters.totalIssued() << ", skipped " << counters.totalSkipped()
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/render/commandQueue.hpp"
+#include "../src/render/glState.hpp"
+#include "../src/texture/texture2D.hpp"
+
+#include <array>
+#include <random>
+#include <vector>
+
+// 64 differently sized RGB images packed into texture arrays (resample throughput), then a frame of 20k objects
+// each showing one of them: one texture2D per image and material, against one array and a per-instance layer.
+// Reports texture binds reaching GL, texture set switches and draw calls per frame.
+auto main() -> int {
+    bench::glStub::install();
+    bench::glStub::declareUniforms({{"texture1",      GL_SAMPLER_2D},
+                                    {"textureLayers", GL_SAMPLER_2D_ARRAY}});
+
+    constexpr int images = 64;
+    std::mt19937 random{7};
+    std::uniform_int_distribution<int> side{300, 512};
+    std::vector<std::vector<unsigned char>> sources;
+    std::vector<std::pair<int, int>> sizes;
+    std::size_t sourceBytes = 0;
+    for (int i = 0; i < images; i++) {
+        int width = side(random), height = side(random);
+        sources.emplace_back((std::size_t) width * height * 3);
+        for (auto &byte: sources.back()) byte = (unsigned char) random();
+        sizes.emplace_back(width, height);
+        sourceBytes += sources.back().size();
+    }
+
+    texture::TextureArrayPacker packer;
+    std::vector<texture::arraySlot> slots;
+    auto packNs = bench::measure(images, [&](std::uint64_t) {
+        for (int i = 0; i < images; i++) {
+            slots.push_back(packer.add(sources[i].data(), sizes[i].first, sizes[i].second, 3));
+        }
+    });
+    packer.build();
+    bench::report("pack (resample to layer)", packNs,
+                  "per image, " + bench::fixed((double) sourceBytes / (packNs * images) * 1e3) + " MB/s, " +
+                  std::to_string(packer.arrayCount()) + " array(s) of " + std::to_string(packer.layerCount(0)) +
+                  " layers");
+
+    const char *vPath = STATIC_FILE_PATH"/static/shader/instancedVertexShader.vert";
+    const char *fPath = STATIC_FILE_PATH"/static/shader/fragmentShader.frag";
+    shader::ShaderProgram program;
+    program.add(shader::Shader{vPath, GL_VERTEX_SHADER}).add(shader::Shader{fPath, GL_FRAGMENT_SHADER}).load();
+
+    // the unpacked way: a texture object and a material per image
+    std::array<texture::texture2DLoader, images> separate;
+    for (auto &loader: separate) loader.addTexture(STATIC_FILE_PATH"/static/texture2D/container.jpg", GL_TEXTURE0);
+
+    constexpr std::size_t objects = 20'000;
+    std::vector<glm::mat4> models(objects);
+    std::vector<int> shown(objects);
+    std::uniform_real_distribution<float> position{-100, 100};
+    for (std::size_t i = 0; i < objects; i++) {
+        models[i] = glm::translate(glm::mat4{1}, glm::vec3{position(random), position(random), position(random)});
+        shown[i] = (int) (random() % images);
+    }
+
+    auto &glState = render::GLState::current();
+    auto run = [&](const char *name, auto &&record) {
+        render::CommandQueue queue;
+        record(queue, true);
+        constexpr int frames = 20;
+        double ns = 0;
+        std::uint64_t binds = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            queue.beginFrame();
+            record(queue, false);
+            queue.sort();
+            glState.endFrame();
+            ns += bench::measure(objects, [&](std::uint64_t) { queue.submit(); });
+            binds += glState.counters().issued[(std::size_t) render::stateCall::texture];
+        }
+        bench::report(name, ns / frames,
+                      "per object, " + bench::fixed((double) binds / frames) + " texture binds, " +
+                      std::to_string(queue.textureSwitches()) + " texture set switches, " +
+                      std::to_string(queue.drawCalls()) + " draws per frame");
+        return (double) binds / frames;
+    };
+
+    std::vector<render::materialHandle> materials;
+    render::meshHandle mesh{};
+    auto separateBinds = run("texture per material", [&](render::CommandQueue &queue, bool setup) {
+        if (setup) {
+            for (auto &loader: separate) materials.push_back(queue.addMaterial({&program, &loader}));
+            mesh = queue.addMesh(render::mesh{1, 36});
+            return;
+        }
+        auto &recorder = queue.recorder();
+        for (std::size_t i = 0; i < objects; i++) recorder.draw(materials[shown[i]], mesh, 1.0f, models[i]);
+    });
+
+    auto &arrayProgram = program.setFeatures({"TEXTURE_ARRAY"}).variant(1);
+    texture::texture2DLoader layers;
+    layers.addTextureArray(packer, 0, GL_TEXTURE0);
+    render::materialHandle shared{};
+    auto arrayBinds = run("texture array, layer per instance", [&](render::CommandQueue &queue, bool setup) {
+        if (setup) {
+            shared = queue.addMaterial({&arrayProgram, &layers});
+            mesh = queue.addMesh(render::mesh{1, 36});
+            return;
+        }
+        auto &recorder = queue.recorder();
+        for (std::size_t i = 0; i < objects; i++) {
+            recorder.draw(shared, mesh, 1.0f, models[i], slots[shown[i]].layer);
+        }
+    });
+    std::cout << "texture binds saved per frame: " << bench::fixed(separateBinds - arrayBinds) << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/texture/textureContainer.hpp"
+#include "../src/util/mappedFile.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // drops the file's clean pages so the next read has to go to disk
+    auto evictFromPageCache(const std::string &path) -> bool {
+#if defined(__linux__)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        fdatasync(fd);
+        bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(fd);
+        return evicted;
+#else
+        (void) path;
+        return false;
+#endif
+    }
+
+    auto loadSource(const std::string &path, GLint imageType) -> void {
+        int width, height, channels;
+        auto *pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, imageType, width, height, 0, imageType, GL_UNSIGNED_BYTE, pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        stbi_image_free(pixels);
+    }
+
+    auto loadBaked(const std::string &path) -> void {
+        util::mappedFile file{path.c_str()};
+        texture::container::view{file.data(), file.size()}.upload();
+    }
+}
+
+// Startup cost of the bundled textures: decode with stb_image against uploading from a mapped container.
+// The stub copies every uploaded level like a driver would; GPU-side glGenerateMipmap is not counted.
+auto main() -> int {
+    bench::glStub::install();
+
+    struct source {
+        std::string name;
+        GLint imageType;
+    };
+    const std::vector<source> sources = {{"container.jpg", GL_RGB},
+                                         {"wall.jpg",      GL_RGB},
+                                         {"face.png",      GL_RGBA}};
+
+    auto bakedDir = std::filesystem::temp_directory_path() / "learnopengl-textureContainerBench";
+    std::filesystem::create_directories(bakedDir);
+
+    constexpr int warmRuns = 20, coldRuns = 5;
+    for (const auto &texture: sources) {
+        auto sourcePath = std::string{STATIC_FILE_PATH"/static/texture2D/"} + texture.name;
+        auto bakedPath = (bakedDir / (texture.name + ".ltex")).string();
+        {
+            int width, height, channels;
+            auto *pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+            auto file = texture::container::bake(pixels, width, height, channels, {});
+            stbi_image_free(pixels);
+            std::ofstream{bakedPath, std::ios::binary}.write((const char *) file.data(), (std::streamsize) file.size());
+        }
+
+        std::cout << std::endl << texture.name << std::endl;
+        if (evictFromPageCache(sourcePath) && evictFromPageCache(bakedPath)) {
+            double stbCold = 0, bakedCold = 0;
+            for (int run = 0; run < coldRuns; run++) {
+                evictFromPageCache(sourcePath);
+                stbCold += bench::measure(1, [&](std::uint64_t) { loadSource(sourcePath, texture.imageType); });
+                evictFromPageCache(bakedPath);
+                bakedCold += bench::measure(1, [&](std::uint64_t) { loadBaked(bakedPath); });
+            }
+            bench::report("cold stbi_load", stbCold / coldRuns);
+            bench::report("cold mapped container", bakedCold / coldRuns,
+                          "speedup " + bench::fixed(stbCold / bakedCold) + "x");
+        } else {
+            std::cout << "cold runs need posix_fadvise page-cache eviction, skipped" << std::endl;
+        }
+
+        auto stbWarm = bench::measure(warmRuns, [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) loadSource(sourcePath, texture.imageType);
+        });
+        auto bakedWarm = bench::measure(warmRuns, [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) loadBaked(bakedPath);
+        });
+        bench::report("warm stbi_load", stbWarm);
+        bench::report("warm mapped container", bakedWarm, "speedup " + bench::fixed(stbWarm / bakedWarm) + "x");
+    }
+    std::filesystem::remove_all(bakedDir);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <stb_image.h>
+
+#include "benchCommon.hpp"
+#include "../src/job/jobSystem.hpp"
+#include "../src/texture/blockCompression.hpp"
+#include "../src/texture/textureContainer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+    // over the channels the format stores; the source is what the encoder was given
+    auto psnr(const std::vector<unsigned char> &source, const std::vector<unsigned char> &decoded, int channels,
+              int used) -> double {
+        double squared = 0;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < source.size(); i += channels) {
+            for (int c = 0; c < used; c++, count++) {
+                double d = (double) source[i + c] - (double) decoded[i + c];
+                squared += d * d;
+            }
+        }
+        if (squared == 0) return 99.0;
+        return 10.0 * std::log10(255.0 * 255.0 / (squared / (double) count));
+    }
+
+    // the image re-laid out with exactly channels bytes per pixel, missing alpha opaque
+    auto withChannels(const unsigned char *pixels, int width, int height, int from, int to)
+    -> std::vector<unsigned char> {
+        std::vector<unsigned char> result((std::size_t) width * height * to);
+        for (std::size_t i = 0; i < (std::size_t) width * height; i++) {
+            for (int c = 0; c < to; c++) result[i * to + c] = c < from ? pixels[i * from + c] : 255;
+        }
+        return result;
+    }
+}
+
+// Every image in static/texture2D through each block format: encode throughput on one thread and on the job
+// system (MPix/s, and per participating core), PSNR of the decoded blocks against the source, and the
+// gamma-correct mip chain serial against parallel.
+auto main() -> int {
+    job::JobSystem jobs;
+    auto cores = jobs.concurrency();
+    std::cout << "job system: " << cores << " threads" << std::endl;
+
+    struct formatCase {
+        texture::bc::format blocks;
+        int channels, used;
+    };
+    constexpr formatCase formats[] = {{texture::bc::format::bc1, 3, 3},
+                                      {texture::bc::format::bc3, 4, 4},
+                                      {texture::bc::format::bc4, 1, 1},
+                                      {texture::bc::format::bc5, 2, 2}};
+    constexpr int repeats = 3;
+
+    for (const char *name: {"container.jpg", "wall.jpg", "face.png"}) {
+        auto path = std::string{STATIC_FILE_PATH"/static/texture2D/"} + name;
+        int width = 0, height = 0, channels = 0;
+        auto *pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (!pixels) {
+            std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << path << std::endl;
+            return 1;
+        }
+        auto megapixels = (double) width * height / 1e6;
+        std::cout << name << " " << width << "x" << height << "x" << channels << std::endl;
+
+        for (const auto &format: formats) {
+            auto source = withChannels(pixels, width, height, channels, format.channels);
+            std::vector<unsigned char> blocks;
+            double serialNs = 1e30, parallelNs = 1e30;
+            for (int r = 0; r < repeats; r++) {
+                serialNs = std::min(serialNs, bench::measure(1, [&](std::uint64_t) {
+                    blocks = texture::bc::encode(format.blocks, source.data(), width, height, format.channels);
+                }));
+                parallelNs = std::min(parallelNs, bench::measure(1, [&](std::uint64_t) {
+                    blocks = texture::bc::encode(format.blocks, source.data(), width, height, format.channels, &jobs);
+                }));
+            }
+            auto decoded = texture::bc::decode(format.blocks, blocks.data(), width, height, format.channels);
+            auto serialRate = megapixels / serialNs * 1e9, parallelRate = megapixels / parallelNs * 1e9;
+            bench::report(std::string{"  "} + texture::bc::name(format.blocks) + " encode", serialNs,
+                          bench::fixed(serialRate) + " MPix/s serial, " + bench::fixed(parallelRate) +
+                          " MPix/s on jobs (" + bench::fixed(parallelRate / cores) + " per core), PSNR " +
+                          bench::fixed(psnr(source, decoded, format.channels, format.used)) + " dB, " +
+                          std::to_string(blocks.size()) + " bytes");
+        }
+
+        double serialNs = 1e30, parallelNs = 1e30;
+        std::size_t levels = 0;
+        for (int r = 0; r < repeats; r++) {
+            serialNs = std::min(serialNs, bench::measure(1, [&](std::uint64_t) {
+                levels = texture::container::mipChain(pixels, width, height, channels, true).size();
+            }));
+            parallelNs = std::min(parallelNs, bench::measure(1, [&](std::uint64_t) {
+                levels = texture::container::mipChain(pixels, width, height, channels, true, &jobs).size();
+            }));
+        }
+        bench::report("  mip chain (sRGB, linear filter)", serialNs,
+                      std::to_string(levels) + " levels, " + bench::fixed(serialNs / parallelNs) + "x on jobs");
+        stbi_image_free(pixels);
+    }
+    return 0;
+}
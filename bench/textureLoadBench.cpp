@@ -0,0 +1,70 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/texture/asyncTextureLoader.hpp"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup cost of loading many textures: synchronous stbi_load against the async loader at 1..N workers,
+// on its own threads and on the job system.
+auto main() -> int {
+    bench::glStub::install();
+
+    struct source {
+        std::string path;
+        GLint imageType;
+    };
+    std::vector<source> sources;
+    constexpr int copies = 16;
+    for (int i = 0; i < copies; i++) {
+        sources.push_back({STATIC_FILE_PATH"/static/texture2D/container.jpg", GL_RGB});
+        sources.push_back({STATIC_FILE_PATH"/static/texture2D/wall.jpg", GL_RGB});
+        sources.push_back({STATIC_FILE_PATH"/static/texture2D/face.png", GL_RGBA});
+    }
+
+    auto syncNs = bench::measure(sources.size(), [&](std::uint64_t) {
+        for (const auto &texture: sources) {
+            int width, height, channels;
+            auto *pixels = stbi_load(texture.path.c_str(), &width, &height, &channels, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, texture.imageType, width, height, 0, texture.imageType,
+                         GL_UNSIGNED_BYTE, pixels);
+            stbi_image_free(pixels);
+        }
+    });
+    bench::report("stbi_load on the GL thread", syncNs, "per texture");
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> workerCounts;
+    for (unsigned int workers = 1; workers < cores; workers *= 2) workerCounts.push_back(workers);
+    workerCounts.push_back(cores);
+
+    for (auto workers: workerCounts) {
+        auto ns = bench::measure(sources.size(), [&](std::uint64_t) {
+            texture::AsyncTextureLoader loader{workers};
+            GLuint textureID = 1;
+            for (const auto &texture: sources) loader.enqueue(textureID++, texture.path.c_str(), texture.imageType);
+            loader.finish();
+        });
+        bench::report("async, " + std::to_string(workers) + " workers", ns,
+                      "per texture, speedup " + bench::fixed(syncNs / ns) + "x");
+    }
+
+    // decodes as jobs, the GL thread counting as one of the participants
+    for (auto participants: workerCounts) {
+        auto ns = bench::measure(sources.size(), [&](std::uint64_t) {
+            job::JobSystem jobs{participants - 1};
+            texture::AsyncTextureLoader loader{jobs};
+            GLuint textureID = 1;
+            for (const auto &texture: sources) loader.enqueue(textureID++, texture.path.c_str(), texture.imageType);
+            loader.finish();
+        });
+        bench::report("job system, " + std::to_string(participants) + " threads", ns,
+                      "per texture, speedup " + bench::fixed(syncNs / ns) + "x");
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <glad/glad.h>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/texture/textureContainer.hpp"
+#include "../src/texture/textureResidency.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Sizing a texture budget: 256 baked 1024x1024 BC1 textures (about 680 KiB each with mips), of which a frame
+// draws 48 from a window that drifts across the set, like a camera moving through a level. For every budget:
+// request hit rate, levels evicted and bytes streamed per frame, and the cost of update().
+auto main() -> int {
+    bench::glStub::install();
+
+    constexpr int size = 1024, textures = 256, perFrame = 48, frames = 600;
+    std::vector<unsigned char> pixels((std::size_t) size * size * 3);
+    std::mt19937 random{11};
+    for (auto &byte: pixels) byte = (unsigned char) random();
+    texture::container::bakeOptions options;
+    options.blocks = texture::bc::format::bc1;
+    auto file = texture::container::bake(pixels.data(), size, size, 3, options);
+    auto dir = std::filesystem::temp_directory_path() / "learnopengl-textureResidencyBench";
+    std::filesystem::create_directories(dir);
+    auto path = (dir / "noise.ltex").string();
+    std::ofstream{path, std::ios::binary}.write((const char *) file.data(), (std::streamsize) file.size());
+    std::cout << textures << " textures of " << file.size() / 1024 << " KiB, " << perFrame << " drawn per frame"
+              << std::endl;
+
+    for (std::size_t budgetMiB: {8, 16, 32, 64, 192}) {
+        texture::ResidencyManager residency{budgetMiB << 20};
+        std::vector<texture::residentHandle> handles;
+        for (int i = 0; i < textures; i++) handles.push_back(residency.add(path.c_str()));
+
+        std::mt19937 order{3};
+        std::normal_distribution<float> around{0.0f, perFrame / 3.0f};
+        auto before = residency.statistics();
+        double updateNs = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            // the window centre sweeps the whole set twice
+            auto centre = (float) frame / frames * 2.0f * textures;
+            for (int i = 0; i < perFrame; i++) {
+                auto index = ((int) (centre + around(order)) % textures + textures) % textures;
+                residency.request(handles[index]);
+            }
+            updateNs += bench::measure(1, [&](std::uint64_t) { residency.update(); });
+        }
+        const auto &stats = residency.statistics();
+        bench::report(std::to_string(budgetMiB) + " MiB budget", updateNs / frames,
+                      "per update, " + bench::fixed(stats.hitRate() * 100.0) + "% hits, " +
+                      bench::fixed((double) (stats.evictions - before.evictions) / frames) + " evictions and " +
+                      bench::fixed((double) (stats.uploadedBytes - before.uploadedBytes) / frames / 1024.0) +
+                      " KiB uploaded per frame, peak " + bench::fixed((double) stats.peak / (1 << 20)) + " MiB");
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
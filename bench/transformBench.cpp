@@ -0,0 +1,72 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "benchCommon.hpp"
+#include "../src/transform/transformSoA.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Model / MVP generation: glm translate + rotate per object against the SoA kernels.
+auto main() -> int {
+    const glm::mat4 viewProjection =
+            glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f) *
+            glm::lookAt(glm::vec3{0, 0, 3}, glm::vec3{0, 0, 0}, glm::vec3{0, 1, 0});
+    const float time = 12.345f;
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> range{-50.0f, 50.0f};
+
+    std::cout << "detected kernel: " << transform::kernelName(transform::detectKernel()) << std::endl;
+
+    for (std::size_t count: {1'000ul, 100'000ul, 1'000'000ul}) {
+        transform::transformSoA objects;
+        objects.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            objects.add({range(random), range(random), range(random)},
+                        {range(random), range(random), range(random) + 0.01f},
+                        range(random), glm::radians(90.0f));
+        }
+        std::vector<float> reference(count * 16), out(count * 16);
+        auto repeat = std::max<std::uint64_t>(1, 20'000'000 / count);
+
+        std::cout << std::endl << count << " objects" << std::endl;
+        for (bool mvp: {false, true}) {
+            auto glmNs = bench::measure(repeat * count, [&](std::uint64_t) {
+                for (std::uint64_t r = 0; r < repeat; r++) {
+                    for (std::size_t i = 0; i < count; i++) {
+                        glm::mat4 model{1};
+                        model = glm::translate(model, {objects.positionX[i], objects.positionY[i], objects.positionZ[i]});
+                        model = glm::rotate(model, objects.angle[i] + objects.spin[i] * time,
+                                            {objects.axisX[i], objects.axisY[i], objects.axisZ[i]});
+                        if (mvp) model = viewProjection * model;
+                        std::copy_n(glm::value_ptr(model), 16, &reference[i * 16]);
+                    }
+                    bench::doNotOptimize(reference[0]);
+                }
+            });
+            bench::report(mvp ? "glm per object (mvp)" : "glm per object (model)", glmNs);
+
+            for (auto k: {transform::kernel::scalar, transform::kernel::sse, transform::kernel::avx2}) {
+                if (transform::setKernel(k) != k) continue;
+                auto ns = bench::measure(repeat * count, [&](std::uint64_t) {
+                    for (std::uint64_t r = 0; r < repeat; r++) {
+                        if (mvp) transform::computeMVP(objects, time, viewProjection, out.data());
+                        else transform::computeModels(objects, time, out.data());
+                        bench::doNotOptimize(out[0]);
+                    }
+                });
+                float maxError = 0;
+                for (std::size_t e = 0; e < out.size(); e++) {
+                    maxError = std::max(maxError, std::abs(out[e] - reference[e]));
+                }
+                bench::report(std::string{"soa "} + transform::kernelName(k) + (mvp ? " (mvp)" : " (model)"), ns,
+                              "speedup " + bench::fixed(glmNs / ns) + "x, max |err| " + bench::fixed(maxError, 6));
+            }
+            transform::setKernel(transform::detectKernel());
+        }
+    }
+    return 0;
+}
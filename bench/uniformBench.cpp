@@ -0,0 +1,78 @@
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glStub.hpp"
+#include "benchCommon.hpp"
+#include "../src/shader/shader.hpp"
+
+#include <string>
+#include <vector>
+
+// Per-draw CPU cost of setting the cube scene's uniforms (model changes every draw, view does not).
+auto main() -> int {
+    bench::glStub::install();
+    bench::glStub::declareUniforms({
+                                           {"model",      GL_FLOAT_MAT4},
+                                           {"view",       GL_FLOAT_MAT4},
+                                           {"projection", GL_FLOAT_MAT4},
+                                           {"texture1",   GL_SAMPLER_2D},
+                                           {"texture2",   GL_SAMPLER_2D},
+                                   });
+
+    const char *vPath = STATIC_FILE_PATH"/static/shader/vertexShader.vert";
+    const char *fPath = STATIC_FILE_PATH"/static/shader/fragmentShader.frag";
+    shader::ShaderProgram program{};
+    program
+            .add(shader::Shader{vPath, GL_VERTEX_SHADER})
+            .add(shader::Shader{fPath, GL_FRAGMENT_SHADER})
+            .load();
+    program.use();
+
+    constexpr std::uint64_t draws = 2'000'000;
+    std::vector<glm::mat4> models(64);
+    for (std::size_t i = 0; i < models.size(); i++) {
+        models[i] = glm::translate(glm::mat4{1}, glm::vec3{(float) i, 0, 0});
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3{0, 0, 3}, glm::vec3{0, 0, 2}, glm::vec3{0, 1, 0});
+
+    auto run = [&](std::string_view name, auto &&draw) {
+        bench::glStub::reset();
+        auto ns = bench::measure(draws, [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                draw(models[i % models.size()]);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
+        });
+        auto perDraw = (double) bench::glStub::totalCalls() / (double) draws;
+        bench::report(name, ns, "gl calls/draw: " + bench::fixed(perDraw));
+    };
+
+    auto programID = program.getProgram();
+    run("glGetUniformLocation per call", [&](const glm::mat4 &model) {
+        auto modelLoc = glGetUniformLocation(programID, std::string{"model"}.c_str());
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        auto viewLoc = glGetUniformLocation(programID, std::string{"view"}.c_str());
+        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    });
+
+    run("setTrans(std::string)", [&](const glm::mat4 &model) {
+        program.setTrans("model", model);
+        program.setTrans("view", view);
+    });
+
+    using namespace shader::literals;
+    run("set(\"name\"_u)", [&](const glm::mat4 &model) {
+        program.set("model"_u, model);
+        program.set("view"_u, view);
+    });
+
+    auto modelUniform = program.uniform<glm::mat4>("model"_u);
+    auto viewUniform = program.uniform<glm::mat4>("view"_u);
+    run("set(Uniform<mat4>)", [&](const glm::mat4 &model) {
+        program.set(modelUniform, model);
+        program.set(viewUniform, view);
+    });
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include "jobSystem.hpp"
+
+#include <array>
+
+namespace job {
+
+    struct queuedJob {
+        std::function<void()> task;
+        counter *done;
+    };
+
+    // Chase-Lev deque of fixed capacity: the owner pushes and pops at the bottom, thieves take from the top
+    // and only contend with the owner for the very last job.
+    class JobSystem::WorkDeque {
+    public:
+        static constexpr std::int64_t capacity = 4096;
+
+        // owner only; false when full
+        auto push(queuedJob *task) -> bool {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.load(std::memory_order_acquire);
+            if (b - t >= capacity) return false;
+            slots[b & (capacity - 1)].store(task, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_release);
+            return true;
+        }
+
+        // owner only
+        auto pop() -> queuedJob * {
+            auto b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = top.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            auto *task = slots[b & (capacity - 1)].load(std::memory_order_relaxed);
+            if (t == b) {
+                // last job: race the thieves for it
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    task = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        // any thread
+        auto steal() -> queuedJob * {
+            auto t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+            auto *task = slots[t & (capacity - 1)].load(std::memory_order_acquire);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return task;
+        }
+
+    private:
+        alignas(64) std::atomic<std::int64_t> top{0};
+        alignas(64) std::atomic<std::int64_t> bottom{0};
+        std::array<std::atomic<queuedJob *>, capacity> slots{};
+    };
+
+    namespace {
+        struct threadSlot {
+            const JobSystem *system = nullptr;
+            int index = -1;
+        };
+
+        thread_local threadSlot localThread;
+    }
+
+    JobSystem::JobSystem(unsigned int workers) {
+        for (unsigned int i = 0; i <= workers; i++) deques.push_back(std::make_unique<WorkDeque>());
+        localThread = {this, 0};
+        for (unsigned int i = 1; i <= workers; i++) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    JobSystem::~JobSystem() {
+        // whatever is still queued runs here, so no counter is left waiting
+        while (auto *task = findJob(threadIndex())) execute(task);
+        {
+            std::lock_guard lock{sleepMutex};
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (auto &thread: threads) thread.join();
+        if (localThread.system == this) localThread = {};
+    }
+
+    auto JobSystem::run(std::function<void()> task, counter *done, counter *after) -> void {
+        auto *queued = new queuedJob{std::move(task), done};
+        if (done) done->pending.fetch_add(1, std::memory_order_relaxed);
+        if (after) {
+            std::lock_guard lock{after->waitingMutex};
+            if (!after->finished()) {
+                after->waiting.push_back(queued);
+                return;
+            }
+        }
+        submit(queued);
+    }
+
+    auto JobSystem::parallelFor(std::size_t count, std::size_t grain,
+                                const std::function<void(std::size_t, std::size_t)> &fn, counter *done) -> void {
+        if (count == 0) return;
+        grain = std::max<std::size_t>(grain, 1);
+        counter local;
+        auto *target = done ? done : &local;
+        // chunks may outlive the caller's fn when done is given
+        auto shared = std::make_shared<std::function<void(std::size_t, std::size_t)>>(fn);
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            auto end = std::min(count, begin + grain);
+            run([shared, begin, end] { (*shared)(begin, end); }, target);
+        }
+        if (!done) wait(local);
+    }
+
+    auto JobSystem::wait(counter &done) -> void {
+        auto index = threadIndex();
+        while (!done.finished()) {
+            if (auto *task = findJob(index)) {
+                execute(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        // the last job may still be releasing the counter's lock
+        std::lock_guard lock{done.waitingMutex};
+    }
+
+    auto JobSystem::concurrency() const -> unsigned int {
+        return (unsigned int) deques.size();
+    }
+
+    auto JobSystem::threadIndex() const -> int {
+        return localThread.system == this ? localThread.index : -1;
+    }
+
+    auto JobSystem::workerLoop(unsigned int index) -> void {
+        localThread = {this, (int) index};
+        while (!stopping.load(std::memory_order_relaxed)) {
+            auto seen = pushes.load();
+            if (auto *task = findJob((int) index)) {
+                execute(task);
+                continue;
+            }
+            std::unique_lock lock{sleepMutex};
+            sleeping.fetch_add(1);
+            if (pushes.load() == seen && !stopping.load()) wake.wait(lock);
+            sleeping.fetch_sub(1);
+        }
+    }
+
+    auto JobSystem::submit(queuedJob *task) -> void {
+        auto index = threadIndex();
+        if (index < 0 || !deques[index]->push(task)) {
+            std::lock_guard lock{injectionMutex};
+            injection.push_back(task);
+            injected.fetch_add(1, std::memory_order_release);
+        }
+        notify();
+    }
+
+    auto JobSystem::findJob(int index) -> queuedJob * {
+        if (index >= 0) {
+            if (auto *task = deques[index]->pop()) return task;
+        }
+        if (injected.load(std::memory_order_acquire) > 0) {
+            std::lock_guard lock{injectionMutex};
+            if (!injection.empty()) {
+                auto *task = injection.back();
+                injection.pop_back();
+                injected.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        auto count = (int) deques.size();
+        for (int i = 1; i <= count; i++) {
+            auto victim = (std::max(index, 0) + i) % count;
+            if (victim == index) continue;
+            if (auto *task = deques[victim]->steal()) return task;
+        }
+        return nullptr;
+    }
+
+    auto JobSystem::execute(queuedJob *task) -> void {
+        task->task();
+        if (auto *done = task->done) {
+            std::vector<queuedJob *> ready;
+            {
+                std::lock_guard lock{done->waitingMutex};
+                if (done->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) ready.swap(done->waiting);
+            }
+            for (auto *next: ready) submit(next);
+        }
+        delete task;
+    }
+
+    auto JobSystem::notify() -> void {
+        pushes.fetch_add(1);
+        if (sleeping.load() > 0) {
+            std::lock_guard lock{sleepMutex};
+            wake.notify_one();
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace job {
+
+    struct queuedJob;
+
+    // Counts unfinished jobs. Jobs started with it as `done` increment it when submitted and decrement it when
+    // they return; jobs started with it as `after` are held until it drops to zero. Only destroy a counter
+    // after JobSystem::wait() on it returned.
+    struct counter {
+        std::atomic<std::uint32_t> pending{0};
+        std::mutex waitingMutex;
+        std::vector<queuedJob *> waiting;
+
+        [[nodiscard]] auto finished() const -> bool {
+            return pending.load(std::memory_order_acquire) == 0;
+        }
+    };
+
+    // Work-stealing scheduler. Every worker owns a Chase-Lev deque: it pushes and pops its own jobs at the
+    // bottom while idle workers steal from the top. The thread that created the system owns a deque too and
+    // works through wait(); other threads submit through a shared injection queue. Idle workers sleep.
+    class JobSystem {
+    public:
+        // the creating thread is one of the participants, so workers counts the extra threads
+        explicit JobSystem(unsigned int workers = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+        JobSystem(const JobSystem &) = delete;
+
+        auto operator=(const JobSystem &) -> JobSystem & = delete;
+
+        ~JobSystem();
+
+        auto run(std::function<void()> task, counter *done = nullptr, counter *after = nullptr) -> void;
+
+        // fn(begin, end) over [0, count) in chunks of at most grain; waits when done is null
+        auto parallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)> &fn,
+                         counter *done = nullptr) -> void;
+
+        // runs queued jobs on the calling thread until the counter reaches zero
+        auto wait(counter &done) -> void;
+
+        // worker threads plus the creating thread
+        [[nodiscard]] auto concurrency() const -> unsigned int;
+
+        // index of the calling thread's deque (0 is the creating thread), -1 for outside threads
+        [[nodiscard]] auto threadIndex() const -> int;
+
+    private:
+        class WorkDeque;
+
+        std::vector<std::unique_ptr<WorkDeque>> deques;
+        std::vector<std::thread> threads;
+
+        std::mutex injectionMutex;
+        std::vector<queuedJob *> injection;
+        std::atomic<std::size_t> injected{0};
+
+        // bumped on every push; a worker only sleeps if it has not moved since the worker last looked for work
+        std::atomic<std::uint64_t> pushes{0};
+        std::atomic<unsigned int> sleeping{0};
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        std::atomic<bool> stopping{false};
+
+        auto workerLoop(unsigned int index) -> void;
+
+        auto submit(queuedJob *task) -> void;
+
+        auto findJob(int index) -> queuedJob *;
+
+        auto execute(queuedJob *task) -> void;
+
+        auto notify() -> void;
+    };
+}
@@ -0,0 +1,343 @@
+#include <glad/glad.h>
+
+#include "mesh.hpp"
+#include "../render/glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace mesh {
+
+    namespace {
+        struct vertexHash {
+            auto operator()(const vertex &v) const -> std::size_t {
+                std::uint64_t hash = 14695981039346656037ull;
+                auto *bytes = (const unsigned char *) &v;
+                for (std::size_t i = 0; i < sizeof(vertex); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+                return (std::size_t) hash;
+            }
+        };
+
+        struct vertexEqual {
+            auto operator()(const vertex &a, const vertex &b) const -> bool {
+                return std::memcmp(&a, &b, sizeof(vertex)) == 0;
+            }
+        };
+
+        // Forsyth's tuning: the last triangle's vertices score flat, older entries decay, and vertices
+        // with few triangles left get a boost so they are finished off instead of stranded
+        constexpr int forsythCacheSize = 32;
+
+        auto vertexScore(int cachePosition, std::uint32_t liveTriangles) -> float {
+            if (liveTriangles == 0) return -1;
+            float score = 0;
+            if (cachePosition >= 0) {
+                score = cachePosition < 3 ? 0.75f
+                                          : std::pow(1.0f - (float) (cachePosition - 3) / (forsythCacheSize - 3), 1.5f);
+            }
+            return score + 2.0f * std::pow((float) liveTriangles, -0.5f);
+        }
+
+        auto encodeOctahedral(glm::vec3 normal) -> glm::vec2 {
+            normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) + 1e-20f;
+            glm::vec2 folded{normal.x, normal.y};
+            if (normal.z < 0) {
+                folded = {(1 - std::abs(normal.y)) * (normal.x >= 0 ? 1.0f : -1.0f),
+                          (1 - std::abs(normal.x)) * (normal.y >= 0 ? 1.0f : -1.0f)};
+            }
+            return folded;
+        }
+
+        auto put(unsigned char *&out, const void *data, std::size_t bytes, std::size_t padded) -> void {
+            std::memcpy(out, data, bytes);
+            std::memset(out + bytes, 0, padded - bytes);
+            out += padded;
+        }
+    }
+
+    auto vertexFormat::stride() const -> std::size_t {
+        std::size_t bytes = position == positionFormat::float32 ? 12 : 8;
+        if (normal == normalFormat::float32) bytes += 12;
+        if (normal == normalFormat::octahedral16) bytes += 4;
+        bytes += uv == uvFormat::float32 ? 8 : 4;
+        return bytes;
+    }
+
+    auto weld(const std::vector<vertex> &triangles) -> meshData {
+        meshData data;
+        std::unordered_map<vertex, std::uint32_t, vertexHash, vertexEqual> unique;
+        unique.reserve(triangles.size());
+        data.indices.reserve(triangles.size());
+        for (const auto &corner: triangles) {
+            auto [found, inserted] = unique.try_emplace(corner, (std::uint32_t) data.vertices.size());
+            if (inserted) data.vertices.push_back(corner);
+            data.indices.push_back(found->second);
+        }
+        return data;
+    }
+
+    auto optimizeVertexCache(std::vector<std::uint32_t> &indices, std::size_t vertexCount) -> void {
+        auto triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        // per vertex: its not yet emitted triangles, live ones first in adjacency[offset[v], offset[v] + live[v])
+        std::vector<std::uint32_t> live(vertexCount), offset(vertexCount + 1), adjacency(triangleCount * 3);
+        for (auto index: indices) live[index]++;
+        for (std::size_t v = 0; v < vertexCount; v++) offset[v + 1] = offset[v] + live[v];
+        {
+            auto cursor = offset;
+            for (std::size_t i = 0; i < triangleCount * 3; i++) adjacency[cursor[indices[i]]++] = (std::uint32_t) (i / 3);
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> score(vertexCount), triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount);
+        for (std::size_t v = 0; v < vertexCount; v++) score[v] = vertexScore(-1, live[v]);
+        for (std::size_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+        }
+
+        std::vector<std::uint32_t> cache, nextCache, result;
+        result.reserve(indices.size());
+        constexpr auto none = std::numeric_limits<std::size_t>::max();
+        auto best = (std::size_t) (std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+        std::size_t scanCursor = 0;
+
+        while (result.size() < indices.size()) {
+            if (best == none) {
+                // nothing left around the cache, continue with the next untouched triangle
+                while (emitted[scanCursor]) scanCursor++;
+                best = scanCursor;
+            }
+            const auto *triangle = &indices[best * 3];
+            emitted[best] = true;
+            nextCache.assign(triangle, triangle + 3);
+            for (int corner = 0; corner < 3; corner++) {
+                auto v = triangle[corner];
+                result.push_back(v);
+                auto *first = &adjacency[offset[v]], *last = first + live[v];
+                std::iter_swap(std::find(first, last, (std::uint32_t) best), last - 1);
+                live[v]--;
+            }
+            for (auto v: cache) {
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) nextCache.push_back(v);
+            }
+            cache.swap(nextCache);
+
+            for (std::size_t i = 0; i < cache.size(); i++) {
+                auto v = cache[i];
+                cachePosition[v] = i < (std::size_t) forsythCacheSize ? (int) i : -1;
+                score[v] = vertexScore(cachePosition[v], live[v]);
+            }
+            best = none;
+            float bestScore = -1;
+            for (auto v: cache) {
+                for (auto a = offset[v]; a < offset[v] + live[v]; a++) {
+                    auto t = adjacency[a];
+                    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            if (cache.size() > (std::size_t) forsythCacheSize) cache.resize(forsythCacheSize);
+        }
+        indices.swap(result);
+    }
+
+    auto optimizeVertexFetch(meshData &data) -> void {
+        constexpr auto unused = std::numeric_limits<std::uint32_t>::max();
+        std::vector<std::uint32_t> remap(data.vertices.size(), unused);
+        std::vector<vertex> ordered;
+        ordered.reserve(data.vertices.size());
+        for (auto &index: data.indices) {
+            if (remap[index] == unused) {
+                remap[index] = (std::uint32_t) ordered.size();
+                ordered.push_back(data.vertices[index]);
+            }
+            index = remap[index];
+        }
+        data.vertices.swap(ordered);
+    }
+
+    auto acmr(const std::vector<std::uint32_t> &indices, std::size_t cacheSize) -> float {
+        if (indices.size() < 3) return 0;
+        auto vertexCount = (std::size_t) *std::max_element(indices.begin(), indices.end()) + 1;
+        // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+        constexpr auto never = std::numeric_limits<std::size_t>::max();
+        std::vector<std::size_t> loadedAt(vertexCount, never);
+        std::size_t misses = 0;
+        for (auto index: indices) {
+            if (loadedAt[index] == never || misses - loadedAt[index] >= cacheSize) loadedAt[index] = misses++;
+        }
+        return (float) misses / (float) (indices.size() / 3);
+    }
+
+
+    Mesh::Mesh(const std::vector<vertex> &triangles, vertexFormat format, attributeLocations locations,
+               const lodOptions &lods) {
+        auto data = weld(triangles);
+        vertexFormat unpacked{positionFormat::float32,
+                              format.normal == normalFormat::none ? normalFormat::none : normalFormat::float32,
+                              uvFormat::float32};
+        stats.vertexCountBefore = triangles.size();
+        stats.vertexBytesBefore = triangles.size() * unpacked.stride();
+        stats.acmrBefore = acmr(data.indices);
+
+        optimizeVertexCache(data.indices, data.vertices.size());
+        optimizeVertexFetch(data);
+        stats.vertexCountAfter = data.vertices.size();
+        stats.vertexBytesAfter = data.vertices.size() * format.stride();
+        stats.acmrAfter = acmr(data.indices);
+
+        glm::vec3 low{std::numeric_limits<float>::max()}, high{std::numeric_limits<float>::lowest()};
+        for (const auto &v: data.vertices) {
+            low = glm::min(low, v.position);
+            high = glm::max(high, v.position);
+        }
+        if (!data.vertices.empty()) {
+            center = (low + high) * 0.5f;
+            extent = glm::max((high - low) * 0.5f, glm::vec3{1e-6f});
+        }
+        quantizedPositions = format.position == positionFormat::snorm16;
+        auto bytes = encode(data.vertices, format, center, extent);
+
+        auto &state = render::GLState::current();
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        state.bindVertexArray(vao);
+        state.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) bytes.size(), bytes.data(), GL_STATIC_DRAW);
+
+        std::vector<std::uint32_t> indices;
+        lodLevels = buildLods(data, lods, indices);
+        state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        if (data.vertices.size() <= 65536) {
+            std::vector<std::uint16_t> shortIndices(indices.begin(), indices.end());
+            indexType = GL_UNSIGNED_SHORT;
+            stats.indexBytes = shortIndices.size() * sizeof(std::uint16_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) stats.indexBytes, shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            indexType = GL_UNSIGNED_INT;
+            stats.indexBytes = indices.size() * sizeof(std::uint32_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) stats.indexBytes, indices.data(), GL_STATIC_DRAW);
+        }
+        PROFILE_COUNT(uploadedBytes, bytes.size() + stats.indexBytes);
+
+        auto stride = (GLsizei) format.stride();
+        std::size_t attributeOffset = 0;
+        auto attribute = [&](GLuint location, GLint components, GLenum type, GLboolean normalized, std::size_t bytes) {
+            glVertexAttribPointer(location, components, type, normalized, stride, (void *) attributeOffset);
+            glEnableVertexAttribArray(location);
+            attributeOffset += bytes;
+        };
+        switch (format.position) {
+            case positionFormat::float32: attribute(locations.position, 3, GL_FLOAT, GL_FALSE, 12); break;
+            case positionFormat::half16: attribute(locations.position, 3, GL_HALF_FLOAT, GL_FALSE, 8); break;
+            case positionFormat::snorm16: attribute(locations.position, 3, GL_SHORT, GL_TRUE, 8); break;
+        }
+        switch (format.normal) {
+            case normalFormat::none: break;
+            case normalFormat::float32: attribute(locations.normal, 3, GL_FLOAT, GL_FALSE, 12); break;
+            // the vertex shader unfolds the octahedron
+            case normalFormat::octahedral16: attribute(locations.normal, 2, GL_SHORT, GL_TRUE, 4); break;
+        }
+        switch (format.uv) {
+            case uvFormat::float32: attribute(locations.uv, 2, GL_FLOAT, GL_FALSE, 8); break;
+            case uvFormat::half16: attribute(locations.uv, 2, GL_HALF_FLOAT, GL_FALSE, 4); break;
+            case uvFormat::unorm16: attribute(locations.uv, 2, GL_UNSIGNED_SHORT, GL_TRUE, 4); break;
+        }
+        state.bindVertexArray(0);
+    }
+
+    Mesh::~Mesh() {
+        auto &state = render::GLState::current();
+        glDeleteVertexArrays(1, &vao);
+        state.deletedVertexArray(vao);
+        unsigned int buffers[] = {vbo, ebo};
+        glDeleteBuffers(2, buffers);
+        for (auto buffer: buffers) state.deletedBuffer(buffer);
+    }
+
+    auto Mesh::drawable(std::size_t level) const -> render::mesh {
+        const auto &range = lodLevels[std::min(level, lodLevels.size() - 1)];
+        return render::mesh{vao, (GLsizei) range.indexCount, GL_TRIANGLES, indexType, range.firstIndex};
+    }
+
+    auto Mesh::levels() const -> const std::vector<lodLevel> & {
+        return lodLevels;
+    }
+
+    auto Mesh::dequantize() const -> glm::mat4 {
+        if (!quantizedPositions) return glm::mat4{1};
+        return glm::scale(glm::translate(glm::mat4{1}, center), extent);
+    }
+
+    auto Mesh::statistics() const -> const meshStatistics & {
+        return stats;
+    }
+
+    auto Mesh::encode(const std::vector<vertex> &vertices, const vertexFormat &format, const glm::vec3 &center,
+                      const glm::vec3 &extent) -> std::vector<unsigned char> {
+        std::vector<unsigned char> bytes(vertices.size() * format.stride());
+        auto *out = bytes.data();
+        for (const auto &v: vertices) {
+            switch (format.position) {
+                case positionFormat::float32:
+                    put(out, &v.position, 12, 12);
+                    break;
+                case positionFormat::half16: {
+                    std::uint16_t packed[3] = {glm::packHalf1x16(v.position.x), glm::packHalf1x16(v.position.y),
+                                               glm::packHalf1x16(v.position.z)};
+                    put(out, packed, 6, 8);
+                    break;
+                }
+                case positionFormat::snorm16: {
+                    auto unit = (v.position - center) / extent;
+                    std::uint16_t packed[3] = {glm::packSnorm1x16(unit.x), glm::packSnorm1x16(unit.y),
+                                               glm::packSnorm1x16(unit.z)};
+                    put(out, packed, 6, 8);
+                    break;
+                }
+            }
+            switch (format.normal) {
+                case normalFormat::none:
+                    break;
+                case normalFormat::float32:
+                    put(out, &v.normal, 12, 12);
+                    break;
+                case normalFormat::octahedral16: {
+                    auto folded = encodeOctahedral(v.normal);
+                    std::uint16_t packed[2] = {glm::packSnorm1x16(folded.x), glm::packSnorm1x16(folded.y)};
+                    put(out, packed, 4, 4);
+                    break;
+                }
+            }
+            switch (format.uv) {
+                case uvFormat::float32:
+                    put(out, &v.uv, 8, 8);
+                    break;
+                case uvFormat::half16: {
+                    std::uint16_t packed[2] = {glm::packHalf1x16(v.uv.x), glm::packHalf1x16(v.uv.y)};
+                    put(out, packed, 4, 4);
+                    break;
+                }
+                case uvFormat::unorm16: {
+                    std::uint16_t packed[2] = {glm::packUnorm1x16(v.uv.x), glm::packUnorm1x16(v.uv.y)};
+                    put(out, packed, 4, 4);
+                    break;
+                }
+            }
+        }
+        return bytes;
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "meshLod.hpp"
+#include "../render/instanceBatch.hpp"
+
+namespace mesh {
+
+    struct vertex {
+        glm::vec3 position{0};
+        glm::vec3 normal{0};
+        glm::vec2 uv{0};
+    };
+    static_assert(sizeof(vertex) == 32, "vertices are welded by their bytes");
+
+    enum class positionFormat {
+        float32,
+        half16,
+        // relative to the bounding box, Mesh::dequantize() maps them back and belongs in the model matrix
+        snorm16
+    };
+
+    enum class normalFormat {
+        none,
+        float32,
+        // octahedral projection into two snorm16
+        octahedral16
+    };
+
+    enum class uvFormat {
+        float32,
+        half16,
+        // only for uvs inside [0, 1], anything outside is clamped
+        unorm16
+    };
+
+    // Interleaved layout, every attribute starting on a 4-byte boundary.
+    struct vertexFormat {
+        positionFormat position = positionFormat::float32;
+        normalFormat normal = normalFormat::none;
+        uvFormat uv = uvFormat::float32;
+
+        [[nodiscard]] auto stride() const -> std::size_t;
+    };
+
+    struct attributeLocations {
+        GLuint position = 0;
+        GLuint normal = 1;
+        GLuint uv = 2;
+    };
+
+    struct meshData {
+        std::vector<vertex> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    struct meshStatistics {
+        std::size_t vertexCountBefore{}, vertexCountAfter{};
+        std::size_t vertexBytesBefore{}, vertexBytesAfter{};
+        std::size_t indexBytes{};          // every level of detail
+        float acmrBefore{}, acmrAfter{};
+    };
+
+    // one vertex per triangle corner in, unique vertices plus an index list out
+    auto weld(const std::vector<vertex> &triangles) -> meshData;
+
+    // Forsyth's linear-speed reordering of triangles for the post-transform vertex cache
+    auto optimizeVertexCache(std::vector<std::uint32_t> &indices, std::size_t vertexCount) -> void;
+
+    // renumbers vertices in order of first use so the vertex fetch walks memory forward
+    auto optimizeVertexFetch(meshData &data) -> void;
+
+    // average cache miss ratio: transformed vertices per triangle with a FIFO cache of cacheSize entries
+    auto acmr(const std::vector<std::uint32_t> &indices, std::size_t cacheSize = 16) -> float;
+
+    // Welded, optimized and quantized triangle list in its own VAO with an element buffer. Levels of detail
+    // share the vertices and follow level 0 in the element buffer, each its own drawable for instancing.
+    class Mesh {
+    public:
+        explicit Mesh(const std::vector<vertex> &triangles, vertexFormat format = {},
+                      attributeLocations locations = {}, const lodOptions &lods = {});
+
+        Mesh(const Mesh &) = delete;
+
+        auto operator=(const Mesh &) -> Mesh & = delete;
+
+        ~Mesh();
+
+        [[nodiscard]] auto drawable(std::size_t level = 0) const -> render::mesh;
+
+        [[nodiscard]] auto levels() const -> const std::vector<lodLevel> &;
+
+        // identity unless positions are snorm16
+        [[nodiscard]] auto dequantize() const -> glm::mat4;
+
+        [[nodiscard]] auto statistics() const -> const meshStatistics &;
+
+        // the interleaved vertex bytes as uploaded, mostly for tools and benchmarks
+        static auto encode(const std::vector<vertex> &vertices, const vertexFormat &format,
+                           const glm::vec3 &center, const glm::vec3 &extent) -> std::vector<unsigned char>;
+
+    private:
+        unsigned int vao{}, vbo{}, ebo{};
+        std::vector<lodLevel> lodLevels{};
+        GLenum indexType{};
+        glm::vec3 center{0}, extent{1};
+        bool quantizedPositions = false;
+        meshStatistics stats{};
+    };
+}
@@ -0,0 +1,297 @@
+#include "meshLod.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace mesh {
+
+    namespace {
+        // position, normal and uv, scaled so one quadric measures all of them
+        constexpr int dimensions = 8;
+        using point = std::array<double, dimensions>;
+
+        auto dot(const point &a, const point &b) -> double {
+            double sum = 0;
+            for (int i = 0; i < dimensions; i++) sum += a[i] * b[i];
+            return sum;
+        }
+
+        // error(v) = (v'Av + 2b'v + c) / weight, A symmetric and stored as its upper triangle; weight is the
+        // area summed in, so the error stays a squared distance however many triangles contributed
+        struct quadric {
+            std::array<double, dimensions * (dimensions + 1) / 2> a{};
+            point b{};
+            double c{};
+            double weight{};
+
+            // squared distance to the plane of the triangle in the 8-dimensional space, times weight
+            static auto triangle(const point &p0, const point &p1, const point &p2, double weight) -> quadric {
+                point e1, e2;
+                for (int i = 0; i < dimensions; i++) e1[i] = p1[i] - p0[i];
+                auto length = std::sqrt(dot(e1, e1));
+                if (length > 0) for (auto &x: e1) x /= length;
+                for (int i = 0; i < dimensions; i++) e2[i] = p2[i] - p0[i];
+                auto along = dot(e2, e1);
+                for (int i = 0; i < dimensions; i++) e2[i] -= along * e1[i];
+                length = std::sqrt(dot(e2, e2));
+                if (length > 0) for (auto &x: e2) x /= length;
+
+                quadric q;
+                auto d1 = dot(p0, e1), d2 = dot(p0, e2);
+                for (int i = 0, k = 0; i < dimensions; i++) {
+                    for (int j = i; j < dimensions; j++, k++) {
+                        q.a[k] = weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+                    }
+                    q.b[i] = weight * (d1 * e1[i] + d2 * e2[i] - p0[i]);
+                }
+                q.c = weight * (dot(p0, p0) - d1 * d1 - d2 * d2);
+                q.weight = weight;
+                return q;
+            }
+
+            auto operator+=(const quadric &other) -> quadric & {
+                for (std::size_t k = 0; k < a.size(); k++) a[k] += other.a[k];
+                for (int i = 0; i < dimensions; i++) b[i] += other.b[i];
+                c += other.c;
+                weight += other.weight;
+                return *this;
+            }
+
+            [[nodiscard]] auto error(const point &v) const -> double {
+                double sum = c;
+                for (int i = 0, k = 0; i < dimensions; i++) {
+                    sum += 2 * b[i] * v[i] + a[k++] * v[i] * v[i];
+                    for (int j = i + 1; j < dimensions; j++) sum += 2 * a[k++] * v[i] * v[j];
+                }
+                return weight > 0 ? std::max(sum, 0.0) / weight : 0.0;
+            }
+        };
+
+        // Collapses edges in order of quadric error. Vertices only ever move onto neighbours, so the
+        // current triangles can be read out at any point as indices into the original vertices.
+        class Simplifier {
+        public:
+            Simplifier(const meshData &data, const simplifyOptions &options) : data(data) {
+                auto vertexCount = data.vertices.size();
+                glm::vec3 low{std::numeric_limits<float>::max()}, high{std::numeric_limits<float>::lowest()};
+                for (const auto &v: data.vertices) {
+                    low = glm::min(low, v.position);
+                    high = glm::max(high, v.position);
+                }
+                center = (low + high) * 0.5f;
+                radius = vertexCount ? std::max(glm::length(high - low) * 0.5f, 1e-6f) : 1.0f;
+                points.resize(vertexCount);
+                for (std::size_t i = 0; i < vertexCount; i++) {
+                    const auto &v = data.vertices[i];
+                    auto position = (v.position - center) / radius;
+                    auto normal = v.normal * options.normalWeight;
+                    auto uv = v.uv * options.uvWeight;
+                    points[i] = {position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y};
+                }
+
+                triangles = data.indices;
+                alive.assign(triangles.size() / 3, true);
+                liveTriangles = alive.size();
+                quadrics.resize(vertexCount);
+                vertexTriangles.resize(vertexCount);
+                for (std::uint32_t t = 0; t < alive.size(); t++) {
+                    const auto *corner = &triangles[t * 3];
+                    const auto &p0 = data.vertices[corner[0]].position, &p1 = data.vertices[corner[1]].position,
+                            &p2 = data.vertices[corner[2]].position;
+                    auto area = (double) glm::length(glm::cross(p1 - p0, p2 - p0)) * 0.5 / (radius * radius);
+                    auto q = quadric::triangle(points[corner[0]], points[corner[1]], points[corner[2]], area);
+                    for (int c = 0; c < 3; c++) {
+                        quadrics[corner[c]] += q;
+                        vertexTriangles[corner[c]].push_back(t);
+                    }
+                }
+
+                // an edge used by one triangle (or more than two) is open: its vertices stay where they are
+                std::unordered_map<std::uint64_t, std::uint32_t> edgeUses;
+                edgeUses.reserve(triangles.size());
+                auto edge = [](std::uint32_t a, std::uint32_t b) {
+                    return (std::uint64_t) std::min(a, b) << 32 | std::max(a, b);
+                };
+                for (std::size_t i = 0; i < triangles.size(); i += 3) {
+                    for (int c = 0; c < 3; c++) edgeUses[edge(triangles[i + c], triangles[i + (c + 1) % 3])]++;
+                }
+                locked.assign(vertexCount, false);
+                for (const auto &[key, uses]: edgeUses) {
+                    if (uses == 2) continue;
+                    locked[key >> 32] = true;
+                    locked[key & 0xFFFFFFFFu] = true;
+                }
+                removed.assign(vertexCount, false);
+                version.assign(vertexCount, 0);
+                for (std::uint32_t v = 0; v < vertexCount; v++) pushEdges(v);
+            }
+
+            // returns false once nothing within reach can collapse
+            auto run(std::size_t targetTriangles) -> bool {
+                while (liveTriangles > targetTriangles) {
+                    if (candidates.empty()) return false;
+                    auto top = candidates.top();
+                    candidates.pop();
+                    if (removed[top.from] || removed[top.to] || version[top.from] != top.fromVersion ||
+                        version[top.to] != top.toVersion || !valid(top.from, top.to)) {
+                        continue;
+                    }
+                    collapse(top.from, top.to);
+                    maxCost = std::max(maxCost, top.cost);
+                }
+                return true;
+            }
+
+            [[nodiscard]] auto indices() const -> std::vector<std::uint32_t> {
+                std::vector<std::uint32_t> result;
+                result.reserve(liveTriangles * 3);
+                for (std::size_t t = 0; t < alive.size(); t++) {
+                    if (alive[t]) result.insert(result.end(), &triangles[t * 3], &triangles[t * 3 + 3]);
+                }
+                return result;
+            }
+
+            [[nodiscard]] auto triangleCount() const -> std::size_t {
+                return liveTriangles;
+            }
+
+            // the largest collapse so far, back in object units
+            [[nodiscard]] auto error() const -> float {
+                return (float) std::sqrt(maxCost) * radius;
+            }
+
+        private:
+            struct candidate {
+                double cost;
+                std::uint32_t from, to;
+                std::uint32_t fromVersion, toVersion;
+
+                auto operator>(const candidate &other) const -> bool { return cost > other.cost; }
+            };
+
+            const meshData &data;
+            glm::vec3 center{0};
+            float radius = 1;
+            std::vector<point> points;
+            std::vector<quadric> quadrics;
+            std::vector<std::uint32_t> triangles;
+            std::vector<bool> alive, locked, removed;
+            std::vector<std::vector<std::uint32_t>> vertexTriangles;
+            std::vector<std::uint32_t> version;
+            std::size_t liveTriangles{};
+            double maxCost = 0;
+            std::priority_queue<candidate, std::vector<candidate>, std::greater<>> candidates;
+
+            // both directions of every edge around v, as far as the moving end is free to move
+            auto pushEdges(std::uint32_t v) -> void {
+                for (auto t: vertexTriangles[v]) {
+                    if (!alive[t]) continue;
+                    for (int c = 0; c < 3; c++) {
+                        auto other = triangles[t * 3 + c];
+                        if (other == v) continue;
+                        if (!locked[v]) push(v, other);
+                        if (!locked[other]) push(other, v);
+                    }
+                }
+            }
+
+            auto push(std::uint32_t from, std::uint32_t to) -> void {
+                auto merged = quadrics[from];
+                merged += quadrics[to];
+                candidates.push({merged.error(points[to]), from, to, version[from], version[to]});
+            }
+
+            // moving from onto to must not turn any remaining triangle of from around
+            [[nodiscard]] auto valid(std::uint32_t from, std::uint32_t to) const -> bool {
+                const auto &target = data.vertices[to].position;
+                for (auto t: vertexTriangles[from]) {
+                    if (!alive[t]) continue;
+                    const auto *corner = &triangles[t * 3];
+                    if (corner[0] == to || corner[1] == to || corner[2] == to) continue;
+                    glm::vec3 before[3], after[3];
+                    for (int c = 0; c < 3; c++) {
+                        before[c] = data.vertices[corner[c]].position;
+                        after[c] = corner[c] == from ? target : before[c];
+                    }
+                    auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    if (glm::dot(normalBefore, normalAfter) <= 0) return false;
+                }
+                return true;
+            }
+
+            auto collapse(std::uint32_t from, std::uint32_t to) -> void {
+                for (auto t: vertexTriangles[from]) {
+                    if (!alive[t]) continue;
+                    auto *corner = &triangles[t * 3];
+                    if (corner[0] == to || corner[1] == to || corner[2] == to) {
+                        alive[t] = false;
+                        liveTriangles--;
+                        continue;
+                    }
+                    for (int c = 0; c < 3; c++) {
+                        if (corner[c] == from) corner[c] = to;
+                    }
+                    vertexTriangles[to].push_back(t);
+                }
+                auto &around = vertexTriangles[to];
+                around.erase(std::remove_if(around.begin(), around.end(), [this](std::uint32_t t) {
+                    return !alive[t];
+                }), around.end());
+                quadrics[to] += quadrics[from];
+                removed[from] = true;
+                std::vector<std::uint32_t>{}.swap(vertexTriangles[from]);
+                version[to]++;
+                pushEdges(to);
+            }
+        };
+    }
+
+    auto simplify(const meshData &data, std::size_t targetTriangles, float *error, const simplifyOptions &options)
+    -> std::vector<std::uint32_t> {
+        Simplifier simplifier{data, options};
+        simplifier.run(targetTriangles);
+        if (error) *error = simplifier.error();
+        return simplifier.indices();
+    }
+
+    auto buildLods(const meshData &data, const lodOptions &options, std::vector<std::uint32_t> &indices)
+    -> std::vector<lodLevel> {
+        indices = data.indices;
+        std::vector<lodLevel> levels{{0, (std::uint32_t) indices.size(), 0.0f}};
+        if (options.levels <= 1) return levels;
+
+        Simplifier simplifier{data, options.weights};
+        auto triangles = data.indices.size() / 3;
+        while (levels.size() < options.levels) {
+            auto target = (std::size_t) ((float) triangles * options.reduction);
+            if (target < options.minTriangles) break;
+            simplifier.run(target);
+            // a level that did not get meaningfully smaller is not worth its indices
+            if ((float) simplifier.triangleCount() > (float) triangles * (1.0f + options.reduction) * 0.5f) break;
+            auto level = simplifier.indices();
+            optimizeVertexCache(level, data.vertices.size());
+            levels.push_back({(std::uint32_t) indices.size(), (std::uint32_t) level.size(),
+                              std::max(levels.back().error, simplifier.error())});
+            indices.insert(indices.end(), level.begin(), level.end());
+            triangles = simplifier.triangleCount();
+        }
+        return levels;
+    }
+
+
+    LodSelector::LodSelector(const glm::mat4 &projection, int viewportHeight, float thresholdPixels)
+            : pixelsPerUnit(projection[1][1] * (float) viewportHeight * 0.5f / std::max(thresholdPixels, 1e-3f)) {}
+
+    auto LodSelector::select(const std::vector<lodLevel> &levels, float distance, float scale) const -> std::size_t {
+        for (auto level = levels.size() - 1; level > 0; level--) {
+            if (levels[level].error * scale * pixelsPerUnit <= distance) return level;
+        }
+        return 0;
+    }
+}
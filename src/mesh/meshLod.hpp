@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mesh {
+
+    struct meshData;
+
+    struct simplifyOptions {
+        // attribute weights in the quadric, positions are measured in units of the mesh's bounding radius
+        float normalWeight = 0.5f;
+        float uvWeight = 1.0f;
+    };
+
+    // one level of detail: its range in the mesh's shared index buffer and its deviation from level 0
+    struct lodLevel {
+        std::uint32_t firstIndex{}, indexCount{};
+        // object-space distance, attribute deviation included through the weights
+        float error{};
+    };
+
+    struct lodOptions {
+        // levels including the full mesh; 1 builds no LODs
+        std::size_t levels = 1;
+        // triangle count of each level relative to the previous one
+        float reduction = 0.5f;
+        // a level is dropped when it would have fewer triangles
+        std::size_t minTriangles = 32;
+        simplifyOptions weights{};
+    };
+
+    // Quadric error edge collapse (Garland-Heckbert with attributes: one quadric over position, normal and
+    // uv per vertex). A vertex collapses onto a neighbour and keeps no attributes of its own, so every level
+    // indexes data.vertices unchanged; vertices on open edges, which includes uv and normal seams once
+    // welded, never move. Collapses that would flip a triangle are skipped.
+    auto simplify(const meshData &data, std::size_t targetTriangles, float *error = nullptr,
+                  const simplifyOptions &options = {}) -> std::vector<std::uint32_t>;
+
+    // level 0 is data.indices itself, every further level continues collapsing where the previous stopped;
+    // stops early once the mesh no longer reaches the next triangle count. Indices are returned concatenated.
+    auto buildLods(const meshData &data, const lodOptions &options, std::vector<std::uint32_t> &indices)
+    -> std::vector<lodLevel>;
+
+    // Picks the coarsest level whose error covers at most threshold pixels on screen, from the projection
+    // and viewport height of the frame.
+    class LodSelector {
+    public:
+        LodSelector() = default;
+
+        LodSelector(const glm::mat4 &projection, int viewportHeight, float thresholdPixels = 1.0f);
+
+        // scale is the instance's largest axis scale, distance its distance to the eye
+        [[nodiscard]] auto select(const std::vector<lodLevel> &levels, float distance, float scale = 1.0f) const
+        -> std::size_t;
+
+    private:
+        // object units at distance 1 to pixels, over the threshold
+        float pixelsPerUnit = 0;
+    };
+}
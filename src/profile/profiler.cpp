@@ -0,0 +1,286 @@
+#include "profiler.hpp"
+
+#if LEARNOPENGL_PROFILER
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profile {
+
+    namespace {
+        constexpr std::size_t ringCapacity = 1 << 14;
+        constexpr std::size_t summaryWindow = 512;
+        constexpr std::size_t traceFrames = 300;
+        // queries of the current frame, the previous one and the one before it, which endFrame() reads
+        constexpr std::size_t gpuFrames = 3;
+
+        struct cpuEvent {
+            const char *name;
+            std::uint64_t begin, end;
+        };
+
+        struct gpuEvent {
+            const char *name;
+            std::uint64_t cpuBegin;
+            GLuint query;
+        };
+
+        struct traceEvent {
+            const char *name;
+            std::uint64_t begin, duration;
+            std::uint32_t thread;
+        };
+
+        struct frameRecord {
+            std::uint64_t begin, end;
+            std::vector<traceEvent> events;
+            std::array<std::uint64_t, (std::size_t) counter::count> counters;
+        };
+
+        // Written only by its own thread, drained only by the thread calling endFrame().
+        struct threadRing {
+            std::array<cpuEvent, ringCapacity> events{};
+            std::atomic<std::uint64_t> head{0}, tail{0}, dropped{0};
+            std::uint32_t thread = 0;
+
+            auto push(const cpuEvent &event) -> void {
+                auto h = head.load(std::memory_order_relaxed);
+                if (h - tail.load(std::memory_order_acquire) == ringCapacity) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                events[h % ringCapacity] = event;
+                head.store(h + 1, std::memory_order_release);
+            }
+
+            template<typename Visit>
+            auto drain(Visit &&visit) -> void {
+                auto t = tail.load(std::memory_order_relaxed);
+                auto h = head.load(std::memory_order_acquire);
+                for (; t != h; t++) visit(events[t % ringCapacity]);
+                tail.store(h, std::memory_order_release);
+            }
+        };
+
+        // The GPU track in the trace; CPU threads are numbered from 1.
+        constexpr std::uint32_t gpuThread = 0;
+
+        struct profilerState {
+            std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+            std::mutex ringsMutex;
+            std::vector<std::shared_ptr<threadRing>> rings;
+
+            std::array<std::atomic<std::uint64_t>, (std::size_t) counter::count> counters{};
+
+            // GL thread only
+            std::array<std::vector<gpuEvent>, gpuFrames> gpuPending{};
+            std::vector<GLuint> freeQueries;
+            bool gpuOpen = false;
+            std::uint64_t gpuLate = 0;
+
+            std::uint64_t frameIndex = 0, frameBegin = 0;
+            std::array<double, summaryWindow> frameMs{};
+            std::deque<frameRecord> history;
+            std::mutex historyMutex;
+
+            [[nodiscard]] auto now() const -> std::uint64_t {
+                return (std::uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - epoch).count();
+            }
+
+            auto ring() -> threadRing & {
+                thread_local std::shared_ptr<threadRing> local;
+                if (!local) {
+                    local = std::make_shared<threadRing>();
+                    std::lock_guard lock{ringsMutex};
+                    local->thread = (std::uint32_t) rings.size() + 1;
+                    rings.push_back(local);
+                }
+                return *local;
+            }
+
+            // results of the frame before last: by now they are normally available, and waiting is never an option
+            auto collectGpu(std::vector<traceEvent> &into) -> void {
+                auto &pending = gpuPending[(frameIndex + gpuFrames - 2) % gpuFrames];
+                for (const auto &event: pending) {
+                    GLint available = 0;
+                    glGetQueryObjectiv(event.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (available) {
+                        GLuint64 elapsed = 0;
+                        glGetQueryObjectui64v(event.query, GL_QUERY_RESULT, &elapsed);
+                        into.push_back({event.name, event.cpuBegin, elapsed, gpuThread});
+                    } else {
+                        gpuLate++;
+                    }
+                    freeQueries.push_back(event.query);
+                }
+                pending.clear();
+            }
+        };
+
+        auto state() -> profilerState & {
+            static profilerState instance;
+            return instance;
+        }
+
+        auto percentile(std::vector<double> &sorted, double fraction) -> double {
+            auto index = (std::size_t) (fraction * (double) (sorted.size() - 1) + 0.5);
+            return sorted[std::min(index, sorted.size() - 1)];
+        }
+    }
+
+    cpuScope::cpuScope(const char *name) : name(name), begin(state().now()) {}
+
+    cpuScope::~cpuScope() {
+        auto &profiler = state();
+        profiler.ring().push({name, begin, profiler.now()});
+    }
+
+    gpuScope::gpuScope(const char *name) {
+        auto &profiler = state();
+        // GL_TIME_ELAPSED queries cannot nest; an inner scope is simply not timed
+        if (profiler.gpuOpen) return;
+        GLuint query;
+        if (profiler.freeQueries.empty()) {
+            glGenQueries(1, &query);
+        } else {
+            query = profiler.freeQueries.back();
+            profiler.freeQueries.pop_back();
+        }
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        profiler.gpuPending[profiler.frameIndex % gpuFrames].push_back({name, profiler.now(), query});
+        profiler.gpuOpen = active = true;
+    }
+
+    gpuScope::~gpuScope() {
+        if (!active) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        state().gpuOpen = false;
+    }
+
+    auto count(counter which, std::uint64_t value) -> void {
+        state().counters[(std::size_t) which].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    auto endFrame() -> void {
+        auto &profiler = state();
+        auto end = profiler.now();
+
+        frameRecord frame{profiler.frameBegin, end, {}, {}};
+        for (std::size_t i = 0; i < frame.counters.size(); i++) {
+            frame.counters[i] = profiler.counters[i].exchange(0, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard lock{profiler.ringsMutex};
+            for (auto &ring: profiler.rings) {
+                ring->drain([&](const cpuEvent &event) {
+                    frame.events.push_back({event.name, event.begin, event.end - event.begin, ring->thread});
+                });
+            }
+        }
+        profiler.collectGpu(frame.events);
+
+        std::lock_guard lock{profiler.historyMutex};
+        profiler.frameMs[profiler.frameIndex % summaryWindow] = (double) (end - profiler.frameBegin) / 1e6;
+        profiler.history.push_back(std::move(frame));
+        if (profiler.history.size() > traceFrames) profiler.history.pop_front();
+        profiler.frameIndex++;
+        profiler.frameBegin = end;
+    }
+
+    auto shutdown() -> void {
+        auto &profiler = state();
+        for (auto &pending: profiler.gpuPending) {
+            for (const auto &event: pending) profiler.freeQueries.push_back(event.query);
+            pending.clear();
+        }
+        if (!profiler.freeQueries.empty()) {
+            glDeleteQueries((GLsizei) profiler.freeQueries.size(), profiler.freeQueries.data());
+        }
+        profiler.freeQueries.clear();
+    }
+
+    auto summary() -> frameSummary {
+        auto &profiler = state();
+        std::lock_guard lock{profiler.historyMutex};
+        auto frames = (std::size_t) std::min<std::uint64_t>(profiler.frameIndex, summaryWindow);
+        if (frames == 0) return {};
+        std::vector<double> sorted(profiler.frameMs.begin(), profiler.frameMs.begin() + (std::ptrdiff_t) frames);
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (auto ms: sorted) total += ms;
+        return {percentile(sorted, 0.50), percentile(sorted, 0.95), percentile(sorted, 0.99),
+                total / (double) frames, frames};
+    }
+
+    auto exportTrace(const char *path) -> bool {
+        std::ofstream out{path};
+        if (!out) {
+            std::cerr << "ERROR::PROFILE::TRACE_NOT_WRITABLE: " << path << std::endl;
+            return false;
+        }
+        auto &profiler = state();
+        std::lock_guard lock{profiler.historyMutex};
+
+        // Chrome trace event format, timestamps in microseconds
+        auto us = [](std::uint64_t ns) { return (double) ns / 1e3; };
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        std::size_t threads;
+        std::uint64_t dropped = 0;
+        {
+            std::lock_guard ringsLock{profiler.ringsMutex};
+            threads = profiler.rings.size();
+            for (const auto &ring: profiler.rings) dropped += ring->dropped.load(std::memory_order_relaxed);
+        }
+        // events lost to full rings and GPU results not ready in time, so a sparse trace explains itself
+        out << R"({"displayTimeUnit":"ms","otherData":{"droppedEvents":)" << dropped
+            << ",\"lateGpuQueries\":" << profiler.gpuLate << "},\"traceEvents\":[\n";
+        out << R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"GPU"}})";
+        for (std::size_t thread = 1; thread <= threads; thread++) {
+            out << ",\n" << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << thread
+                << R"(,"args":{"name":"CPU )" << thread << "\"}}";
+        }
+        for (const auto &frame: profiler.history) {
+            out << ",\n" << R"({"name":"frame","ph":"X","pid":1,"tid":1,"ts":)" << us(frame.begin)
+                << ",\"dur\":" << us(frame.end - frame.begin) << "}";
+            for (const auto &event: frame.events) {
+                out << ",\n" << R"({"name":")" << event.name << R"(","ph":"X","pid":1,"tid":)" << event.thread
+                    << ",\"ts\":" << us(event.begin) << ",\"dur\":" << us(event.duration) << "}";
+            }
+            out << ",\n" << R"({"name":"counters","ph":"C","pid":1,"ts":)" << us(frame.begin) << ",\"args\":{";
+            for (std::size_t i = 0; i < frame.counters.size(); i++) {
+                out << (i ? "," : "") << '"' << counterName((counter) i) << "\":" << frame.counters[i];
+            }
+            out << "}}";
+        }
+        out << "\n]}\n";
+        return (bool) out;
+    }
+
+    auto counterName(counter which) -> const char * {
+        switch (which) {
+            case counter::draws:
+                return "draws";
+            case counter::stateChanges:
+                return "stateChanges";
+            case counter::uploadedBytes:
+                return "uploadedBytes";
+            default:
+                return "unknown";
+        }
+    }
+}
+
+#endif
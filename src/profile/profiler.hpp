@@ -0,0 +1,95 @@
+#pragma once
+
+// Frame profiler. Everything below is compiled only with LEARNOPENGL_PROFILER (cmake -DENABLE_PROFILER=ON);
+// otherwise the PROFILE_* macros expand to nothing and no profiler code or data ends up in the binary.
+//
+//   PROFILE_SCOPE("name")            CPU time of the enclosing block, any thread
+//   PROFILE_GPU_SCOPE("name")        GPU time of the enclosing block, GL thread, not nested in another GPU scope
+//   PROFILE_COUNT(draws, n)          adds n to a per-frame counter, any thread
+//   PROFILE_FRAME()                  GL thread, once per frame after the swap
+//   PROFILE_EXPORT("trace.json")     Chrome trace (chrome://tracing, Perfetto) of the recent frames
+//   PROFILE_SHUTDOWN()               GL thread, before the context goes: deletes the GPU timer queries
+//
+// Names must be string literals or otherwise outlive the profiler.
+
+#if LEARNOPENGL_PROFILER
+
+#include <cstddef>
+#include <cstdint>
+
+namespace profile {
+
+    enum class counter : std::size_t {
+        draws,
+        stateChanges,
+        uploadedBytes,
+        count
+    };
+
+    struct frameSummary {
+        double p50{}, p95{}, p99{}, mean{};   // milliseconds over the rolling window
+        std::size_t frames{};
+    };
+
+    class cpuScope {
+    public:
+        explicit cpuScope(const char *name);
+
+        cpuScope(const cpuScope &) = delete;
+
+        auto operator=(const cpuScope &) -> cpuScope & = delete;
+
+        ~cpuScope();
+
+    private:
+        const char *name;
+        std::uint64_t begin;
+    };
+
+    class gpuScope {
+    public:
+        explicit gpuScope(const char *name);
+
+        gpuScope(const gpuScope &) = delete;
+
+        auto operator=(const gpuScope &) -> gpuScope & = delete;
+
+        ~gpuScope();
+
+    private:
+        bool active = false;
+    };
+
+    auto count(counter which, std::uint64_t value) -> void;
+
+    auto endFrame() -> void;
+
+    // GPU results still in flight are dropped; scopes opened afterwards create new queries
+    auto shutdown() -> void;
+
+    [[nodiscard]] auto summary() -> frameSummary;
+
+    auto exportTrace(const char *path) -> bool;
+
+    [[nodiscard]] auto counterName(counter which) -> const char *;
+}
+
+#define PROFILE_JOIN_INNER(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_INNER(a, b)
+#define PROFILE_SCOPE(name) ::profile::cpuScope PROFILE_JOIN(profileScope, __LINE__){name}
+#define PROFILE_GPU_SCOPE(name) ::profile::gpuScope PROFILE_JOIN(profileGpuScope, __LINE__){name}
+#define PROFILE_COUNT(which, value) ::profile::count(::profile::counter::which, (std::uint64_t) (value))
+#define PROFILE_FRAME() ::profile::endFrame()
+#define PROFILE_EXPORT(path) ::profile::exportTrace(path)
+#define PROFILE_SHUTDOWN() ::profile::shutdown()
+
+#else
+
+#define PROFILE_SCOPE(name) ((void) 0)
+#define PROFILE_GPU_SCOPE(name) ((void) 0)
+#define PROFILE_COUNT(which, value) ((void) 0)
+#define PROFILE_FRAME() ((void) 0)
+#define PROFILE_EXPORT(path) ((void) 0)
+#define PROFILE_SHUTDOWN() ((void) 0)
+
+#endif
@@ -0,0 +1,209 @@
+#include <glad/glad.h>
+
+#include "commandQueue.hpp"
+#include "glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace render {
+
+    namespace {
+        std::atomic<std::uint64_t> nextGeneration{1};
+
+        struct cachedRecorder {
+            std::uint64_t generation{};
+            CommandQueue::Recorder *recorder{};
+        };
+        thread_local cachedRecorder threadRecorder;
+
+        const GLuint modelLocation = instanceLayout{}.modelLocation;
+
+        // LSD radix sort on the 64-bit key, 8 bits per pass; passes whose byte is the same for every entry
+        // are skipped, which with few programs and meshes is most of the upper half
+        template<typename T>
+        auto radixSort(std::vector<T> &values, std::vector<T> &scratch) -> void {
+            std::array<std::array<std::size_t, 256>, 8> histograms{};
+            for (const auto &value: values) {
+                for (int pass = 0; pass < 8; pass++) histograms[pass][(value.key >> (pass * 8)) & 0xFF]++;
+            }
+            scratch.resize(values.size());
+            for (int pass = 0; pass < 8; pass++) {
+                auto &histogram = histograms[pass];
+                if (std::find(histogram.begin(), histogram.end(), values.size()) != histogram.end()) continue;
+                std::size_t sum = 0;
+                for (auto &bucket: histogram) sum += std::exchange(bucket, sum);
+                for (const auto &value: values) scratch[histogram[(value.key >> (pass * 8)) & 0xFF]++] = value;
+                values.swap(scratch);
+            }
+        }
+    }
+
+    auto CommandQueue::Recorder::draw(materialHandle material, meshHandle mesh, float depth, const glm::mat4 &model,
+                                      std::uint32_t layer) -> void {
+        auto chunk = count / chunkSize;
+        if (chunk == chunks.size()) chunks.push_back(std::make_unique<drawCommand[]>(chunkSize));
+        chunks[chunk][count % chunkSize] = drawCommand{sortKey::make(material.program, material.textures, mesh, depth),
+                                                       {model, (float) layer}};
+        count++;
+    }
+
+    auto CommandQueue::Recorder::size() const -> std::size_t {
+        return count;
+    }
+
+    auto CommandQueue::Recorder::at(std::size_t index) const -> const drawCommand & {
+        return chunks[index / chunkSize][index % chunkSize];
+    }
+
+
+    CommandQueue::CommandQueue() : generation(nextGeneration.fetch_add(1, std::memory_order_relaxed)) {
+        // texture set 0 is "no textures"
+        textureSets.push_back(nullptr);
+    }
+
+    CommandQueue::~CommandQueue() = default;
+
+    auto CommandQueue::addMaterial(const material &material) -> materialHandle {
+        auto index = [](auto &table, auto *entry, int bits) -> std::uint32_t {
+            auto found = std::find(table.begin(), table.end(), entry);
+            if (found != table.end()) return (std::uint32_t) (found - table.begin());
+            if (table.size() == (std::size_t{1} << bits)) {
+                std::cerr << "ERROR::COMMAND_QUEUE_TABLE_FULL: " << table.size() << std::endl;
+                throw tableFullException();
+            }
+            table.push_back(entry);
+            return (std::uint32_t) table.size() - 1;
+        };
+        return {index(programs, material.program, sortKey::programBits),
+                index(textureSets, material.textures, sortKey::texturesBits)};
+    }
+
+    auto CommandQueue::addMesh(const mesh &mesh) -> meshHandle {
+        if (meshes.size() == (std::size_t{1} << sortKey::meshBits)) {
+            std::cerr << "ERROR::COMMAND_QUEUE_TABLE_FULL: " << meshes.size() << std::endl;
+            throw tableFullException();
+        }
+        auto &state = GLState::current();
+        state.bindVertexArray(mesh.vao);
+        for (GLuint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(modelLocation + column);
+            glVertexAttribDivisor(modelLocation + column, 1);
+        }
+        glEnableVertexAttribArray(layerLocation);
+        glVertexAttribDivisor(layerLocation, 1);
+        state.bindVertexArray(0);
+        meshes.push_back(mesh);
+        return (meshHandle) meshes.size() - 1;
+    }
+
+    auto CommandQueue::recorder() -> Recorder & {
+        if (threadRecorder.generation == generation) return *threadRecorder.recorder;
+        std::lock_guard lock{recorderMutex};
+        if (recordersInUse == recorders.size()) recorders.push_back(std::make_unique<Recorder>());
+        auto *recorder = recorders[recordersInUse++].get();
+        threadRecorder = {generation, recorder};
+        return *recorder;
+    }
+
+    auto CommandQueue::beginFrame() -> void {
+        for (std::size_t i = 0; i < recordersInUse; i++) recorders[i]->count = 0;
+        recordersInUse = 0;
+        generation = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto CommandQueue::sort() -> void {
+        PROFILE_SCOPE("CommandQueue::sort");
+        entries.clear();
+        for (std::uint32_t r = 0; r < recordersInUse; r++) {
+            const auto &recorder = *recorders[r];
+            for (std::uint32_t i = 0; i < recorder.count; i++) entries.push_back({recorder.at(i).key, r, i});
+        }
+        radixSort(entries, scratch);
+    }
+
+    auto CommandQueue::submit() -> void {
+        PROFILE_SCOPE("CommandQueue::submit");
+        lastDrawCalls = lastTextureSwitches = 0;
+        if (entries.empty()) return;
+
+        auto &state = GLState::current();
+        auto bytes = entries.size() * sizeof(instanceRecord);
+        instanceStream.reserve(bytes);
+        instanceStream.beginFrame();
+        // written in sorted order straight from the recorders into memory the GPU reads
+        auto slice = instanceStream.allocate(bytes, alignof(instanceRecord));
+        auto *mapped = (unsigned char *) slice.data;
+        if (!mapped) {
+            std::cerr << "ERROR::COMMAND_QUEUE_MAP_FAILED" << std::endl;
+            return;
+        }
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            const auto &command = recorders[entries[i].recorder]->at(entries[i].index);
+            std::memcpy(mapped + i * sizeof(instanceRecord), &command.instance, sizeof(instanceRecord));
+        }
+        instanceStream.commit(slice);
+        PROFILE_COUNT(uploadedBytes, bytes);
+
+        for (std::size_t begin = 0, end; begin < entries.size(); begin = end) {
+            auto key = entries[begin].key;
+            for (end = begin + 1; end < entries.size() && sortKey::state(entries[end].key) == sortKey::state(key);) {
+                end++;
+            }
+            programs[sortKey::program(key)]->use();
+            if (auto *textures = textureSets[sortKey::textures(key)]) textures->use();
+            if (begin == 0 || sortKey::textures(key) != sortKey::textures(entries[begin - 1].key)) {
+                lastTextureSwitches++;
+            }
+            const auto &runMesh = meshes[sortKey::mesh(key)];
+            state.bindVertexArray(runMesh.vao);
+            state.bindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+            pointAttributes(slice.offset + begin * sizeof(instanceRecord));
+
+            auto instanceCount = (GLsizei) (end - begin);
+            if (runMesh.indexType == GL_NONE) {
+                glDrawArraysInstanced(runMesh.mode, (GLint) runMesh.first, runMesh.count, instanceCount);
+            } else {
+                glDrawElementsInstanced(runMesh.mode, runMesh.count, runMesh.indexType, runMesh.indexOffset(),
+                                        instanceCount);
+            }
+            lastDrawCalls++;
+        }
+        instanceStream.endFrame();
+        PROFILE_COUNT(draws, lastDrawCalls);
+    }
+
+    auto CommandQueue::size() const -> std::size_t {
+        std::size_t commands = 0;
+        for (std::size_t i = 0; i < recordersInUse; i++) commands += recorders[i]->count;
+        return commands;
+    }
+
+    auto CommandQueue::drawCalls() const -> std::size_t {
+        return lastDrawCalls;
+    }
+
+    auto CommandQueue::textureSwitches() const -> std::size_t {
+        return lastTextureSwitches;
+    }
+
+    auto CommandQueue::stream() const -> const StreamBuffer & {
+        return instanceStream;
+    }
+
+    // same per-run re-pointing as InstanceBatch, GL 3.3 has no base-instance draws
+    auto CommandQueue::pointAttributes(std::size_t byteOffset) const -> void {
+        for (GLuint column = 0; column < 4; column++) {
+            glVertexAttribPointer(modelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(instanceRecord),
+                                  (void *) (byteOffset + column * sizeof(glm::vec4)));
+        }
+        glVertexAttribPointer(layerLocation, 1, GL_FLOAT, GL_FALSE, sizeof(instanceRecord),
+                              (void *) (byteOffset + offsetof(instanceRecord, layer)));
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "instanceBatch.hpp"
+#include "streamBuffer.hpp"
+
+namespace render {
+
+    // 64-bit sort key, most significant first: program, texture set, mesh, then the depth's float bits
+    // (monotonic for depth >= 0), so a sorted frame changes state as rarely as possible and draws
+    // front to back within one state.
+    namespace sortKey {
+        constexpr int programBits = 8, texturesBits = 12, meshBits = 12;
+        constexpr int meshShift = 32, texturesShift = meshShift + meshBits, programShift = texturesShift + texturesBits;
+
+        constexpr auto make(std::uint32_t program, std::uint32_t textures, std::uint32_t mesh, float depth)
+        -> std::uint64_t {
+            auto depthBits = std::bit_cast<std::uint32_t>(depth < 0 ? 0.0f : depth);
+            return (std::uint64_t) program << programShift | (std::uint64_t) textures << texturesShift |
+                   (std::uint64_t) mesh << meshShift | depthBits;
+        }
+
+        constexpr auto program(std::uint64_t key) -> std::uint32_t {
+            return (std::uint32_t) (key >> programShift) & ((1u << programBits) - 1);
+        }
+
+        constexpr auto textures(std::uint64_t key) -> std::uint32_t {
+            return (std::uint32_t) (key >> texturesShift) & ((1u << texturesBits) - 1);
+        }
+
+        constexpr auto mesh(std::uint64_t key) -> std::uint32_t {
+            return (std::uint32_t) (key >> meshShift) & ((1u << meshBits) - 1);
+        }
+
+        // commands whose keys agree above the depth bits share every binding
+        constexpr auto state(std::uint64_t key) -> std::uint64_t {
+            return key >> meshShift;
+        }
+    }
+
+    // what the instance stream holds per draw: the model matrix, then the layer for texture array materials
+    struct instanceRecord {
+        glm::mat4 model;
+        float layer;
+    };
+
+    struct drawCommand {
+        std::uint64_t key;
+        instanceRecord instance;
+    };
+
+    // indices into the queue's program and texture set tables
+    struct materialHandle {
+        std::uint32_t program{}, textures{};
+    };
+
+    using meshHandle = std::uint32_t;
+
+    // Records draws from any thread into per-thread arenas, then sorts and submits them on the GL thread.
+    // Consecutive commands with the same state become one instanced draw; meshes are drawn with the model
+    // matrix as per-instance attribute at instanceLayout{}.modelLocation, like InstanceBatch, and the layer
+    // as a float at layerLocation. Materials whose textures are arrays share one state for every layer.
+    class CommandQueue {
+    public:
+        class tableFullException : std::exception {
+        };
+
+        static constexpr GLuint layerLocation = 7;
+
+        // Linear, never-shrinking command storage owned by one recording thread for one frame.
+        class Recorder {
+        public:
+            auto draw(materialHandle material, meshHandle mesh, float depth, const glm::mat4 &model,
+                      std::uint32_t layer = 0) -> void;
+
+            [[nodiscard]] auto size() const -> std::size_t;
+
+        private:
+            friend class CommandQueue;
+            static constexpr std::size_t chunkSize = 4096;
+
+            std::vector<std::unique_ptr<drawCommand[]>> chunks;
+            std::size_t count{};
+
+            [[nodiscard]] auto at(std::size_t index) const -> const drawCommand &;
+        };
+
+        CommandQueue();
+
+        CommandQueue(const CommandQueue &) = delete;
+
+        auto operator=(const CommandQueue &) -> CommandQueue & = delete;
+
+        ~CommandQueue();
+
+        // GL thread, before recording: programs and texture sets are deduplicated
+        auto addMaterial(const material &material) -> materialHandle;
+
+        // GL thread: attaches the instance attributes to the mesh VAO
+        auto addMesh(const mesh &mesh) -> meshHandle;
+
+        // any thread, between beginFrame() and sort(): the calling thread's recorder for this frame
+        auto recorder() -> Recorder &;
+
+        auto beginFrame() -> void;
+
+        // merges every recorder's commands and radix-sorts them by key
+        auto sort() -> void;
+
+        // GL thread: writes the instances into this frame's stream section and issues one draw per state run
+        auto submit() -> void;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+
+        // instanced draws issued by the last submit()
+        [[nodiscard]] auto drawCalls() const -> std::size_t;
+
+        // texture set changes between the runs of the last submit(), what use() was asked to bind
+        [[nodiscard]] auto textureSwitches() const -> std::size_t;
+
+        [[nodiscard]] auto stream() const -> const StreamBuffer &;
+
+    private:
+        struct sortEntry {
+            std::uint64_t key;
+            std::uint32_t recorder, index;
+        };
+
+        std::vector<const shader::ShaderProgram *> programs{};
+        std::vector<texture::texture2DLoader *> textureSets{};
+        std::vector<mesh> meshes{};
+
+        std::mutex recorderMutex;
+        std::vector<std::unique_ptr<Recorder>> recorders{};
+        std::size_t recordersInUse{};
+        // unique across queues and frames, lets each thread cache its recorder without locking
+        std::uint64_t generation{};
+
+        std::vector<sortEntry> entries{}, scratch{};
+        // 1024 instance records per frame before the first reserve()
+        StreamBuffer instanceStream{GL_ARRAY_BUFFER, 1024 * sizeof(instanceRecord)};
+        std::size_t lastDrawCalls{}, lastTextureSwitches{};
+
+        auto pointAttributes(std::size_t byteOffset) const -> void;
+    };
+}
@@ -0,0 +1,442 @@
+#include "frameCapture.hpp"
+#include "glState.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CAPTURE_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CAPTURE_TARGET_CLMUL
+#else
+#define CAPTURE_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <csignal>
+#include <pthread.h>
+#endif
+
+namespace render {
+
+    namespace {
+        constexpr GLuint64 fenceTimeout = 1'000'000'000;
+
+        // slice-by-8: table k advances a byte's contribution by k more bytes, so eight bytes cost eight lookups
+        constexpr auto crcTables = [] {
+            std::array<std::array<std::uint32_t, 256>, 8> tables{};
+            for (std::uint32_t n = 0; n < 256; n++) {
+                auto c = n;
+                for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                tables[0][n] = c;
+            }
+            for (std::uint32_t n = 0; n < 256; n++) {
+                for (std::size_t k = 1; k < 8; k++) {
+                    tables[k][n] = (tables[k - 1][n] >> 8) ^ tables[0][tables[k - 1][n] & 0xFF];
+                }
+            }
+            return tables;
+        }();
+
+        auto crc32Table(std::uint32_t crc, const unsigned char *data, std::size_t size) -> std::uint32_t {
+            const auto &t = crcTables;
+            for (; size >= 8; data += 8, size -= 8) {
+                auto low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (std::uint32_t) data[3] << 24);
+                auto high = data[4] | data[5] << 8 | data[6] << 16 | (std::uint32_t) data[7] << 24;
+                crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                      t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+            }
+            for (; size > 0; data++, size--) crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+            return crc;
+        }
+
+#ifdef CAPTURE_X86
+        // Carry-less multiply folding (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"):
+        // four 128-bit lanes folded 64 bytes at a time, then one lane, then a Barrett reduction to 32 bits.
+        // size is a multiple of 16, at least 64.
+        CAPTURE_TARGET_CLMUL
+        inline auto fold(__m128i lane, __m128i constants, __m128i next) -> __m128i {
+            auto high = _mm_clmulepi64_si128(lane, constants, 0x11), low = _mm_clmulepi64_si128(lane, constants, 0x00);
+            return _mm_xor_si128(_mm_xor_si128(high, low), next);
+        }
+
+        CAPTURE_TARGET_CLMUL
+        auto crc32Clmul(std::uint32_t crc, const unsigned char *data, std::size_t size) -> std::uint32_t {
+            auto load = [](const unsigned char *p) { return _mm_loadu_si128((const __m128i *) p); };
+            const auto k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+            const auto k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+            const auto k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+            const auto poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+
+            auto x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128((int) crc));
+            auto x2 = load(data + 16), x3 = load(data + 32), x4 = load(data + 48);
+            for (data += 64, size -= 64; size >= 64; data += 64, size -= 64) {
+                x1 = fold(x1, k1k2, load(data));
+                x2 = fold(x2, k1k2, load(data + 16));
+                x3 = fold(x3, k1k2, load(data + 32));
+                x4 = fold(x4, k1k2, load(data + 48));
+            }
+            x1 = fold(fold(fold(x1, k3k4, x2), k3k4, x3), k3k4, x4);
+            for (; size >= 16; data += 16, size -= 16) x1 = fold(x1, k3k4, load(data));
+
+            const auto low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+            x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+            x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5k0, 0x00), _mm_srli_si128(x1, 4));
+            auto quotient = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+            auto product = _mm_clmulepi64_si128(_mm_and_si128(quotient, low32), poly, 0x00);
+            return (std::uint32_t) _mm_extract_epi32(_mm_xor_si128(x1, product), 1);
+        }
+
+        auto hasClmul() -> bool {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+        }
+#endif
+
+        // running CRC-32 of PNG chunks, pre- and post-conditioned by the caller
+        auto crc32(std::uint32_t crc, const unsigned char *data, std::size_t size) -> std::uint32_t {
+#ifdef CAPTURE_X86
+            static const bool clmul = hasClmul();
+            if (clmul && size >= 64) {
+                auto folded = size & ~(std::size_t) 15;
+                crc = crc32Clmul(crc, data, folded);
+                data += folded;
+                size -= folded;
+            }
+#endif
+            return crc32Table(crc, data, size);
+        }
+
+        // zlib's Adler-32; 5552 bytes is the most the sums can take before they overflow 32 bits
+        struct adler32 {
+            std::uint32_t a = 1, b = 0;
+
+            auto update(const unsigned char *data, std::size_t size) -> void {
+                while (size > 0) {
+                    auto block = std::min<std::size_t>(size, 5552);
+                    size -= block;
+                    // 16 bytes at a time: b gains 16 a plus the bytes weighted by how often each lands in a
+                    for (; block >= 16; block -= 16, data += 16) {
+                        std::uint32_t sum = 0, weighted = 0;
+                        for (std::uint32_t i = 0; i < 16; i++) {
+                            sum += data[i];
+                            weighted += (16 - i) * data[i];
+                        }
+                        b += 16 * a + weighted;
+                        a += sum;
+                    }
+                    for (; block > 0; block--) {
+                        a += *data++;
+                        b += a;
+                    }
+                    a %= 65521;
+                    b %= 65521;
+                }
+            }
+        };
+
+        auto putBigEndian(std::vector<unsigned char> &out, std::uint32_t value) -> void {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char) (value >> shift));
+        }
+
+        auto chunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, std::size_t size)
+        -> void {
+            putBigEndian(out, (std::uint32_t) size);
+            auto start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data, data + size);
+            putBigEndian(out, crc32(0xFFFFFFFFu, out.data() + start, out.size() - start) ^ 0xFFFFFFFFu);
+        }
+
+        // RGBA8 rows top-down into png, reused between frames: stored (uncompressed) deflate blocks written
+        // straight into the IDAT chunk and checksummed as they are copied, one pass over the pixels. Files are
+        // as large as the raw frames; a pipe into a real encoder is the way to get small ones.
+        auto encodePng(const unsigned char *rgba, int width, int height, std::vector<unsigned char> &png) -> void {
+            auto rowBytes = (std::size_t) width * 4;
+            auto streamBytes = (rowBytes + 1) * height;
+
+            png.assign({0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+            png.reserve(streamBytes + streamBytes / 65535 * 5 + 128);
+            std::vector<unsigned char> header;
+            putBigEndian(header, (std::uint32_t) width);
+            putBigEndian(header, (std::uint32_t) height);
+            // 8 bits per channel, RGBA, deflate, no filter method extensions, not interlaced
+            header.insert(header.end(), {8, 6, 0, 0, 0});
+            chunk(png, "IHDR", header.data(), header.size());
+
+            auto lengthAt = png.size();
+            putBigEndian(png, 0);
+            auto crcFrom = png.size();
+            png.insert(png.end(), {'I', 'D', 'A', 'T', 0x78, 0x01});
+            auto crc = crc32(0xFFFFFFFFu, png.data() + crcFrom, png.size() - crcFrom);
+            adler32 adler;
+            std::size_t left = streamBytes, blockLeft = 0;
+            auto append = [&](const unsigned char *data, std::size_t size) {
+                auto from = png.size();
+                png.insert(png.end(), data, data + size);
+                crc = crc32(crc, png.data() + from, size);
+            };
+            auto emit = [&](const unsigned char *data, std::size_t size) {
+                adler.update(data, size);
+                while (size > 0) {
+                    if (blockLeft == 0) {
+                        blockLeft = std::min<std::size_t>(65535, left);
+                        unsigned char stored[] = {(unsigned char) (blockLeft == left), (unsigned char) blockLeft,
+                                                  (unsigned char) (blockLeft >> 8), (unsigned char) ~blockLeft,
+                                                  (unsigned char) (~blockLeft >> 8)};
+                        append(stored, sizeof stored);
+                    }
+                    auto part = std::min(size, blockLeft);
+                    append(data, part);
+                    data += part;
+                    size -= part;
+                    blockLeft -= part;
+                    left -= part;
+                }
+            };
+            const unsigned char noFilter = 0;
+            for (int y = 0; y < height; y++) {
+                emit(&noFilter, 1);
+                emit(rgba + y * rowBytes, rowBytes);
+            }
+            unsigned char trailer[4];
+            auto sum = adler.b << 16 | adler.a;
+            for (int i = 0; i < 4; i++) trailer[i] = (unsigned char) (sum >> (24 - 8 * i));
+            append(trailer, 4);
+
+            auto idatBytes = (std::uint32_t) (png.size() - crcFrom - 4);
+            for (int i = 0; i < 4; i++) png[lengthAt + i] = (unsigned char) (idatBytes >> (24 - 8 * i));
+            putBigEndian(png, crc ^ 0xFFFFFFFFu);
+            chunk(png, "IEND", nullptr, 0);
+        }
+    }
+
+    FrameCapture::FrameCapture(int width, int height, captureOptions options)
+            : width(width), height(height), options(std::move(options)), bytes((std::size_t) width * height * 4) {
+        this->options.ring = std::max<std::size_t>(this->options.ring, 1);
+        this->options.queueLimit = std::max<std::size_t>(this->options.queueLimit, 1);
+        const auto &target = this->options.target;
+        bool opened = true;
+        switch (this->options.format) {
+            case captureFormat::pngSequence: {
+                std::error_code error;
+                std::filesystem::create_directories(target, error);
+                opened = !error;
+                break;
+            }
+            case captureFormat::rawStream:
+                opened = (output = std::fopen(target.c_str(), "wb")) != nullptr;
+                break;
+            case captureFormat::pipe:
+#ifdef _WIN32
+                opened = (output = popen(target.c_str(), "wb")) != nullptr;
+#else
+                opened = (output = popen(target.c_str(), "w")) != nullptr;
+#endif
+                break;
+        }
+        if (!opened) {
+            std::cerr << "ERROR::CAPTURE::COULD_NOT_OPEN: " << target << std::endl;
+            throw captureOpenException();
+        }
+        // whole frames go straight to write(), so nothing is left buffered for pclose to flush on the GL thread
+        if (output) std::setvbuf(output, nullptr, _IONBF, 0);
+
+        auto &state = GLState::current();
+        slots.resize(this->options.ring);
+        for (auto &s: slots) {
+            glGenBuffers(1, &s.pbo);
+            state.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) bytes, nullptr, GL_STREAM_READ);
+        }
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        encoder = std::thread{[this] { encodeLoop(); }};
+    }
+
+    FrameCapture::~FrameCapture() {
+        finish();
+        {
+            std::lock_guard lock{queueMutex};
+            stopping = true;
+        }
+        queueChanged.notify_all();
+        encoder.join();
+        if (output) {
+            if (options.format == captureFormat::pipe) pclose(output);
+            else std::fclose(output);
+        }
+        auto &state = GLState::current();
+        for (auto &s: slots) {
+            glDeleteBuffers(1, &s.pbo);
+            state.deletedBuffer(s.pbo);
+        }
+    }
+
+    auto FrameCapture::capture() -> void {
+        collect(false);
+        auto number = nextFrame++;
+        {
+            std::lock_guard lock{queueMutex};
+            stats.requested++;
+            if (stats.outputClosed) return;
+            if (inFlight == slots.size()) {
+                stats.droppedRing++;
+                return;
+            }
+        }
+        auto &s = slots[(ringHead + inFlight) % slots.size()];
+        auto &state = GLState::current();
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s.frame = number;
+        inFlight++;
+    }
+
+    auto FrameCapture::finish() -> void {
+        collect(true);
+        std::unique_lock lock{queueMutex};
+        queueChanged.wait(lock, [this] { return queue.empty() && !encoding; });
+    }
+
+    auto FrameCapture::statistics() const -> captureStatistics {
+        std::lock_guard lock{queueMutex};
+        return stats;
+    }
+
+    auto FrameCapture::frameBytes() const -> std::size_t {
+        return bytes;
+    }
+
+    auto FrameCapture::collect(bool wait) -> void {
+        auto &state = GLState::current();
+        auto rowBytes = (std::size_t) width * 4;
+        while (inFlight > 0) {
+            auto &s = slots[ringHead];
+            if (wait) {
+                while (glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout) == GL_TIMEOUT_EXPIRED) {}
+            } else {
+                auto status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            }
+            glDeleteSync(s.fence);
+            s.fence = nullptr;
+            ringHead = (ringHead + 1) % slots.size();
+            inFlight--;
+
+            std::vector<unsigned char> pixels;
+            {
+                std::unique_lock lock{queueMutex};
+                // finishing waits for room, a running capture drops the frame rather than the frame rate
+                if (wait) queueChanged.wait(lock, [this] { return queue.size() < options.queueLimit; });
+                if (queue.size() >= options.queueLimit) {
+                    stats.droppedQueue++;
+                    continue;
+                }
+                if (!spare.empty()) {
+                    pixels = std::move(spare.back());
+                    spare.pop_back();
+                }
+            }
+            pixels.resize(bytes);
+            state.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            const auto *mapped = (const unsigned char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) bytes,
+                                                                          GL_MAP_READ_BIT);
+            // GL rows run bottom-up, every format here wants them top-down
+            if (mapped) {
+                for (int y = 0; y < height; y++) {
+                    std::memcpy(&pixels[(std::size_t) (height - 1 - y) * rowBytes], mapped + y * rowBytes, rowBytes);
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            state.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            std::lock_guard lock{queueMutex};
+            if (!mapped) {
+                stats.writeErrors++;
+                spare.push_back(std::move(pixels));
+                continue;
+            }
+            queue.push_back({s.frame, std::move(pixels)});
+            stats.peakQueued = std::max(stats.peakQueued, queue.size());
+            queueChanged.notify_all();
+        }
+    }
+
+    auto FrameCapture::encodeLoop() -> void {
+#ifndef _WIN32
+        // a reader that exits early turns the next write into EPIPE here instead of killing the process
+        sigset_t blocked;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &blocked, nullptr);
+#endif
+        for (;;) {
+            frame next;
+            {
+                std::unique_lock lock{queueMutex};
+                queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                next = std::move(queue.front());
+                queue.pop_front();
+                encoding = true;
+            }
+            bool closed;
+            {
+                std::lock_guard lock{queueMutex};
+                closed = stats.outputClosed;
+            }
+            // frames already queued when the output failed are dropped, not written
+            auto written = closed ? 0 : write(next);
+            {
+                std::lock_guard lock{queueMutex};
+                encoding = false;
+                if (written) {
+                    stats.encoded++;
+                    stats.bytesWritten += written;
+                } else if (!closed) {
+                    stats.writeErrors++;
+                    if (options.format != captureFormat::pngSequence) {
+                        stats.outputClosed = true;
+                        std::cerr << "ERROR::CAPTURE::OUTPUT_CLOSED: " << options.target << std::endl;
+                    }
+                }
+                spare.push_back(std::move(next.pixels));
+            }
+            queueChanged.notify_all();
+        }
+    }
+
+    auto FrameCapture::write(const frame &f) -> std::size_t {
+        if (options.format != captureFormat::pngSequence) {
+            return std::fwrite(f.pixels.data(), 1, bytes, output) == bytes ? bytes : 0;
+        }
+        char name[32];
+        std::snprintf(name, sizeof name, "frame_%05llu.png", (unsigned long long) f.number);
+        encodePng(f.pixels.data(), width, height, encoded);
+        const auto &png = encoded;
+        auto *file = std::fopen((std::filesystem::path{options.target} / name).string().c_str(), "wb");
+        if (!file) return 0;
+        auto ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+        ok = std::fclose(file) == 0 && ok;
+        return ok ? png.size() : 0;
+    }
+}
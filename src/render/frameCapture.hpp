@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+    enum class captureFormat {
+        // target is a directory, frames land in it as frame_00000.png (stored, not deflated)
+        pngSequence,
+        // target is a file, frames are appended as top-down RGBA8 (ffmpeg -f rawvideo -pix_fmt rgba)
+        rawStream,
+        // target is a shell command reading top-down RGBA8 frames on its stdin
+        pipe
+    };
+
+    struct captureOptions {
+        captureFormat format = captureFormat::pngSequence;
+        std::string target;
+        // pixel buffers in flight; a frame is read back once its fence signals, at most ring - 1 frames late
+        std::size_t ring = 3;
+        // frames waiting for the encoder; memory is bounded by this many frames plus the ring
+        std::size_t queueLimit = 8;
+    };
+
+    struct captureStatistics {
+        std::uint64_t requested{}, encoded{};
+        // all pixel buffers still waiting for the GPU
+        std::uint64_t droppedRing{};
+        // the encoder was queueLimit frames behind
+        std::uint64_t droppedQueue{};
+        std::uint64_t bytesWritten{}, writeErrors{};
+        std::size_t peakQueued{};
+        // the stream or pipe failed (the encoder exited, the disk filled up); nothing is read back after it
+        bool outputClosed{};
+    };
+
+    // Records the read framebuffer without stalling: capture() starts an asynchronous glReadPixels into the
+    // next pixel buffer of a ring and fences it, later calls map whatever the GPU has finished and hand the
+    // rows to an encoder thread. Frames are dropped, never waited for, when either side falls behind; the
+    // frame number keeps counting, so gaps in a sequence show where. GL thread only, apart from the encoder.
+    class FrameCapture {
+    public:
+        class captureOpenException : std::exception {
+        };
+
+        // throws captureOpenException when the target cannot be created or the command not started
+        FrameCapture(int width, int height, captureOptions options);
+
+        FrameCapture(const FrameCapture &) = delete;
+
+        auto operator=(const FrameCapture &) -> FrameCapture & = delete;
+
+        // finishes and flushes what is in flight
+        ~FrameCapture();
+
+        // after the frame is drawn, before swapping: collects finished frames, then reads this one
+        auto capture() -> void;
+
+        // blocks until every frame read so far is encoded and written
+        auto finish() -> void;
+
+        [[nodiscard]] auto statistics() const -> captureStatistics;
+
+        [[nodiscard]] auto frameBytes() const -> std::size_t;
+
+    private:
+        struct slot {
+            GLuint pbo{};
+            GLsync fence{};
+            std::uint64_t frame{};
+        };
+
+        struct frame {
+            std::uint64_t number{};
+            std::vector<unsigned char> pixels;
+        };
+
+        int width, height;
+        captureOptions options;
+        std::size_t bytes;
+        std::FILE *output{};
+
+        // GL thread: ring slots, oldest in flight at ringHead
+        std::vector<slot> slots;
+        std::size_t ringHead = 0, inFlight = 0;
+        std::uint64_t nextFrame = 0;
+
+        std::thread encoder;
+        mutable std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<frame> queue;
+        std::vector<std::vector<unsigned char>> spare;
+        bool encoding = false, stopping = false;
+        captureStatistics stats{};
+        // encoder thread: the PNG being written, kept so its pages are only faulted in once
+        std::vector<unsigned char> encoded;
+
+        // maps finished slots in order; with wait, blocks on each fence instead of stopping at the first busy one
+        auto collect(bool wait) -> void;
+
+        auto encodeLoop() -> void;
+
+        // bytes written, 0 on failure
+        auto write(const frame &f) -> std::size_t;
+    };
+}
@@ -0,0 +1,200 @@
+#include <glad/glad.h>
+
+#include "glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <iterator>
+#include <numeric>
+
+namespace render {
+
+    namespace {
+        constexpr std::size_t untracked = ~std::size_t{0};
+
+        constexpr GLenum trackedBuffers[] = {GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER,
+                                             GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_PACK_BUFFER, GL_COPY_WRITE_BUFFER};
+        constexpr GLenum trackedTextures[] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D,
+                                              GL_TEXTURE_2D_MULTISAMPLE};
+        constexpr GLenum trackedCapabilities[] = {GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST,
+                                                  GL_STENCIL_TEST, GL_POLYGON_OFFSET_FILL, GL_MULTISAMPLE,
+                                                  GL_FRAMEBUFFER_SRGB};
+
+        template<std::size_t n>
+        auto indexOf(const GLenum (&tracked)[n], GLenum value) -> std::size_t {
+            for (std::size_t i = 0; i < n; i++) {
+                if (tracked[i] == value) return i;
+            }
+            return untracked;
+        }
+    }
+
+    auto stateCounters::totalIssued() const -> std::uint64_t {
+        return std::accumulate(issued.begin(), issued.end(), std::uint64_t{0});
+    }
+
+    auto stateCounters::totalSkipped() const -> std::uint64_t {
+        return std::accumulate(skipped.begin(), skipped.end(), std::uint64_t{0});
+    }
+
+
+    GLState::GLState() {
+        static_assert(std::size(trackedBuffers) == bufferTargets);
+        static_assert(std::size(trackedTextures) == textureTargets);
+        static_assert(std::size(trackedCapabilities) == capabilities);
+        invalidate();
+    }
+
+    auto GLState::current() -> GLState & {
+        static GLState state;
+        return state;
+    }
+
+    auto GLState::useProgram(GLuint newProgram) -> void {
+        if (change(program, newProgram, stateCall::program)) glUseProgram(newProgram);
+    }
+
+    auto GLState::bindVertexArray(GLuint newVertexArray) -> void {
+        if (!change(vertexArray, newVertexArray, stateCall::vertexArray)) return;
+        glBindVertexArray(newVertexArray);
+        buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+    }
+
+    auto GLState::bindBuffer(GLenum target, GLuint buffer) -> void {
+        auto index = bufferIndex(target);
+        if (index == untracked) {
+            frame.issued[(std::size_t) stateCall::buffer]++;
+            glBindBuffer(target, buffer);
+            return;
+        }
+        if (change(buffers[index], buffer, stateCall::buffer)) glBindBuffer(target, buffer);
+    }
+
+    auto GLState::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    -> void {
+        frame.issued[(std::size_t) stateCall::buffer]++;
+        glBindBufferRange(target, index, buffer, offset, size);
+        auto tracked = bufferIndex(target);
+        if (tracked != untracked) buffers[tracked] = buffer;
+    }
+
+    auto GLState::bindTexture(GLuint unit, GLenum target, GLuint texture) -> void {
+        auto index = textureIndex(target);
+        if (unit >= maxTextureUnits || index == untracked) {
+            activeTexture(unit);
+            frame.issued[(std::size_t) stateCall::texture]++;
+            glBindTexture(target, texture);
+            return;
+        }
+        if (!change(textures[unit][index], texture, stateCall::texture)) return;
+        activeTexture(unit);
+        glBindTexture(target, texture);
+    }
+
+    auto GLState::editTexture(GLuint unit, GLenum target, GLuint texture) -> void {
+        bindTexture(unit, target, texture);
+        activeTexture(unit);
+    }
+
+    auto GLState::bindSampler(GLuint unit, GLuint sampler) -> void {
+        if (unit >= maxTextureUnits) {
+            frame.issued[(std::size_t) stateCall::sampler]++;
+            glBindSampler(unit, sampler);
+            return;
+        }
+        if (change(samplers[unit], sampler, stateCall::sampler)) glBindSampler(unit, sampler);
+    }
+
+    auto GLState::activeTexture(GLuint unit) -> void {
+        if (change(activeUnit, unit, stateCall::activeTexture)) glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    auto GLState::enable(GLenum capability) -> void {
+        set(capability, true);
+    }
+
+    auto GLState::disable(GLenum capability) -> void {
+        set(capability, false);
+    }
+
+    auto GLState::set(GLenum capability, bool enable) -> void {
+        auto index = capabilityIndex(capability);
+        if (index != untracked && !change(enabled[index], enable ? 1 : 0, stateCall::capability)) return;
+        if (index == untracked) frame.issued[(std::size_t) stateCall::capability]++;
+        if (enable) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+    }
+
+    auto GLState::deletedProgram(GLuint deleted) -> void {
+        // a deleted program stays in use until another one is installed, only the name becomes reusable
+        if (program == deleted) program = unknown;
+    }
+
+    // GL resets bindings of a deleted object to 0 in the current context
+    auto GLState::deletedVertexArray(GLuint deleted) -> void {
+        if (vertexArray == deleted) {
+            vertexArray = 0;
+            buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = 0;
+        }
+    }
+
+    auto GLState::deletedBuffer(GLuint deleted) -> void {
+        for (auto &buffer: buffers) {
+            if (buffer == deleted) buffer = 0;
+        }
+    }
+
+    auto GLState::deletedTexture(GLuint deleted) -> void {
+        for (auto &unit: textures) {
+            for (auto &texture: unit) {
+                if (texture == deleted) texture = 0;
+            }
+        }
+    }
+
+    auto GLState::invalidate() -> void {
+        program = vertexArray = activeUnit = unknown;
+        buffers.fill(unknown);
+        for (auto &unit: textures) unit.fill(unknown);
+        samplers.fill(unknown);
+        enabled.fill(unknown);
+    }
+
+    auto GLState::counters() const -> const stateCounters & {
+        return frame;
+    }
+
+    auto GLState::lastFrame() const -> const stateCounters & {
+        return previous;
+    }
+
+    auto GLState::endFrame() -> void {
+        PROFILE_COUNT(stateChanges, frame.totalIssued());
+        previous = frame;
+        frame = {};
+    }
+
+    auto GLState::change(GLuint &shadow, GLuint value, stateCall call) -> bool {
+        if (shadow == value) {
+            frame.skipped[(std::size_t) call]++;
+            return false;
+        }
+        shadow = value;
+        frame.issued[(std::size_t) call]++;
+        return true;
+    }
+
+    auto GLState::bufferIndex(GLenum target) -> std::size_t {
+        return indexOf(trackedBuffers, target);
+    }
+
+    auto GLState::textureIndex(GLenum target) -> std::size_t {
+        return indexOf(trackedTextures, target);
+    }
+
+    auto GLState::capabilityIndex(GLenum capability) -> std::size_t {
+        return indexOf(trackedCapabilities, capability);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace render {
+
+    enum class stateCall : std::size_t {
+        program, vertexArray, buffer, activeTexture, texture, sampler, capability, count
+    };
+
+    struct stateCounters {
+        std::array<std::uint64_t, (std::size_t) stateCall::count> issued{};
+        std::array<std::uint64_t, (std::size_t) stateCall::count> skipped{};
+
+        [[nodiscard]] auto totalIssued() const -> std::uint64_t;
+
+        [[nodiscard]] auto totalSkipped() const -> std::uint64_t;
+    };
+
+    // Shadow copy of the binding state of the current context. Every bind in the tree goes through here,
+    // so a call only reaches GL when it changes something. State starts out unknown and becomes known with
+    // the first call; after raw GL calls elsewhere (or a context switch) invalidate() forgets everything.
+    class GLState {
+    public:
+        static constexpr GLuint maxTextureUnits = 32;
+
+        GLState();
+
+        static auto current() -> GLState &;
+
+        auto useProgram(GLuint program) -> void;
+
+        // also forgets the element array binding, which belongs to the vertex array object
+        auto bindVertexArray(GLuint vertexArray) -> void;
+
+        auto bindBuffer(GLenum target, GLuint buffer) -> void;
+
+        // indexed ranges move every frame with streamed data and are always issued; the generic binding
+        // they also set is tracked
+        auto bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) -> void;
+
+        // unit is an index (0, 1, ...), not GL_TEXTUREi
+        auto bindTexture(GLuint unit, GLenum target, GLuint texture) -> void;
+
+        // bindTexture plus making unit active, for glTex* calls that act on the binding right after
+        auto editTexture(GLuint unit, GLenum target, GLuint texture) -> void;
+
+        auto bindSampler(GLuint unit, GLuint sampler) -> void;
+
+        // units are otherwise selected lazily, only when a bind on them has to be issued
+        auto activeTexture(GLuint unit) -> void;
+
+        auto enable(GLenum capability) -> void;
+
+        auto disable(GLenum capability) -> void;
+
+        auto set(GLenum capability, bool enabled) -> void;
+
+        // the object is gone: drop it from every binding so a recycled name is not mistaken for it
+        auto deletedProgram(GLuint program) -> void;
+
+        auto deletedVertexArray(GLuint vertexArray) -> void;
+
+        auto deletedBuffer(GLuint buffer) -> void;
+
+        auto deletedTexture(GLuint texture) -> void;
+
+        auto invalidate() -> void;
+
+        // counts since the last endFrame(), and what the previous frame ended with
+        [[nodiscard]] auto counters() const -> const stateCounters &;
+
+        [[nodiscard]] auto lastFrame() const -> const stateCounters &;
+
+        auto endFrame() -> void;
+
+    private:
+        static constexpr GLuint unknown = ~0u;
+        static constexpr std::size_t bufferTargets = 6, textureTargets = 5, capabilities = 8;
+
+        GLuint program = unknown;
+        GLuint vertexArray = unknown;
+        GLuint activeUnit = unknown;
+        std::array<GLuint, bufferTargets> buffers{};
+        std::array<std::array<GLuint, textureTargets>, maxTextureUnits> textures{};
+        std::array<GLuint, maxTextureUnits> samplers{};
+        // 0 disabled, 1 enabled, unknown
+        std::array<GLuint, capabilities> enabled{};
+
+        stateCounters frame{}, previous{};
+
+        auto change(GLuint &shadow, GLuint value, stateCall call) -> bool;
+
+        static auto bufferIndex(GLenum target) -> std::size_t;
+
+        static auto textureIndex(GLenum target) -> std::size_t;
+
+        static auto capabilityIndex(GLenum capability) -> std::size_t;
+    };
+}
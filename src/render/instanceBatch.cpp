@@ -0,0 +1,143 @@
+#include <glad/glad.h>
+
+#include "instanceBatch.hpp"
+#include "glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace render {
+
+    auto instanceLayout::stride() const -> std::size_t {
+        std::size_t floats = 16;
+        for (const auto &attrib: extra) floats += attrib.components;
+        return floats;
+    }
+
+
+    InstanceBatch::InstanceBatch(const mesh &mesh, instanceLayout layout)
+            : batchMesh(mesh), layout(std::move(layout)),
+              instanceStream(GL_ARRAY_BUFFER, 256 * this->layout.stride() * sizeof(float)) {
+        for (const auto &attrib: this->layout.extra) {
+            if (attrib.components < 1 || attrib.components > 4) {
+                std::cerr << "ERROR::INSTANCE_ATTRIBUTE_COMPONENTS: " << attrib.components << std::endl;
+                throw instanceLayoutError();
+            }
+        }
+        floatsPerInstance = this->layout.stride();
+
+        auto &state = GLState::current();
+        state.bindVertexArray(batchMesh.vao);
+        state.bindBuffer(GL_ARRAY_BUFFER, instanceStream.buffer());
+        for (GLuint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(this->layout.modelLocation + column);
+            glVertexAttribDivisor(this->layout.modelLocation + column, 1);
+        }
+        for (const auto &attrib: this->layout.extra) {
+            glEnableVertexAttribArray(attrib.location);
+            glVertexAttribDivisor(attrib.location, 1);
+        }
+        pointAttributes(0);
+        state.bindVertexArray(0);
+    }
+
+    InstanceBatch::~InstanceBatch() = default;
+
+    auto InstanceBatch::allocate(const material &material, std::size_t count) -> float * {
+        auto &instances = findGroup(material).instances;
+        auto offset = instances.size();
+        instances.resize(offset + count * floatsPerInstance);
+        return instances.data() + offset;
+    }
+
+    auto InstanceBatch::add(const material &material, const glm::mat4 &model) -> float * {
+        auto *record = allocate(material, 1);
+        std::copy_n(&model[0][0], 16, record);
+        return record + 16;
+    }
+
+    auto InstanceBatch::clear() -> void {
+        // groups stay registered so their storage is reused next frame
+        for (auto &group: groups) group.instances.clear();
+    }
+
+    auto InstanceBatch::draw() -> void {
+        std::size_t bytes = 0;
+        for (const auto &group: groups) bytes += group.instances.size() * sizeof(float);
+        if (bytes == 0) return;
+
+        auto &state = GLState::current();
+        instanceStream.reserve(bytes);
+        instanceStream.beginFrame();
+        auto slice = instanceStream.allocate(bytes, alignof(glm::vec4));
+        if (!slice.data) return;
+        auto *mapped = (unsigned char *) slice.data;
+        std::size_t offset = 0;
+        for (const auto &group: groups) {
+            auto groupBytes = group.instances.size() * sizeof(float);
+            std::memcpy(mapped + offset, group.instances.data(), groupBytes);
+            offset += groupBytes;
+        }
+        instanceStream.commit(slice);
+        PROFILE_COUNT(uploadedBytes, bytes);
+
+        state.bindVertexArray(batchMesh.vao);
+        state.bindBuffer(GL_ARRAY_BUFFER, slice.buffer);
+        offset = slice.offset;
+        for (auto &group: groups) {
+            auto instanceCount = (GLsizei) (group.instances.size() / floatsPerInstance);
+            if (instanceCount == 0) continue;
+            if (group.groupMaterial.program) group.groupMaterial.program->use();
+            if (group.groupMaterial.textures) group.groupMaterial.textures->use();
+            pointAttributes(offset);
+            if (batchMesh.indexType == GL_NONE) {
+                glDrawArraysInstanced(batchMesh.mode, (GLint) batchMesh.first, batchMesh.count, instanceCount);
+            } else {
+                glDrawElementsInstanced(batchMesh.mode, batchMesh.count, batchMesh.indexType, batchMesh.indexOffset(),
+                                        instanceCount);
+            }
+            PROFILE_COUNT(draws, 1);
+            offset += group.instances.size() * sizeof(float);
+        }
+        instanceStream.endFrame();
+    }
+
+    auto InstanceBatch::stride() const -> std::size_t {
+        return floatsPerInstance;
+    }
+
+    auto InstanceBatch::size() const -> std::size_t {
+        std::size_t instances = 0;
+        for (const auto &group: groups) instances += group.instances.size() / floatsPerInstance;
+        return instances;
+    }
+
+    auto InstanceBatch::findGroup(const material &material) -> group & {
+        if (lastGroup < groups.size() && groups[lastGroup].groupMaterial == material) return groups[lastGroup];
+        for (std::size_t i = 0; i < groups.size(); i++) {
+            if (groups[i].groupMaterial == material) {
+                lastGroup = i;
+                return groups[i];
+            }
+        }
+        lastGroup = groups.size();
+        return groups.emplace_back(group{material, {}});
+    }
+
+    // GL 3.3 has no base-instance draws, so each group re-points the instance attributes at its range
+    auto InstanceBatch::pointAttributes(std::size_t byteOffset) const -> void {
+        auto strideBytes = (GLsizei) (floatsPerInstance * sizeof(float));
+        for (GLuint column = 0; column < 4; column++) {
+            glVertexAttribPointer(layout.modelLocation + column, 4, GL_FLOAT, GL_FALSE, strideBytes,
+                                  (void *) (byteOffset + column * 4 * sizeof(float)));
+        }
+        auto attribOffset = byteOffset + 16 * sizeof(float);
+        for (const auto &attrib: layout.extra) {
+            glVertexAttribPointer(attrib.location, attrib.components, GL_FLOAT, GL_FALSE, strideBytes,
+                                  (void *) attribOffset);
+            attribOffset += attrib.components * sizeof(float);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "../shader/shader.hpp"
+#include "../texture/texture2D.hpp"
+#include "streamBuffer.hpp"
+
+namespace render {
+
+    struct mesh {
+        unsigned int vao{};
+        GLsizei count{};                 // vertices, or indices when indexType is set
+        GLenum mode = GL_TRIANGLES;
+        GLenum indexType = GL_NONE;
+        std::uint32_t first{};           // first vertex, or first index of a range in a shared element buffer
+
+        // the element buffer offset glDrawElements* takes
+        [[nodiscard]] auto indexOffset() const -> const void * {
+            auto size = indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+            return (const void *) ((std::uintptr_t) first * size);
+        }
+    };
+
+    struct material {
+        const shader::ShaderProgram *program{};
+        texture::texture2DLoader *textures{};
+
+        auto operator==(const material &other) const -> bool = default;
+    };
+
+    struct instanceAttrib {
+        GLuint location;
+        GLint components;
+    };
+
+    // Per-instance record: the model matrix (4 consecutive vec4 locations starting at modelLocation)
+    // followed by the extra float attributes in declaration order.
+    struct instanceLayout {
+        GLuint modelLocation = 3;
+        std::vector<instanceAttrib> extra{};
+
+        [[nodiscard]] auto stride() const -> std::size_t;
+    };
+
+    // Collects instances of one mesh grouped by material and draws every group with a single
+    // instanced call. The instance buffer is attached to the mesh VAO, so a VAO belongs to one batch.
+    class InstanceBatch {
+    public:
+        class instanceLayoutError : std::exception {
+        };
+
+        explicit InstanceBatch(const mesh &mesh, instanceLayout layout = {});
+
+        InstanceBatch(const InstanceBatch &) = delete;
+
+        auto operator=(const InstanceBatch &) -> InstanceBatch & = delete;
+
+        ~InstanceBatch();
+
+        // returns room for count records of stride() floats, to be filled by the caller
+        auto allocate(const material &material, std::size_t count) -> float *;
+
+        auto add(const material &material, const glm::mat4 &model) -> float *;
+
+        auto clear() -> void;
+
+        // uploads every group into the instance buffer and issues one instanced draw per group
+        auto draw() -> void;
+
+        [[nodiscard]] auto stride() const -> std::size_t;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+
+    private:
+        struct group {
+            material groupMaterial;
+            std::vector<float> instances;
+        };
+
+        mesh batchMesh;
+        instanceLayout layout;
+        std::size_t floatsPerInstance;
+
+        StreamBuffer instanceStream;
+
+        std::vector<group> groups{};
+        std::size_t lastGroup{};
+
+        auto findGroup(const material &material) -> group &;
+
+        auto pointAttributes(std::size_t byteOffset) const -> void;
+    };
+}
@@ -0,0 +1,451 @@
+#include "renderGraph.hpp"
+#include "glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace render {
+
+    namespace {
+        constexpr GLsizei maxColorAttachments = 8;
+
+        struct formatLayout {
+            std::size_t bytes;
+            GLenum format, type;
+            GLenum attachment;
+        };
+
+        auto layout(GLenum internalFormat) -> formatLayout {
+            switch (internalFormat) {
+                case GL_R8:
+                    return {1, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0};
+                case GL_RG8:
+                    return {2, GL_RG, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0};
+                case GL_RGBA8:
+                case GL_SRGB8_ALPHA8:
+                    return {4, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0};
+                case GL_RGB10_A2:
+                    return {4, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, GL_COLOR_ATTACHMENT0};
+                case GL_R11F_G11F_B10F:
+                    return {4, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_R16F:
+                    return {2, GL_RED, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_RG16F:
+                    return {4, GL_RG, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_RGBA16F:
+                    return {8, GL_RGBA, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_R32F:
+                    return {4, GL_RED, GL_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_RG32F:
+                    return {8, GL_RG, GL_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_RGBA32F:
+                    return {16, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0};
+                case GL_DEPTH_COMPONENT16:
+                    return {2, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, GL_DEPTH_ATTACHMENT};
+                // drivers pad 24-bit depth to 32 bits
+                case GL_DEPTH_COMPONENT24:
+                    return {4, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, GL_DEPTH_ATTACHMENT};
+                case GL_DEPTH_COMPONENT32F:
+                    return {4, GL_DEPTH_COMPONENT, GL_FLOAT, GL_DEPTH_ATTACHMENT};
+                case GL_DEPTH24_STENCIL8:
+                    return {4, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT};
+                case GL_DEPTH32F_STENCIL8:
+                    return {8, GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, GL_DEPTH_STENCIL_ATTACHMENT};
+                default:
+                    return {0, GL_NONE, GL_NONE, GL_NONE};
+            }
+        }
+
+        auto bytes(const targetDescription &description) -> std::size_t {
+            return (std::size_t) description.width * description.height * layout(description.format).bytes;
+        }
+
+        auto isDepth(GLenum format) -> bool {
+            return layout(format).attachment != GL_COLOR_ATTACHMENT0;
+        }
+    }
+
+    RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, std::uint32_t pass) : graph(graph), pass(pass) {}
+
+    auto RenderGraph::PassBuilder::create(const char *name, const targetDescription &description) -> resourceHandle {
+        if (RenderGraph::formatBytes(description.format) == 0 || description.width <= 0 || description.height <= 0) {
+            std::cerr << "ERROR::RENDER_GRAPH::UNSUPPORTED_TARGET: " << name << std::endl;
+            throw graphException();
+        }
+        auto index = (std::uint32_t) graph.versions.size();
+        graph.resources.push_back({name, description, false, 0, index, none, none, none});
+        graph.versions.push_back({(std::uint32_t) graph.resources.size() - 1, none, 0, none});
+        return {index};
+    }
+
+    auto RenderGraph::PassBuilder::read(resourceHandle resource) -> resourceHandle {
+        auto &p = graph.passes[pass];
+        if (resource.index >= graph.versions.size() || graph.versions[resource.index].producer == none ||
+            graph.resources[graph.versions[resource.index].resource].imported) {
+            std::cerr << "ERROR::RENDER_GRAPH::READ_BEFORE_WRITE: " << p.name << std::endl;
+            throw graphException();
+        }
+        auto target = graph.versions[resource.index].resource;
+        for (auto written: p.writes) {
+            if (graph.versions[written].resource == target) {
+                std::cerr << "ERROR::RENDER_GRAPH::FEEDBACK_LOOP: " << p.name << std::endl;
+                throw graphException();
+            }
+        }
+        graph.versions[resource.index].readers++;
+        p.reads.push_back(resource.index);
+        return resource;
+    }
+
+    auto RenderGraph::PassBuilder::write(resourceHandle resource) -> resourceHandle {
+        auto &p = graph.passes[pass];
+        if (resource.index >= graph.versions.size() ||
+            graph.resources[graph.versions[resource.index].resource].latest != resource.index) {
+            std::cerr << "ERROR::RENDER_GRAPH::STALE_VERSION: " << p.name << std::endl;
+            throw graphException();
+        }
+        auto target = graph.versions[resource.index].resource;
+        for (auto other: p.reads) {
+            if (graph.versions[other].resource == target) {
+                std::cerr << "ERROR::RENDER_GRAPH::FEEDBACK_LOOP: " << p.name << std::endl;
+                throw graphException();
+            }
+        }
+        // drawing over what an earlier pass left keeps that pass
+        if (graph.versions[resource.index].producer != none) graph.versions[resource.index].readers++;
+
+        auto index = (std::uint32_t) graph.versions.size();
+        graph.versions.push_back({target, pass, 0, resource.index});
+        graph.resources[target].latest = index;
+        if (graph.resources[target].imported) p.sideEffect = true;
+        p.writes.push_back(index);
+        return {index};
+    }
+
+    auto RenderGraph::PassBuilder::sideEffect() -> void {
+        graph.passes[pass].sideEffect = true;
+    }
+
+    RenderGraph::~RenderGraph() {
+        auto &state = GLState::current();
+        for (const auto &[attachments, framebuffer]: framebuffers) glDeleteFramebuffers(1, &framebuffer);
+        for (const auto &pooled: pool) {
+            glDeleteTextures(1, &pooled.texture);
+            state.deletedTexture(pooled.texture);
+        }
+        for (auto &frame: timing) {
+            if (!frame.queries.empty()) glDeleteQueries((GLsizei) frame.queries.size(), frame.queries.data());
+        }
+    }
+
+    auto RenderGraph::importTarget(const char *name, GLuint framebuffer, GLsizei width, GLsizei height)
+    -> resourceHandle {
+        auto index = (std::uint32_t) versions.size();
+        resources.push_back({name, {width, height, GL_NONE}, true, framebuffer, index, none, none, none});
+        versions.push_back({(std::uint32_t) resources.size() - 1, none, 0, none});
+        return {index};
+    }
+
+    auto RenderGraph::addPass(const char *name, const setupFunction &setup, executeFunction execute) -> void {
+        compiled = false;
+        passes.push_back({name, std::move(execute), {}, {}, false, false, 0});
+        PassBuilder builder{*this, (std::uint32_t) passes.size() - 1};
+        setup(builder);
+    }
+
+    auto RenderGraph::compile() -> void {
+        if (compiled) return;
+        cull();
+        order.clear();
+        for (std::uint32_t i = 0; i < passes.size(); i++) {
+            if (passes[i].culled) continue;
+            order.push_back(i);
+
+            // imported targets bring their own framebuffer, transients share one size in the one built here
+            const auto &p = passes[i];
+            std::size_t imported = 0, colors = 0, depths = 0;
+            bool sized = true;
+            for (auto written: p.writes) {
+                const auto &r = resources[versions[written].resource];
+                if (r.imported) imported++;
+                else if (isDepth(r.description.format)) depths++;
+                else colors++;
+                const auto &front = resources[versions[p.writes.front()].resource].description;
+                sized = sized && r.description.width == front.width && r.description.height == front.height;
+            }
+            if ((imported && p.writes.size() > 1) || depths > 1 || colors > maxColorAttachments || !sized) {
+                std::cerr << "ERROR::RENDER_GRAPH::ATTACHMENTS_MISMATCH: " << p.name << std::endl;
+                throw graphException();
+            }
+        }
+        stats.passes = passes.size();
+        stats.culled = passes.size() - order.size();
+        assignTextures();
+        compiled = true;
+    }
+
+    auto RenderGraph::cull() -> void {
+        for (auto &p: passes) {
+            p.culled = false;
+            p.references = (std::uint32_t) p.writes.size();
+        }
+        std::vector<std::uint32_t> unread;
+        for (std::uint32_t i = 0; i < versions.size(); i++) {
+            if (versions[i].producer != none && versions[i].readers == 0) unread.push_back(i);
+        }
+        auto release = [&](std::uint32_t v) {
+            if (versions[v].producer != none && --versions[v].readers == 0) unread.push_back(v);
+        };
+        while (!unread.empty()) {
+            auto &producer = passes[versions[unread.back()].producer];
+            unread.pop_back();
+            if (producer.sideEffect || producer.culled || --producer.references > 0) continue;
+            producer.culled = true;
+            for (auto v: producer.reads) release(v);
+            for (auto v: producer.writes) {
+                if (versions[v].previous != none) release(versions[v].previous);
+            }
+        }
+    }
+
+    auto RenderGraph::assignTextures() -> void {
+        releaseIdle();
+        for (auto &r: resources) r.first = r.last = r.texture = none;
+        for (std::uint32_t position = 0; position < order.size(); position++) {
+            auto touch = [&](std::uint32_t v) {
+                auto &r = resources[versions[v].resource];
+                if (r.imported) return;
+                if (r.first == none) r.first = position;
+                r.last = position;
+            };
+            const auto &p = passes[order[position]];
+            for (auto v: p.reads) touch(v);
+            for (auto v: p.writes) touch(v);
+        }
+
+        std::vector<std::uint32_t> transients;
+        for (std::uint32_t i = 0; i < resources.size(); i++) {
+            if (resources[i].first != none) transients.push_back(i);
+        }
+        // by first use, each takes a texture the earlier ones are done with: as few textures as lifetimes allow
+        std::stable_sort(transients.begin(), transients.end(), [this](std::uint32_t a, std::uint32_t b) {
+            return resources[a].first < resources[b].first;
+        });
+        stats.transients = transients.size();
+        stats.requestedBytes = 0;
+        for (auto i: transients) {
+            auto &r = resources[i];
+            r.texture = acquire(r.description, r.first);
+            pool[r.texture].busyUntil = r.last;
+            stats.requestedBytes += bytes(r.description);
+        }
+
+        stats.textures = stats.allocatedBytes = stats.pooledBytes = 0;
+        stats.pooledTextures = pool.size();
+        for (const auto &pooled: pool) {
+            stats.pooledBytes += bytes(pooled.description);
+            if (pooled.lastFrame != frameIndex) continue;
+            stats.textures++;
+            stats.allocatedBytes += bytes(pooled.description);
+        }
+    }
+
+    auto RenderGraph::acquire(const targetDescription &description, std::uint32_t first) -> std::uint32_t {
+        // a texture already in use this frame first, so idle ones stay idle and can age out
+        auto idle = none;
+        for (std::uint32_t i = 0; i < pool.size(); i++) {
+            auto &pooled = pool[i];
+            if (!(pooled.description == description)) continue;
+            if (pooled.lastFrame != frameIndex) {
+                if (idle == none) idle = i;
+            } else if (pooled.busyUntil < first) {
+                return i;
+            }
+        }
+        if (idle != none) {
+            pool[idle].lastFrame = frameIndex;
+            return idle;
+        }
+
+        auto format = layout(description.format);
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::current().editTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint) description.format, description.width, description.height, 0,
+                     format.format, format.type, nullptr);
+        auto filter = isDepth(description.format) ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        pool.push_back({texture, description, frameIndex, none});
+        stats.texturesCreated++;
+        return (std::uint32_t) pool.size() - 1;
+    }
+
+    auto RenderGraph::releaseIdle() -> void {
+        auto &state = GLState::current();
+        std::vector<GLuint> released;
+        std::erase_if(pool, [&](const pooledTexture &pooled) {
+            if (pooled.lastFrame + idleFrames >= frameIndex) return false;
+            released.push_back(pooled.texture);
+            return true;
+        });
+        if (released.empty()) return;
+        std::erase_if(framebuffers, [&](const auto &entry) {
+            for (auto texture: entry.first) {
+                if (std::find(released.begin(), released.end(), texture) == released.end()) continue;
+                glDeleteFramebuffers(1, &entry.second);
+                return true;
+            }
+            return false;
+        });
+        for (auto texture: released) {
+            glDeleteTextures(1, &texture);
+            state.deletedTexture(texture);
+        }
+        stats.texturesReleased += released.size();
+    }
+
+    auto RenderGraph::framebufferFor(const pass &p, GLsizei &width, GLsizei &height) -> GLuint {
+        if (p.writes.empty()) return none;
+        const auto &front = resources[versions[p.writes.front()].resource];
+        width = front.description.width;
+        height = front.description.height;
+        if (front.imported) return front.framebuffer;
+
+        // colors in the order written, then the depth texture or 0
+        std::vector<GLuint> attachments;
+        GLuint depth = 0;
+        GLenum depthAttachment = GL_NONE;
+        for (auto v: p.writes) {
+            const auto &r = resources[versions[v].resource];
+            auto attachment = layout(r.description.format).attachment;
+            if (attachment == GL_COLOR_ATTACHMENT0) {
+                attachments.push_back(pool[r.texture].texture);
+            } else {
+                depth = pool[r.texture].texture;
+                depthAttachment = attachment;
+            }
+        }
+        auto colors = (GLsizei) attachments.size();
+        attachments.push_back(depth);
+        auto found = framebuffers.find(attachments);
+        if (found != framebuffers.end()) return found->second;
+
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        std::array<GLenum, maxColorAttachments> drawBuffers{};
+        for (GLsizei i = 0; i < colors; i++) {
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[i], GL_TEXTURE_2D, attachments[i], 0);
+        }
+        if (depth) glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depth, 0);
+        // depth-only targets draw and read no color at all
+        if (colors) {
+            glDrawBuffers(colors, drawBuffers.data());
+        } else {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            glDeleteFramebuffers(1, &framebuffer);
+            std::cerr << "ERROR::RENDER_GRAPH::FRAMEBUFFER_INCOMPLETE: " << p.name << std::endl;
+            throw graphException();
+        }
+        framebuffers.emplace(std::move(attachments), framebuffer);
+        stats.framebuffersCreated++;
+        return framebuffer;
+    }
+
+    auto RenderGraph::execute() -> void {
+        compile();
+        collectTimings();
+        auto &frame = timing[frameIndex % timingFrames];
+        if (frame.pending) stats.lateTimings++;
+        if (frame.queries.size() < order.size() + 1) {
+            auto have = frame.queries.size();
+            frame.queries.resize(order.size() + 1);
+            glGenQueries((GLsizei) (frame.queries.size() - have), frame.queries.data() + have);
+        }
+        frame.passes.clear();
+
+        // one timestamp before the first pass and one after each, a pass takes the time between its two
+        glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+        auto bound = none, finalTarget = none;
+        for (std::size_t position = 0; position < order.size(); position++) {
+            const auto &p = passes[order[position]];
+            GLsizei width, height;
+            auto framebuffer = framebufferFor(p, width, height);
+            if (framebuffer != none) {
+                if (framebuffer != bound) glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                glViewport(0, 0, width, height);
+                bound = framebuffer;
+                if (resources[versions[p.writes.front()].resource].imported) finalTarget = framebuffer;
+            }
+            auto begin = std::chrono::steady_clock::now();
+            {
+                PROFILE_SCOPE(p.name);
+                if (p.execute) p.execute(*this);
+            }
+            auto cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            glQueryCounter(frame.queries[position + 1], GL_TIMESTAMP);
+            frame.passes.push_back({p.name, cpuMs, 0});
+        }
+        frame.pending = true;
+        if (finalTarget != none && finalTarget != bound) glBindFramebuffer(GL_FRAMEBUFFER, finalTarget);
+
+        resources.clear();
+        versions.clear();
+        passes.clear();
+        order.clear();
+        compiled = false;
+        frameIndex++;
+    }
+
+    auto RenderGraph::collectTimings() -> void {
+        // oldest first; timestamps land in order, so the first frame still out means the later ones are too
+        for (std::size_t age = 0; age < timingFrames; age++) {
+            auto &frame = timing[(frameIndex + age) % timingFrames];
+            if (!frame.pending) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(frame.queries[frame.passes.size()], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            GLuint64 previous = 0;
+            glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &previous);
+            for (std::size_t i = 0; i < frame.passes.size(); i++) {
+                GLuint64 stamp = 0;
+                glGetQueryObjectui64v(frame.queries[i + 1], GL_QUERY_RESULT, &stamp);
+                frame.passes[i].gpuMs = (double) (stamp - previous) / 1e6;
+                previous = stamp;
+            }
+            latestTimings = frame.passes;
+            frame.pending = false;
+        }
+    }
+
+    auto RenderGraph::texture(resourceHandle resource) const -> GLuint {
+        const auto &r = resources[versions[resource.index].resource];
+        return r.texture == none ? 0 : pool[r.texture].texture;
+    }
+
+    auto RenderGraph::description(resourceHandle resource) const -> const targetDescription & {
+        return resources[versions[resource.index].resource].description;
+    }
+
+    auto RenderGraph::statistics() const -> const graphStatistics & {
+        return stats;
+    }
+
+    auto RenderGraph::timings() const -> const std::vector<passTiming> & {
+        return latestTimings;
+    }
+
+    auto RenderGraph::formatBytes(GLenum format) -> std::size_t {
+        return layout(format).bytes;
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace render {
+
+    // Size and sized internal format of a render target the graph creates; targets with equal descriptions
+    // can share one texture.
+    struct targetDescription {
+        GLsizei width{}, height{};
+        GLenum format = GL_RGBA8;
+
+        auto operator==(const targetDescription &) const -> bool = default;
+    };
+
+    // One version of a graph resource. Writing a resource yields the next version, and later passes read or
+    // write that one, so the handles a pass holds also order it after the passes that produced them.
+    struct resourceHandle {
+        std::uint32_t index = ~0u;
+
+        [[nodiscard]] auto valid() const -> bool { return index != ~0u; }
+    };
+
+    struct passTiming {
+        const char *name;
+        double cpuMs, gpuMs;
+    };
+
+    struct graphStatistics {
+        std::size_t passes{}, culled{};
+        // virtual transient targets against the textures backing them; bytes as if every target had its own
+        std::size_t transients{}, textures{};
+        std::size_t requestedBytes{}, allocatedBytes{};
+        // what the pool keeps between frames, and its churn so far
+        std::size_t pooledTextures{}, pooledBytes{};
+        std::uint64_t texturesCreated{}, texturesReleased{}, framebuffersCreated{};
+        // frames whose timestamps were not back by the time their queries were needed again
+        std::uint64_t lateTimings{};
+    };
+
+    // Frame graph over framebuffers: passes declare the targets they write as attachments and the ones they
+    // sample, the graph orders them, culls passes nothing reads, and backs transient targets whose lifetimes
+    // do not overlap with the same pooled textures. Declared anew every frame:
+    //
+    //   auto backbuffer = graph.importTarget("backbuffer", 0, width, height);
+    //   graph.addPass("scene", [&](auto &pass) { hdr = pass.write(pass.create("hdr", {w, h, GL_RGBA16F})); },
+    //                 [&](const RenderGraph &) { clear, draw ... });
+    //   graph.addPass("tonemap", [&](auto &pass) { pass.read(hdr); pass.write(backbuffer); },
+    //                 [&](const RenderGraph &g) { sample g.texture(hdr) ... });
+    //   graph.execute();
+    //
+    // A transient's first writer finds whatever an aliased target left in it and clears what it needs.
+    // Names must be string literals or otherwise outlive the frame. GL thread only.
+    class RenderGraph {
+    public:
+        class graphException : std::exception {
+        };
+
+        class PassBuilder {
+        public:
+            // a transient target, unwritten until a pass writes it
+            auto create(const char *name, const targetDescription &description) -> resourceHandle;
+
+            // sampled by the pass; throws graphException when nothing wrote it yet
+            auto read(resourceHandle resource) -> resourceHandle;
+
+            // attached for drawing, color targets in the order written, a depth format as the depth attachment;
+            // returns the version later passes use. Only the latest version of a resource can be written.
+            auto write(resourceHandle resource) -> resourceHandle;
+
+            // kept even when nothing reads what it writes; passes writing an imported target always are
+            auto sideEffect() -> void;
+
+        private:
+            friend class RenderGraph;
+
+            RenderGraph &graph;
+            std::uint32_t pass;
+
+            PassBuilder(RenderGraph &graph, std::uint32_t pass);
+        };
+
+        using setupFunction = std::function<void(PassBuilder &)>;
+        using executeFunction = std::function<void(const RenderGraph &)>;
+
+        RenderGraph() = default;
+
+        RenderGraph(const RenderGraph &) = delete;
+
+        auto operator=(const RenderGraph &) -> RenderGraph & = delete;
+
+        ~RenderGraph();
+
+        // a framebuffer the graph does not own, 0 for the window's; written by a pass on its own
+        auto importTarget(const char *name, GLuint framebuffer, GLsizei width, GLsizei height) -> resourceHandle;
+
+        // runs setup now, execute when the graph does
+        auto addPass(const char *name, const setupFunction &setup, executeFunction execute) -> void;
+
+        // culls, orders and assigns textures; throws graphException for passes that cannot be attached
+        auto compile() -> void;
+
+        // compiles if needed, runs the surviving passes with their framebuffer bound and the viewport covering
+        // it, and starts the next frame's declarations. The last imported target written stays bound.
+        auto execute() -> void;
+
+        // texture behind a transient, valid while the passes run
+        [[nodiscard]] auto texture(resourceHandle resource) const -> GLuint;
+
+        [[nodiscard]] auto description(resourceHandle resource) const -> const targetDescription &;
+
+        [[nodiscard]] auto statistics() const -> const graphStatistics &;
+
+        // passes of the latest frame whose GPU timestamps arrived, in execution order
+        [[nodiscard]] auto timings() const -> const std::vector<passTiming> &;
+
+        // bytes per texel of the formats targets can use, 0 for any other
+        static auto formatBytes(GLenum format) -> std::size_t;
+
+    private:
+        static constexpr std::uint32_t none = ~0u;
+        // unused pool textures are released after this many frames
+        static constexpr std::uint64_t idleFrames = 60;
+        static constexpr std::size_t timingFrames = 3;
+
+        struct resource {
+            const char *name;
+            targetDescription description;
+            bool imported;
+            GLuint framebuffer;
+            std::uint32_t latest;
+            // compiled: first and last surviving pass touching it, and the pooled texture backing it
+            std::uint32_t first, last, texture;
+        };
+
+        struct version {
+            std::uint32_t resource;
+            std::uint32_t producer;
+            std::uint32_t readers;
+            // the version this one was drawn over
+            std::uint32_t previous;
+        };
+
+        struct pass {
+            const char *name;
+            executeFunction execute;
+            std::vector<std::uint32_t> reads, writes;
+            bool sideEffect;
+            bool culled;
+            std::uint32_t references;
+        };
+
+        struct pooledTexture {
+            GLuint texture;
+            targetDescription description;
+            std::uint64_t lastFrame;
+            // pass after which the texture is free again this frame
+            std::uint32_t busyUntil;
+        };
+
+        struct timingFrame {
+            std::vector<GLuint> queries;
+            std::vector<passTiming> passes;
+            bool pending = false;
+        };
+
+        std::vector<resource> resources;
+        std::vector<version> versions;
+        std::vector<pass> passes;
+        std::vector<std::uint32_t> order;
+        bool compiled = false;
+
+        std::vector<pooledTexture> pool;
+        std::map<std::vector<GLuint>, GLuint> framebuffers;
+        std::uint64_t frameIndex = 0;
+
+        std::array<timingFrame, timingFrames> timing{};
+        std::vector<passTiming> latestTimings;
+        graphStatistics stats{};
+
+        auto cull() -> void;
+
+        auto assignTextures() -> void;
+
+        auto acquire(const targetDescription &description, std::uint32_t first) -> std::uint32_t;
+
+        auto releaseIdle() -> void;
+
+        // framebuffer with the pass's attachments, its size through width and height
+        auto framebufferFor(const pass &p, GLsizei &width, GLsizei &height) -> GLuint;
+
+        auto collectTimings() -> void;
+    };
+}
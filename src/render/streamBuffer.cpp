@@ -0,0 +1,165 @@
+#include "streamBuffer.hpp"
+#include "glState.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace render {
+
+    namespace {
+        streamMode defaultMode = streamMode::automatic;
+
+        constexpr GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        constexpr GLuint64 stallTimeout = 1'000'000'000;
+
+        auto signaled(GLsync fence) -> bool {
+            auto status = glClientWaitSync(fence, 0, 0);
+            return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+        }
+    }
+
+    StreamBuffer::StreamBuffer(GLenum target, std::size_t sectionSize, std::size_t sections, streamMode mode)
+            : target(target), bytesPerSection(std::max<std::size_t>(sectionSize, 1)),
+              sectionCount(std::clamp<std::size_t>(sections, 1, maxSections)) {
+        if (mode == streamMode::automatic) mode = defaultMode;
+        auto storage = glBufferStorage != nullptr;
+        if (mode == streamMode::persistent && !storage) {
+            std::cerr << "ERROR::STREAM_BUFFER_NO_BUFFER_STORAGE: falling back to orphaning" << std::endl;
+        }
+        isPersistent = mode != streamMode::orphaning && storage;
+        create();
+    }
+
+    StreamBuffer::~StreamBuffer() {
+        destroy();
+    }
+
+    auto StreamBuffer::setDefaultMode(streamMode mode) -> void {
+        defaultMode = mode;
+    }
+
+    auto StreamBuffer::beginFrame() -> void {
+        section = (section + 1) % sectionCount;
+        head = 0;
+        auto &fence = fences[section];
+        if (!fence) return;
+        if (!signaled(fence)) {
+            if (isPersistent) {
+                // the GPU is a whole ring behind; nothing to do but wait for it
+                stats.stalls++;
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, stallTimeout) == GL_TIMEOUT_EXPIRED) {}
+            } else {
+                // fresh storage for the whole ring, the old one lives until the GPU is done with it
+                stats.orphans++;
+                GLState::current().bindBuffer(target, name);
+                glBufferData(target, (GLsizeiptr) (bytesPerSection * sectionCount), nullptr, GL_STREAM_DRAW);
+                for (auto &pending: fences) {
+                    if (pending) glDeleteSync(pending);
+                    pending = nullptr;
+                }
+                return;
+            }
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    auto StreamBuffer::allocate(std::size_t bytes, std::size_t alignment) -> streamSlice {
+        auto start = (head + alignment - 1) / alignment * alignment;
+        if (start + bytes > bytesPerSection) {
+            std::cerr << "ERROR::STREAM_BUFFER_SECTION_FULL: " << start + bytes << " > " << bytesPerSection
+                      << std::endl;
+            throw sectionFullException();
+        }
+        head = start + bytes;
+        stats.bytes += bytes;
+        auto offset = section * bytesPerSection + start;
+        if (isPersistent) return {mapped + offset, name, (GLintptr) offset, bytes};
+
+        // the fence or the orphan in beginFrame() already guarantees the range is free
+        GLState::current().bindBuffer(target, name);
+        auto *data = glMapBufferRange(target, (GLintptr) offset, (GLsizeiptr) bytes,
+                                      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!data) {
+            std::cerr << "ERROR::STREAM_BUFFER_MAP_FAILED" << std::endl;
+            return {};
+        }
+        open = true;
+        return {data, name, (GLintptr) offset, bytes};
+    }
+
+    auto StreamBuffer::commit(const streamSlice &) -> void {
+        // coherent persistent writes are visible to commands issued afterwards without any call
+        if (!open) return;
+        GLState::current().bindBuffer(target, name);
+        glUnmapBuffer(target);
+        open = false;
+    }
+
+    auto StreamBuffer::endFrame() -> void {
+        auto &fence = fences[section];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stats.frames++;
+    }
+
+    auto StreamBuffer::reserve(std::size_t bytes) -> void {
+        if (bytes <= bytesPerSection) return;
+        destroy();
+        bytesPerSection = std::max(bytes, bytesPerSection * 2);
+        create();
+    }
+
+    auto StreamBuffer::buffer() const -> GLuint {
+        return name;
+    }
+
+    auto StreamBuffer::persistent() const -> bool {
+        return isPersistent;
+    }
+
+    auto StreamBuffer::sectionSize() const -> std::size_t {
+        return bytesPerSection;
+    }
+
+    auto StreamBuffer::statistics() const -> const streamStatistics & {
+        return stats;
+    }
+
+    auto StreamBuffer::create() -> void {
+        auto size = (GLsizeiptr) (bytesPerSection * sectionCount);
+        glGenBuffers(1, &name);
+        GLState::current().bindBuffer(target, name);
+        if (!isPersistent) {
+            glBufferData(target, size, nullptr, GL_STREAM_DRAW);
+            return;
+        }
+        glBufferStorage(target, size, nullptr, persistentFlags);
+        mapped = (unsigned char *) glMapBufferRange(target, 0, size, persistentFlags);
+        if (!mapped) {
+            std::cerr << "ERROR::STREAM_BUFFER_PERSISTENT_MAP_FAILED: falling back to orphaning" << std::endl;
+            glDeleteBuffers(1, &name);
+            GLState::current().deletedBuffer(name);
+            isPersistent = false;
+            create();
+        }
+    }
+
+    auto StreamBuffer::destroy() -> void {
+        for (auto &fence: fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (mapped || open) {
+            GLState::current().bindBuffer(target, name);
+            glUnmapBuffer(target);
+        }
+        mapped = nullptr;
+        open = false;
+        glDeleteBuffers(1, &name);
+        GLState::current().deletedBuffer(name);
+        name = 0;
+        section = 0;
+        head = 0;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+namespace render {
+
+    enum class streamMode {
+        // persistent when the context has glBufferStorage (4.4+), orphaning otherwise
+        automatic,
+        persistent,
+        orphaning
+    };
+
+    struct streamSlice {
+        void *data{};
+        GLuint buffer{};
+        GLintptr offset{};
+        std::size_t size{};
+    };
+
+    struct streamStatistics {
+        std::uint64_t bytes{}, frames{};
+        // persistent: waits for the GPU to release a section; orphaning: storage replaced instead of waiting
+        std::uint64_t stalls{}, orphans{};
+    };
+
+    // Ring of sectionSize-byte sections for data written once per frame and read by the GPU shortly after.
+    // beginFrame() moves to the next section, whose fence from sections frames ago says whether the GPU still
+    // reads it; allocate() hands out aligned slices to write into directly and endFrame() fences the section
+    // once the draws reading it are issued.
+    //
+    // Persistent mode maps glBufferStorage memory once (coherent), so slices cost nothing and only a GPU more
+    // than sections frames behind makes beginFrame() wait. The GL 3.3 fallback maps each slice unsynchronized
+    // and orphans the buffer instead of waiting; there a slice must be committed (unmapped) before the next
+    // allocate() or any draw that reads it, and only one slice can be open at a time.
+    class StreamBuffer {
+    public:
+        class sectionFullException : std::exception {
+        };
+
+        static constexpr std::size_t maxSections = 4;
+
+        explicit StreamBuffer(GLenum target, std::size_t sectionSize, std::size_t sections = 3,
+                              streamMode mode = streamMode::automatic);
+
+        StreamBuffer(const StreamBuffer &) = delete;
+
+        auto operator=(const StreamBuffer &) -> StreamBuffer & = delete;
+
+        ~StreamBuffer();
+
+        // mode used when automatic is requested, to force the fallback on capable drivers
+        static auto setDefaultMode(streamMode mode) -> void;
+
+        auto beginFrame() -> void;
+
+        // throws sectionFullException when the section cannot fit the slice; reserve() ahead of time
+        auto allocate(std::size_t bytes, std::size_t alignment = 16) -> streamSlice;
+
+        auto commit(const streamSlice &slice) -> void;
+
+        auto endFrame() -> void;
+
+        // grows sections to at least bytes; between frames only, the old storage is released by GL once unused
+        auto reserve(std::size_t bytes) -> void;
+
+        [[nodiscard]] auto buffer() const -> GLuint;
+
+        [[nodiscard]] auto persistent() const -> bool;
+
+        [[nodiscard]] auto sectionSize() const -> std::size_t;
+
+        [[nodiscard]] auto statistics() const -> const streamStatistics &;
+
+    private:
+        GLenum target;
+        std::size_t bytesPerSection, sectionCount;
+        bool isPersistent = false;
+        GLuint name{};
+        unsigned char *mapped{};
+        std::array<GLsync, maxSections> fences{};
+        std::size_t section = 0, head = 0;
+        bool open = false;
+        streamStatistics stats{};
+
+        auto create() -> void;
+
+        auto destroy() -> void;
+    };
+}
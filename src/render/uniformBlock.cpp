@@ -0,0 +1,31 @@
+#include "uniformBlock.hpp"
+#include "glState.hpp"
+
+#include <cstring>
+
+namespace render {
+
+    UniformBlock::UniformBlock(GLuint binding, std::size_t size)
+            : binding(binding), alignment(offsetAlignment()), size(size),
+              stream(GL_UNIFORM_BUFFER, (size + alignment - 1) / alignment * alignment) {}
+
+    auto UniformBlock::update(const void *data) -> void {
+        stream.beginFrame();
+        auto slice = stream.allocate(size, alignment);
+        if (!slice.data) return;
+        std::memcpy(slice.data, data, size);
+        stream.commit(slice);
+        GLState::current().bindBufferRange(GL_UNIFORM_BUFFER, binding, slice.buffer, slice.offset,
+                                           (GLsizeiptr) size);
+    }
+
+    auto UniformBlock::endFrame() -> void {
+        stream.endFrame();
+    }
+
+    auto UniformBlock::offsetAlignment() -> std::size_t {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment > 0 ? (std::size_t) alignment : 256;
+    }
+}
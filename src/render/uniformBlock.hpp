@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <type_traits>
+
+#include "streamBuffer.hpp"
+
+namespace render {
+
+    // std140 image of the Camera block in static/shader/include/camera.glsl
+    struct cameraBlock {
+        glm::mat4 view{1};
+        glm::mat4 projection{1};
+        glm::mat4 viewProjection{1};
+        glm::vec4 position{0, 0, 0, 1};
+    };
+
+    static_assert(sizeof(cameraBlock) == 208, "cameraBlock must match the std140 layout of the Camera block");
+
+    // One uniform block's contents per frame, streamed through a StreamBuffer and bound as a range at a fixed
+    // binding point, so every program declaring the block sees it without any per-program upload.
+    class UniformBlock {
+    public:
+        UniformBlock(GLuint binding, std::size_t size);
+
+        UniformBlock(const UniformBlock &) = delete;
+
+        auto operator=(const UniformBlock &) -> UniformBlock & = delete;
+
+        // before the frame's draws: copies size bytes into this frame's section and binds them
+        auto update(const void *data) -> void;
+
+        template<typename T>
+        auto update(const T &value) -> void {
+            static_assert(std::is_trivially_copyable_v<T>);
+            update(static_cast<const void *>(&value));
+        }
+
+        // after the frame's draws, so the section is not rewritten while they may still read it
+        auto endFrame() -> void;
+
+    private:
+        GLuint binding;
+        std::size_t alignment, size;
+        StreamBuffer stream;
+
+        static auto offsetAlignment() -> std::size_t;
+    };
+}
@@ -0,0 +1,404 @@
+#include "bvh.hpp"
+#include "../transform/transformSoA.hpp"
+#include "../job/jobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <numeric>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCENE_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SCENE_TARGET_AVX2
+#else
+#define SCENE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace scene {
+
+    // per plane: which box corner is furthest along the normal, so one dot product decides the plane
+    struct preparedFrustum {
+        struct plane {
+            float a, b, c, d;
+            bool positiveX, positiveY, positiveZ;
+        };
+        plane planes[6];
+    };
+
+    namespace {
+        // empty children and padding get inverted boxes; finite, so a zero plane coefficient never makes NaN
+        constexpr float emptyMin = 1e30f, emptyMax = -1e30f;
+        // AVX2 leaves load 8 boxes starting at any slot
+        constexpr std::size_t slotPadding = 8;
+
+        auto prepare(const frustum &view) -> preparedFrustum {
+            preparedFrustum prepared{};
+            for (int i = 0; i < 6; i++) {
+                const auto &p = view.planes[i];
+                prepared.planes[i] = {p.x, p.y, p.z, p.w, p.x >= 0, p.y >= 0, p.z >= 0};
+            }
+            return prepared;
+        }
+
+        struct boxArrays {
+            const float *minX, *minY, *minZ, *maxX, *maxY, *maxZ;
+        };
+
+        // bit i of visible: box i intersects the frustum, of inside: box i lies completely inside it
+        auto classifyScalar(const preparedFrustum &f, const boxArrays &boxes, std::uint32_t count,
+                            std::uint32_t &visible, std::uint32_t &inside) -> void {
+            visible = inside = 0;
+            for (std::uint32_t i = 0; i < count; i++) {
+                bool in = true, all = true;
+                for (const auto &p: f.planes) {
+                    float far = p.a * (p.positiveX ? boxes.maxX[i] : boxes.minX[i]) +
+                                p.b * (p.positiveY ? boxes.maxY[i] : boxes.minY[i]) +
+                                p.c * (p.positiveZ ? boxes.maxZ[i] : boxes.minZ[i]) + p.d;
+                    float near = p.a * (p.positiveX ? boxes.minX[i] : boxes.maxX[i]) +
+                                 p.b * (p.positiveY ? boxes.minY[i] : boxes.maxY[i]) +
+                                 p.c * (p.positiveZ ? boxes.minZ[i] : boxes.maxZ[i]) + p.d;
+                    in = in && far >= 0;
+                    all = all && near >= 0;
+                }
+                visible |= (std::uint32_t) in << i;
+                inside |= (std::uint32_t) (in && all) << i;
+            }
+        }
+
+#ifdef SCENE_X86
+
+        auto classifySSE(const preparedFrustum &f, const boxArrays &boxes, std::uint32_t &visible,
+                         std::uint32_t &inside) -> void {
+            __m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1)), all = in;
+            for (const auto &p: f.planes) {
+                auto a = _mm_set1_ps(p.a), b = _mm_set1_ps(p.b), c = _mm_set1_ps(p.c), d = _mm_set1_ps(p.d);
+                auto far = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(p.positiveX ? boxes.maxX : boxes.minX)),
+                                                 _mm_mul_ps(b, _mm_loadu_ps(p.positiveY ? boxes.maxY : boxes.minY))),
+                                      _mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(p.positiveZ ? boxes.maxZ : boxes.minZ)), d));
+                auto near = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(p.positiveX ? boxes.minX : boxes.maxX)),
+                                                  _mm_mul_ps(b, _mm_loadu_ps(p.positiveY ? boxes.minY : boxes.maxY))),
+                                       _mm_add_ps(_mm_mul_ps(c, _mm_loadu_ps(p.positiveZ ? boxes.minZ : boxes.maxZ)), d));
+                in = _mm_and_ps(in, _mm_cmpge_ps(far, _mm_setzero_ps()));
+                all = _mm_and_ps(all, _mm_cmpge_ps(near, _mm_setzero_ps()));
+            }
+            visible = (std::uint32_t) _mm_movemask_ps(in);
+            inside = (std::uint32_t) _mm_movemask_ps(_mm_and_ps(in, all));
+        }
+
+        SCENE_TARGET_AVX2
+        auto visibleAVX2(const preparedFrustum &f, const boxArrays &boxes) -> std::uint32_t {
+            __m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const auto &p: f.planes) {
+                auto far = _mm256_fmadd_ps(_mm256_set1_ps(p.a), _mm256_loadu_ps(p.positiveX ? boxes.maxX : boxes.minX),
+                                           _mm256_set1_ps(p.d));
+                far = _mm256_fmadd_ps(_mm256_set1_ps(p.b), _mm256_loadu_ps(p.positiveY ? boxes.maxY : boxes.minY), far);
+                far = _mm256_fmadd_ps(_mm256_set1_ps(p.c), _mm256_loadu_ps(p.positiveZ ? boxes.maxZ : boxes.minZ), far);
+                in = _mm256_and_ps(in, _mm256_cmp_ps(far, _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            return (std::uint32_t) _mm256_movemask_ps(in);
+        }
+
+#endif
+
+        auto unite(float *min, float *max, float lowValue, float highValue) -> void {
+            *min = std::min(*min, lowValue);
+            *max = std::max(*max, highValue);
+        }
+    }
+
+    auto aabb::around(const glm::vec3 &center, float radius) -> aabb {
+        return {center - glm::vec3{radius}, center + glm::vec3{radius}};
+    }
+
+    auto frustum::fromMatrix(const glm::mat4 &viewProjection) -> frustum {
+        auto row = [&](int r) {
+            return glm::vec4{viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]};
+        };
+        frustum result{{row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                        row(3) - row(1), row(3) + row(2), row(3) - row(2)}};
+        for (auto &plane: result.planes) plane /= glm::length(glm::vec3{plane});
+        return result;
+    }
+
+
+    auto BVH::add(const aabb &bounds) -> std::uint32_t {
+        objectBounds.push_back(bounds);
+        needsBuild = true;
+        return (std::uint32_t) objectBounds.size() - 1;
+    }
+
+    auto BVH::update(std::uint32_t object, const aabb &bounds) -> void {
+        objectBounds[object] = bounds;
+        if (needsBuild) return;
+        auto slot = objectSlot[object];
+        writeSlot(slot);
+        for (auto index = slotNode[slot]; index != noChild && !dirty[index]; index = parent[index]) dirty[index] = 1;
+        needsRefit = true;
+    }
+
+    auto BVH::clear() -> void {
+        objectBounds.clear();
+        needsBuild = true;
+    }
+
+    auto BVH::build() -> void {
+        auto count = (std::uint32_t) objectBounds.size();
+        slotObject.resize(count);
+        std::iota(slotObject.begin(), slotObject.end(), 0u);
+        std::vector<glm::vec3> centroids(count);
+        for (std::uint32_t i = 0; i < count; i++) centroids[i] = (objectBounds[i].min + objectBounds[i].max) * 0.5f;
+
+        nodes.clear();
+        parent.clear();
+        nodeRange.clear();
+        dirty.clear();
+        slotNode.assign(count, noChild);
+        if (count > 0) buildNode(0, count, noChild, centroids);
+
+        objectSlot.resize(count);
+        for (auto *component: {&minX, &minY, &minZ}) component->assign(count + slotPadding, emptyMin);
+        for (auto *component: {&maxX, &maxY, &maxZ}) component->assign(count + slotPadding, emptyMax);
+        for (std::uint32_t slot = 0; slot < count; slot++) {
+            objectSlot[slotObject[slot]] = slot;
+            writeSlot(slot);
+        }
+        needsBuild = false;
+        needsRefit = true;
+        refit();
+    }
+
+    auto BVH::refit() -> void {
+        if (needsBuild) {
+            build();
+            return;
+        }
+        for (auto index = (std::uint32_t) nodes.size(); index-- > 0;) {
+            if (dirty[index]) {
+                refitNode(index);
+                dirty[index] = 0;
+            }
+        }
+        needsRefit = false;
+    }
+
+    auto BVH::cull(const frustum &view, std::vector<std::uint32_t> &visible, unsigned int threads) -> void {
+        if (needsBuild || needsRefit) refit();
+        if (nodes.empty()) return;
+        auto planes = prepare(view);
+        if (threads <= 1) {
+            cullNode(planes, 0, visible, nullptr);
+            return;
+        }
+
+        auto subtrees = expand(planes, threads * 4, visible);
+        if (subtrees.empty()) return;
+
+        std::vector<std::vector<std::uint32_t>> results(std::min<std::size_t>(threads, subtrees.size()));
+        std::atomic<std::size_t> cursor{0};
+        std::vector<std::thread> workers;
+        for (std::size_t w = 1; w < results.size(); w++) {
+            workers.emplace_back([&, w] {
+                for (std::size_t i; (i = cursor.fetch_add(1, std::memory_order_relaxed)) < subtrees.size();) {
+                    cullNode(planes, subtrees[i], results[w], nullptr);
+                }
+            });
+        }
+        for (std::size_t i; (i = cursor.fetch_add(1, std::memory_order_relaxed)) < subtrees.size();) {
+            cullNode(planes, subtrees[i], results[0], nullptr);
+        }
+        for (auto &worker: workers) worker.join();
+        for (const auto &result: results) visible.insert(visible.end(), result.begin(), result.end());
+    }
+
+    auto BVH::cull(const frustum &view, std::vector<std::uint32_t> &visible, job::JobSystem &jobs) -> void {
+        if (needsBuild || needsRefit) refit();
+        if (nodes.empty()) return;
+        auto planes = prepare(view);
+        auto subtrees = expand(planes, jobs.concurrency() * 8, visible);
+        if (subtrees.empty()) return;
+
+        // one result list per chunk, any participant may run any chunk
+        constexpr std::size_t grain = 2;
+        std::vector<std::vector<std::uint32_t>> results((subtrees.size() + grain - 1) / grain);
+        jobs.parallelFor(subtrees.size(), grain, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++) cullNode(planes, subtrees[i], results[begin / grain], nullptr);
+        });
+        for (const auto &result: results) visible.insert(visible.end(), result.begin(), result.end());
+    }
+
+    auto BVH::size() const -> std::size_t {
+        return objectBounds.size();
+    }
+
+    // expands level by level until there are enough subtrees to keep every worker busy; leaves met on the
+    // way are culled right away
+    auto BVH::expand(const preparedFrustum &planes, std::size_t target, std::vector<std::uint32_t> &visible) const
+    -> std::vector<std::uint32_t> {
+        std::vector<std::uint32_t> subtrees{0}, next;
+        while (!subtrees.empty() && subtrees.size() < target) {
+            next.clear();
+            for (auto index: subtrees) cullNode(planes, index, visible, &next);
+            subtrees.swap(next);
+        }
+        return subtrees;
+    }
+
+    auto BVH::bounds(std::uint32_t object) const -> const aabb & {
+        return objectBounds[object];
+    }
+
+    // splits the range at the centroid median of its longest axis until there are four parts or every
+    // part fits a leaf; parts that still do not fit become child nodes
+    auto BVH::buildNode(std::uint32_t begin, std::uint32_t end, std::uint32_t parentIndex,
+                        const std::vector<glm::vec3> &centroids) -> std::uint32_t {
+        auto index = (std::uint32_t) nodes.size();
+        nodes.emplace_back();
+        parent.push_back(parentIndex);
+        nodeRange.push_back({begin, end});
+        dirty.push_back(1);
+
+        std::vector<range> parts{{begin, end}};
+        while (parts.size() < 4) {
+            auto largest = std::max_element(parts.begin(), parts.end(), [](const range &a, const range &b) {
+                return a.end - a.begin < b.end - b.begin;
+            });
+            if (largest->end - largest->begin <= leafSize) break;
+            glm::vec3 low{emptyMin}, high{emptyMax};
+            for (auto slot = largest->begin; slot < largest->end; slot++) {
+                low = glm::min(low, centroids[slotObject[slot]]);
+                high = glm::max(high, centroids[slotObject[slot]]);
+            }
+            auto extent = high - low;
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+            auto middle = largest->begin + (largest->end - largest->begin) / 2;
+            std::nth_element(slotObject.begin() + largest->begin, slotObject.begin() + middle,
+                             slotObject.begin() + largest->end, [&](std::uint32_t a, std::uint32_t b) {
+                        return centroids[a][axis] < centroids[b][axis];
+                    });
+            range upper{middle, largest->end};
+            largest->end = middle;
+            parts.push_back(upper);
+        }
+
+        for (std::uint32_t c = 0; c < 4; c++) {
+            std::uint32_t child = noChild, count = 0;
+            if (c < parts.size()) {
+                auto [partBegin, partEnd] = parts[c];
+                if (partEnd - partBegin <= leafSize) {
+                    child = partBegin;
+                    count = partEnd - partBegin;
+                    for (auto slot = partBegin; slot < partEnd; slot++) slotNode[slot] = index;
+                } else {
+                    child = buildNode(partBegin, partEnd, index, centroids);
+                }
+            }
+            nodes[index].child[c] = child;
+            nodes[index].count[c] = count;
+        }
+        return index;
+    }
+
+    auto BVH::writeSlot(std::uint32_t slot) -> void {
+        const auto &box = objectBounds[slotObject[slot]];
+        minX[slot] = box.min.x;
+        minY[slot] = box.min.y;
+        minZ[slot] = box.min.z;
+        maxX[slot] = box.max.x;
+        maxY[slot] = box.max.y;
+        maxZ[slot] = box.max.z;
+    }
+
+    auto BVH::refitNode(std::uint32_t index) -> void {
+        auto &n = nodes[index];
+        for (int c = 0; c < 4; c++) {
+            n.minX[c] = n.minY[c] = n.minZ[c] = emptyMin;
+            n.maxX[c] = n.maxY[c] = n.maxZ[c] = emptyMax;
+            if (n.count[c] > 0) {
+                for (auto slot = n.child[c]; slot < n.child[c] + n.count[c]; slot++) {
+                    unite(&n.minX[c], &n.maxX[c], minX[slot], maxX[slot]);
+                    unite(&n.minY[c], &n.maxY[c], minY[slot], maxY[slot]);
+                    unite(&n.minZ[c], &n.maxZ[c], minZ[slot], maxZ[slot]);
+                }
+            } else if (n.child[c] != noChild) {
+                const auto &child = nodes[n.child[c]];
+                for (int g = 0; g < 4; g++) {
+                    unite(&n.minX[c], &n.maxX[c], child.minX[g], child.maxX[g]);
+                    unite(&n.minY[c], &n.maxY[c], child.minY[g], child.maxY[g]);
+                    unite(&n.minZ[c], &n.maxZ[c], child.minZ[g], child.maxZ[g]);
+                }
+            }
+        }
+    }
+
+    auto BVH::cullNode(const preparedFrustum &planes, std::uint32_t index, std::vector<std::uint32_t> &visible,
+                       std::vector<std::uint32_t> *deferred) const -> void {
+        const auto &n = nodes[index];
+        boxArrays children{n.minX, n.minY, n.minZ, n.maxX, n.maxY, n.maxZ};
+        std::uint32_t visibleMask, insideMask;
+#ifdef SCENE_X86
+        if (transform::activeKernel() != transform::kernel::scalar) {
+            classifySSE(planes, children, visibleMask, insideMask);
+        } else
+#endif
+        {
+            classifyScalar(planes, children, 4, visibleMask, insideMask);
+        }
+
+        for (std::uint32_t c = 0; c < 4; c++) {
+            if (!(visibleMask & (1u << c))) continue;
+            bool inside = insideMask & (1u << c);
+            if (n.count[c] > 0) {
+                if (inside) appendRange(n.child[c], n.child[c] + n.count[c], visible);
+                else cullLeaf(planes, n.child[c], n.count[c], visible);
+            } else if (inside) {
+                appendRange(nodeRange[n.child[c]].begin, nodeRange[n.child[c]].end, visible);
+            } else if (deferred) {
+                deferred->push_back(n.child[c]);
+            } else {
+                cullNode(planes, n.child[c], visible, nullptr);
+            }
+        }
+    }
+
+    auto BVH::cullLeaf(const preparedFrustum &planes, std::uint32_t first, std::uint32_t count,
+                       std::vector<std::uint32_t> &visible) const -> void {
+        boxArrays boxes{&minX[first], &minY[first], &minZ[first], &maxX[first], &maxY[first], &maxZ[first]};
+        std::uint32_t mask = 0;
+        switch (transform::activeKernel()) {
+#ifdef SCENE_X86
+            case transform::kernel::avx2:
+                mask = visibleAVX2(planes, boxes);
+                break;
+            case transform::kernel::sse: {
+                std::uint32_t low, high, unused;
+                classifySSE(planes, boxes, low, unused);
+                boxArrays upper{boxes.minX + 4, boxes.minY + 4, boxes.minZ + 4,
+                                boxes.maxX + 4, boxes.maxY + 4, boxes.maxZ + 4};
+                classifySSE(planes, upper, high, unused);
+                mask = low | high << 4;
+                break;
+            }
+#endif
+            default: {
+                std::uint32_t unused;
+                classifyScalar(planes, boxes, count, mask, unused);
+            }
+        }
+        mask &= (1u << count) - 1;
+        while (mask) {
+            auto bit = (std::uint32_t) std::countr_zero(mask);
+            visible.push_back(slotObject[first + bit]);
+            mask &= mask - 1;
+        }
+    }
+
+    auto BVH::appendRange(std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t> &visible) const -> void {
+        visible.insert(visible.end(), slotObject.begin() + begin, slotObject.begin() + end);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace job {
+    class JobSystem;
+}
+
+namespace scene {
+
+    struct aabb {
+        glm::vec3 min{0};
+        glm::vec3 max{0};
+
+        // box around a sphere, stays valid however the object inside rotates
+        static auto around(const glm::vec3 &center, float radius) -> aabb;
+    };
+
+    // Six normalized planes, inside where dot(plane.xyz, p) + plane.w >= 0.
+    struct frustum {
+        std::array<glm::vec4, 6> planes;
+
+        // Gribb/Hartmann extraction from projection * view
+        static auto fromMatrix(const glm::mat4 &viewProjection) -> frustum;
+    };
+
+    struct preparedFrustum;
+
+    // Bounding volume hierarchy over object boxes. Nodes have four children whose boxes are stored as
+    // structure of arrays, so one SIMD test classifies all of them; leaves hold up to leafSize objects whose
+    // boxes sit contiguously in leaf order and are tested 4 (SSE) or 8 (AVX2) at a time. The kernel follows
+    // transform::activeKernel().
+    class BVH {
+    public:
+        static constexpr std::uint32_t leafSize = 8;
+
+        auto add(const aabb &bounds) -> std::uint32_t;
+
+        // moving objects keep their place in the tree, only the boxes on their path are refitted
+        auto update(std::uint32_t object, const aabb &bounds) -> void;
+
+        auto clear() -> void;
+
+        // rebuilds after add(), refits after update(); both also happen on demand in cull()
+        auto build() -> void;
+
+        auto refit() -> void;
+
+        // appends the ids of every object intersecting the frustum, over threads workers
+        auto cull(const frustum &view, std::vector<std::uint32_t> &visible, unsigned int threads = 1) -> void;
+
+        // same, with the subtrees fanned out as jobs; the caller helps until they are done
+        auto cull(const frustum &view, std::vector<std::uint32_t> &visible, job::JobSystem &jobs) -> void;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+
+        [[nodiscard]] auto bounds(std::uint32_t object) const -> const aabb &;
+
+    private:
+        static constexpr std::uint32_t noChild = ~0u;
+
+        struct node {
+            float minX[4], minY[4], minZ[4], maxX[4], maxY[4], maxZ[4];
+            // inner child: node index; leaf child: first slot
+            std::uint32_t child[4];
+            // objects in a leaf child, 0 for inner and empty children
+            std::uint32_t count[4];
+        };
+
+        struct range {
+            std::uint32_t begin, end;
+        };
+
+        std::vector<aabb> objectBounds{};
+
+        // leaf order: slot -> object, plus the object boxes per slot as one array per component
+        std::vector<std::uint32_t> slotObject{}, objectSlot{}, slotNode{};
+        std::vector<float> minX{}, minY{}, minZ{}, maxX{}, maxY{}, maxZ{};
+
+        // children always come after their parent
+        std::vector<node> nodes{};
+        std::vector<std::uint32_t> parent{};
+        std::vector<range> nodeRange{};
+        std::vector<std::uint8_t> dirty{};
+
+        bool needsBuild = false, needsRefit = false;
+
+        auto buildNode(std::uint32_t begin, std::uint32_t end, std::uint32_t parentIndex,
+                       const std::vector<glm::vec3> &centroids) -> std::uint32_t;
+
+        auto writeSlot(std::uint32_t slot) -> void;
+
+        auto refitNode(std::uint32_t index) -> void;
+
+        auto cullNode(const preparedFrustum &planes, std::uint32_t index, std::vector<std::uint32_t> &visible,
+                      std::vector<std::uint32_t> *deferred) const -> void;
+
+        auto cullLeaf(const preparedFrustum &planes, std::uint32_t first, std::uint32_t count,
+                      std::vector<std::uint32_t> &visible) const -> void;
+
+        [[nodiscard]] auto expand(const preparedFrustum &planes, std::size_t target,
+                                  std::vector<std::uint32_t> &visible) const -> std::vector<std::uint32_t>;
+
+        auto appendRange(std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t> &visible) const -> void;
+    };
+}
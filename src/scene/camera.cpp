@@ -0,0 +1,107 @@
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace scene {
+
+    Camera::Camera(const glm::vec3 &position, float yaw, float pitch) : eye(position), yaw(yaw), pitch(pitch) {
+        setAngles(yaw, pitch);
+    }
+
+    auto Camera::setPosition(const glm::vec3 &position) -> void {
+        eye = position;
+        viewDirty = true;
+    }
+
+    auto Camera::move(const glm::vec3 &offset) -> void {
+        setPosition(eye + offset);
+    }
+
+    auto Camera::setAngles(float newYaw, float newPitch) -> void {
+        yaw = newYaw;
+        pitch = std::clamp(newPitch, -89.0f, 89.0f);
+        directionDirty = viewDirty = true;
+    }
+
+    auto Camera::turn(float yawOffset, float pitchOffset) -> void {
+        setAngles(yaw + yawOffset, pitch + pitchOffset);
+    }
+
+    auto Camera::lookAt(const glm::vec3 &target) -> void {
+        auto towards = glm::normalize(target - eye);
+        setAngles(glm::degrees(std::atan2(towards.z, towards.x)), glm::degrees(std::asin(towards.y)));
+        // keep the exact direction rather than the one the angles round-trip to
+        direction = towards;
+        directionDirty = false;
+    }
+
+    auto Camera::setViewport(int width, int height) -> void {
+        if (width <= 0 || height <= 0) return;
+        aspect = (float) width / (float) height;
+        viewportHeight = height;
+        projectionDirty = true;
+    }
+
+    auto Camera::setPerspective(float newFieldOfView, float newNear, float newFar) -> void {
+        fieldOfView = newFieldOfView;
+        nearPlane = newNear;
+        farPlane = newFar;
+        projectionDirty = true;
+    }
+
+    auto Camera::position() const -> const glm::vec3 & {
+        return eye;
+    }
+
+    auto Camera::front() const -> const glm::vec3 & {
+        update();
+        return direction;
+    }
+
+    auto Camera::right() const -> glm::vec3 {
+        return glm::normalize(glm::cross(front(), up));
+    }
+
+    auto Camera::view() const -> const glm::mat4 & {
+        update();
+        return viewMatrix;
+    }
+
+    auto Camera::projection() const -> const glm::mat4 & {
+        update();
+        return projectionMatrix;
+    }
+
+    auto Camera::viewProjection() const -> const glm::mat4 & {
+        update();
+        return viewProjectionMatrix;
+    }
+
+    auto Camera::block() const -> render::cameraBlock {
+        update();
+        return {viewMatrix, projectionMatrix, viewProjectionMatrix, glm::vec4{eye, 1}};
+    }
+
+    auto Camera::pixelsPerUnit(float distance) const -> float {
+        return 0.5f * (float) viewportHeight * projection()[1][1] / std::max(distance, nearPlane);
+    }
+
+    auto Camera::update() const -> void {
+        if (directionDirty) {
+            auto yawRadians = glm::radians(yaw), pitchRadians = glm::radians(pitch);
+            direction = glm::normalize(glm::vec3{std::cos(pitchRadians) * std::cos(yawRadians),
+                                                 std::sin(pitchRadians),
+                                                 std::cos(pitchRadians) * std::sin(yawRadians)});
+            directionDirty = false;
+        }
+        if (viewDirty) viewMatrix = glm::lookAt(eye, eye + direction, up);
+        if (projectionDirty) {
+            projectionMatrix = glm::perspective(glm::radians(fieldOfView), aspect, nearPlane, farPlane);
+        }
+        if (viewDirty || projectionDirty) viewProjectionMatrix = projectionMatrix * viewMatrix;
+        viewDirty = projectionDirty = false;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "../render/uniformBlock.hpp"
+
+namespace scene {
+
+    // Free-look perspective camera. Setters only mark the matrices dirty; view, projection and their product
+    // are recomputed on the first read after a change, however many times a frame reads them.
+    class Camera {
+    public:
+        explicit Camera(const glm::vec3 &position = {0, 0, 3}, float yaw = 0, float pitch = 0);
+
+        auto setPosition(const glm::vec3 &position) -> void;
+
+        auto move(const glm::vec3 &offset) -> void;
+
+        // degrees; pitch is kept within +-89 so the view never flips over the up axis
+        auto setAngles(float yaw, float pitch) -> void;
+
+        auto turn(float yawOffset, float pitchOffset) -> void;
+
+        // faces target from the current position
+        auto lookAt(const glm::vec3 &target) -> void;
+
+        auto setViewport(int width, int height) -> void;
+
+        // vertical field of view in degrees
+        auto setPerspective(float fieldOfView, float nearPlane, float farPlane) -> void;
+
+        [[nodiscard]] auto position() const -> const glm::vec3 &;
+
+        [[nodiscard]] auto front() const -> const glm::vec3 &;
+
+        [[nodiscard]] auto right() const -> glm::vec3;
+
+        [[nodiscard]] auto view() const -> const glm::mat4 &;
+
+        [[nodiscard]] auto projection() const -> const glm::mat4 &;
+
+        [[nodiscard]] auto viewProjection() const -> const glm::mat4 &;
+
+        [[nodiscard]] auto block() const -> render::cameraBlock;
+
+        // screen pixels one world unit spans at distance along the view direction
+        [[nodiscard]] auto pixelsPerUnit(float distance) const -> float;
+
+    private:
+        static constexpr glm::vec3 up{0, 1, 0};
+
+        glm::vec3 eye;
+        float yaw, pitch;
+        float fieldOfView = 45.0f, aspect = 4.0f / 3.0f, nearPlane = 0.1f, farPlane = 100.0f;
+        int viewportHeight = 600;
+
+        mutable glm::vec3 direction{};
+        mutable glm::mat4 viewMatrix{1}, projectionMatrix{1}, viewProjectionMatrix{1};
+        mutable bool directionDirty = true, viewDirty = true, projectionDirty = true;
+
+        auto update() const -> void;
+    };
+}
@@ -0,0 +1,230 @@
+#include <glad/glad.h>
+
+#include "cubeScene.hpp"
+#include "../render/glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace scene {
+
+    CubeScene::CubeScene(job::JobSystem *jobs)
+            : jobs(jobs), cube(cubeCorners(), {mesh::positionFormat::half16, mesh::normalFormat::none, mesh::uvFormat::unorm16}) {
+        const char *vPath = STATIC_FILE_PATH"/static/shader/instancedVertexShader.vert";
+        const char *fPath = STATIC_FILE_PATH"/static/shader/fragmentShader.frag";
+
+        shader::Shader vertexShader(vPath, GL_VERTEX_SHADER);
+        shader::Shader fragmentShader(fPath, GL_FRAGMENT_SHADER);
+        shaderChain
+                .add(std::move(vertexShader))
+                .add(std::move(fragmentShader))
+                .setCache(&programCache)
+                .load();
+
+        render::GLState::current().enable(GL_DEPTH_TEST);
+
+        wallTexture
+                .addResidentTexture(textureResidency, BAKED_FILE_PATH"/texture2D/face.ltex", GL_TEXTURE1)
+                .addResidentTexture(textureResidency, BAKED_FILE_PATH"/texture2D/container.ltex", GL_TEXTURE0);
+
+        cubeMaterial = drawQueue.addMaterial({&shaderChain, &wallTexture});
+        cubeMesh = drawQueue.addMesh(cube.drawable());
+
+        shaderChain.use();
+
+        using namespace shader::literals;
+        shaderChain.set("texture1"_u, 0);
+        // or set it via the texture class
+        shaderChain.set("texture2", (int) 1);
+
+        glm::vec3 cubePosition[] = {
+                glm::vec3(0.0f, 0.0f, 0.0f),
+                glm::vec3(2.0f, 5.0f, -15.0f),
+                glm::vec3(-1.5f, -2.2f, -2.5f),
+                glm::vec3(-3.8f, -2.0f, -12.3f),
+                glm::vec3(2.4f, -0.4f, -3.5f),
+                glm::vec3(-1.7f, 3.0f, -7.5f),
+                glm::vec3(1.3f, -2.0f, -2.5f),
+                glm::vec3(1.5f, 2.0f, -2.5f),
+                glm::vec3(1.5f, 0.2f, -1.5f),
+                glm::vec3(-1.3f, 1.0f, -1.5f)
+        };
+
+        // cubes only spin in place, so a box around their bounding sphere never needs a refit
+        for (auto i = 0; i < 10; i++) {
+            cubeTransforms.add(cubePosition[i], glm::vec3{0.5, 1, 0}, 20.0f * i, glm::radians(90.0f));
+            cubeBounds.add(aabb::around(cubePosition[i], 0.87f));
+        }
+        cubeModels.resize(cubeTransforms.size());
+    }
+
+    auto CubeScene::frame(float time, const Camera &camera) -> void {
+        textureResidency.update();
+        drawQueue.beginFrame();
+        cameraUniforms.update(camera.block());
+        if (jobs) {
+            frameJobs(time, camera);
+            cameraUniforms.endFrame();
+            return;
+        }
+        const auto &eye = camera.position();
+        {
+            PROFILE_SCOPE("transform + cull");
+            transform::computeModels(cubeTransforms, time, &cubeModels[0][0][0]);
+            visibleCubes.clear();
+            cubeBounds.cull(frustum::fromMatrix(camera.viewProjection()), visibleCubes);
+        }
+        {
+            PROFILE_SCOPE("occlusion");
+            cullOccluded(camera.viewProjection());
+        }
+        {
+            PROFILE_SCOPE("record");
+            auto &recorder = drawQueue.recorder();
+            for (auto index: visibleCubes) {
+                const auto &model = cubeModels[index];
+                recorder.draw(cubeMaterial, cubeMesh, glm::distance(eye, glm::vec3{model[3]}), model);
+            }
+        }
+        drawQueue.sort();
+        requestTextureLevels(camera);
+        {
+            PROFILE_GPU_SCOPE("cubes");
+            drawQueue.submit();
+        }
+        cameraUniforms.endFrame();
+    }
+
+    // transforms and culling fan out first, occlusion needs both and recording starts after it; meanwhile the
+    // GL thread helps until everything is recorded
+    auto CubeScene::frameJobs(float time, const Camera &camera) -> void {
+        constexpr std::size_t modelGrain = 1024, recordGrain = 512;
+        job::counter prepared, occluded, recorded;
+        jobs->parallelFor(cubeModels.size(), modelGrain, [this, time](std::size_t begin, std::size_t end) {
+            PROFILE_SCOPE("transform");
+            transform::computeModels(cubeTransforms, begin, end, time, &cubeModels[0][0][0]);
+        }, &prepared);
+        auto viewFrustum = frustum::fromMatrix(camera.viewProjection());
+        auto eye = camera.position();
+        jobs->run([this, viewFrustum] {
+            PROFILE_SCOPE("cull");
+            visibleCubes.clear();
+            cubeBounds.cull(viewFrustum, visibleCubes, *jobs);
+        }, &prepared);
+        jobs->run([this, viewProjection = camera.viewProjection()] {
+            PROFILE_SCOPE("occlusion");
+            cullOccluded(viewProjection);
+        }, &occluded, &prepared);
+        jobs->run([this, eye] {
+            jobs->parallelFor(visibleCubes.size(), recordGrain, [this, eye](std::size_t begin, std::size_t end) {
+                PROFILE_SCOPE("record");
+                auto &recorder = drawQueue.recorder();
+                for (auto i = begin; i < end; i++) {
+                    const auto &model = cubeModels[visibleCubes[i]];
+                    recorder.draw(cubeMaterial, cubeMesh, glm::distance(eye, glm::vec3{model[3]}), model);
+                }
+            });
+        }, &recorded, &occluded);
+
+        jobs->wait(recorded);
+        jobs->wait(occluded);
+        jobs->wait(prepared);
+        drawQueue.sort();
+        requestTextureLevels(camera);
+        {
+            PROFILE_GPU_SCOPE("cubes");
+            drawQueue.submit();
+        }
+    }
+
+    auto CubeScene::cullOccluded(const glm::mat4 &viewProjection) -> void {
+        occlusionBuffer.begin(viewProjection);
+        for (auto index: visibleCubes) occlusionBuffer.addOccluder(cubeOccluder, cubeModels[index]);
+        occlusionBuffer.render(jobs);
+        occlusionBuffer.cull(cubeBounds, visibleCubes);
+    }
+
+    auto CubeScene::requestTextureLevels(const Camera &camera) -> void {
+        if (visibleCubes.empty()) return;
+        const auto &eye = camera.position();
+        auto nearest = std::numeric_limits<float>::max();
+        for (auto index: visibleCubes) nearest = std::min(nearest, glm::distance(eye, glm::vec3{cubeModels[index][3]}));
+        // a face is one unit wide; the nearest point of the cube is about half its diagonal closer than its centre
+        wallTexture.setScreenSize(camera.pixelsPerUnit(nearest - 0.87f));
+    }
+
+    auto CubeScene::drawCalls() const -> std::size_t {
+        return drawQueue.drawCalls();
+    }
+
+    auto CubeScene::visible() const -> std::size_t {
+        return visibleCubes.size();
+    }
+
+    auto CubeScene::instanceStream() const -> const render::StreamBuffer & {
+        return drawQueue.stream();
+    }
+
+    auto CubeScene::residency() const -> const texture::ResidencyManager & {
+        return textureResidency;
+    }
+
+    auto CubeScene::occlusion() const -> const OcclusionBuffer & {
+        return occlusionBuffer;
+    }
+
+    // the soup is welded into 24 indexed vertices, half-float positions and 16-bit uvs
+    auto CubeScene::cubeCorners() -> std::vector<mesh::vertex> {
+        float vertices[] = {
+                -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+                0.5f, -0.5f, -0.5f, 1.0f, 0.0f,
+                0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+                0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+                -0.5f, 0.5f, -0.5f, 0.0f, 1.0f,
+                -0.5f, -0.5f, -0.5f, 0.0f, 0.0f,
+
+                -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+                0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+                0.5f, 0.5f, 0.5f, 1.0f, 1.0f,
+                0.5f, 0.5f, 0.5f, 1.0f, 1.0f,
+                -0.5f, 0.5f, 0.5f, 0.0f, 1.0f,
+                -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+
+                -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+                -0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+                -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+                -0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+
+                0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+                0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+                0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+                0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+
+                -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+                0.5f, -0.5f, -0.5f, 1.0f, 1.0f,
+                0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+                0.5f, -0.5f, 0.5f, 1.0f, 0.0f,
+                -0.5f, -0.5f, 0.5f, 0.0f, 0.0f,
+                -0.5f, -0.5f, -0.5f, 0.0f, 1.0f,
+
+                -0.5f, 0.5f, -0.5f, 0.0f, 1.0f,
+                0.5f, 0.5f, -0.5f, 1.0f, 1.0f,
+                0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+                0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
+                -0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
+                -0.5f, 0.5f, -0.5f, 0.0f, 1.0f
+        };
+        std::vector<mesh::vertex> corners;
+        for (std::size_t i = 0; i < std::size(vertices); i += 5) {
+            corners.push_back({{vertices[i], vertices[i + 1], vertices[i + 2]}, {},
+                               {vertices[i + 3], vertices[i + 4]}});
+        }
+        return corners;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.hpp"
+#include "occlusion.hpp"
+#include "camera.hpp"
+#include "../shader/shader.hpp"
+#include "../shader/programCache.hpp"
+#include "../texture/texture2D.hpp"
+#include "../render/commandQueue.hpp"
+#include "../render/uniformBlock.hpp"
+#include "../mesh/mesh.hpp"
+#include "../transform/transformSoA.hpp"
+#include "../job/jobSystem.hpp"
+
+namespace scene {
+
+    // The ten spinning textured cubes: everything a frame draws except the window, the clock and the camera,
+    // so the interactive app and the headless render bench produce the same frames. Needs a current context.
+    // The camera reaches the shaders through the shared Camera block, written once per frame.
+    // With a job system the transforms, culling and recording run as jobs and the GL thread only submits.
+    // Cubes left by the frustum also occlude each other on the CPU before any command is recorded.
+    class CubeScene {
+    public:
+        explicit CubeScene(job::JobSystem *jobs = nullptr);
+
+        CubeScene(const CubeScene &) = delete;
+
+        auto operator=(const CubeScene &) -> CubeScene & = delete;
+
+        // animates to time seconds, culls against the camera and submits the visible cubes
+        auto frame(float time, const Camera &camera) -> void;
+
+        [[nodiscard]] auto drawCalls() const -> std::size_t;
+
+        [[nodiscard]] auto visible() const -> std::size_t;
+
+        [[nodiscard]] auto instanceStream() const -> const render::StreamBuffer &;
+
+        [[nodiscard]] auto residency() const -> const texture::ResidencyManager &;
+
+        [[nodiscard]] auto occlusion() const -> const OcclusionBuffer &;
+
+    private:
+        job::JobSystem *jobs;
+        shader::ProgramCache programCache{SHADER_CACHE_PATH};
+        shader::ShaderProgram shaderChain{};
+        mesh::Mesh cube;
+        // the baked textures start at their 64x64 tail and sharpen as far as the nearest cube on screen needs
+        texture::ResidencyManager textureResidency{64u << 20};
+        texture::texture2DLoader wallTexture{};
+        render::CommandQueue drawQueue{};
+        render::materialHandle cubeMaterial{};
+        render::meshHandle cubeMesh{};
+        render::UniformBlock cameraUniforms{shader::blockBinding::camera, sizeof(render::cameraBlock)};
+
+        transform::transformSoA cubeTransforms{};
+        BVH cubeBounds{};
+        OcclusionBuffer occlusionBuffer{256, 192};
+        occluderMesh cubeOccluder = occluderMesh::box(glm::vec3{-0.5f}, glm::vec3{0.5f});
+        std::vector<glm::mat4> cubeModels{};
+        std::vector<std::uint32_t> visibleCubes{};
+
+        auto frameJobs(float time, const Camera &camera) -> void;
+
+        // every visible cube is an occluder, the hidden ones leave visibleCubes
+        auto cullOccluded(const glm::mat4 &viewProjection) -> void;
+
+        // the wall textures stream in as far as the nearest visible cube's faces span on screen
+        auto requestTextureLevels(const Camera &camera) -> void;
+
+        static auto cubeCorners() -> std::vector<mesh::vertex>;
+    };
+}
@@ -0,0 +1,333 @@
+#include "occlusion.hpp"
+#include "../transform/transformSoA.hpp"
+#include "../job/jobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCENE_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SCENE_TARGET_AVX2
+#else
+#define SCENE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace scene {
+
+    namespace {
+        // clip w below this counts as crossing the near plane
+        constexpr float nearW = 1e-4f;
+
+        // the covered part of one triangle inside one tile: rows y0..y1 and columns x0..x1, x0 a multiple of 8
+        struct span {
+            int x0, x1, y0, y1;
+        };
+
+        auto rasterScalar(const rasterTriangle &t, const span &s, float *pixels, int stride) -> void {
+            for (int y = s.y0; y <= s.y1; y++) {
+                auto py = (float) y + 0.5f;
+                auto *row = pixels + (std::size_t) y * stride;
+                for (int x = s.x0; x <= s.x1; x++) {
+                    auto px = (float) x + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++) inside = inside && t.edgeA[e] * px + t.edgeB[e] * py + t.edgeC[e] >= 0;
+                    if (inside) row[x] = std::min(row[x], t.depthA * px + t.depthB * py + t.depthC);
+                }
+            }
+        }
+
+#ifdef SCENE_X86
+
+        auto rasterSSE(const rasterTriangle &t, const span &s, float *pixels, int stride) -> void {
+            auto a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+            auto depthA = _mm_set1_ps(t.depthA);
+            auto centers = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            for (int y = s.y0; y <= s.y1; y++) {
+                auto py = (float) y + 0.5f;
+                auto r0 = _mm_set1_ps(t.edgeB[0] * py + t.edgeC[0]), r1 = _mm_set1_ps(t.edgeB[1] * py + t.edgeC[1]),
+                        r2 = _mm_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+                auto rowDepth = _mm_set1_ps(t.depthB * py + t.depthC);
+                auto *row = pixels + (std::size_t) y * stride;
+                for (int x = s.x0; x <= s.x1; x += 4) {
+                    auto px = _mm_add_ps(_mm_set1_ps((float) x), centers);
+                    auto inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), _mm_setzero_ps()),
+                                             _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), _mm_setzero_ps()));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), _mm_setzero_ps()));
+                    if (!_mm_movemask_ps(inside)) continue;
+                    auto old = _mm_loadu_ps(row + x);
+                    auto nearer = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth));
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+                }
+            }
+        }
+
+        SCENE_TARGET_AVX2
+        auto rasterAVX2(const rasterTriangle &t, const span &s, float *pixels, int stride) -> void {
+            auto a0 = _mm256_set1_ps(t.edgeA[0]), a1 = _mm256_set1_ps(t.edgeA[1]), a2 = _mm256_set1_ps(t.edgeA[2]);
+            auto depthA = _mm256_set1_ps(t.depthA);
+            auto centers = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+            for (int y = s.y0; y <= s.y1; y++) {
+                auto py = (float) y + 0.5f;
+                auto r0 = _mm256_set1_ps(t.edgeB[0] * py + t.edgeC[0]);
+                auto r1 = _mm256_set1_ps(t.edgeB[1] * py + t.edgeC[1]);
+                auto r2 = _mm256_set1_ps(t.edgeB[2] * py + t.edgeC[2]);
+                auto rowDepth = _mm256_set1_ps(t.depthB * py + t.depthC);
+                auto *row = pixels + (std::size_t) y * stride;
+                for (int x = s.x0; x <= s.x1; x += 8) {
+                    auto px = _mm256_add_ps(_mm256_set1_ps((float) x), centers);
+                    auto zero = _mm256_setzero_ps();
+                    auto inside = _mm256_and_ps(_mm256_cmp_ps(_mm256_fmadd_ps(a0, px, r0), zero, _CMP_GE_OQ),
+                                                _mm256_cmp_ps(_mm256_fmadd_ps(a1, px, r1), zero, _CMP_GE_OQ));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(a2, px, r2), zero, _CMP_GE_OQ));
+                    if (!_mm256_movemask_ps(inside)) continue;
+                    auto old = _mm256_loadu_ps(row + x);
+                    auto nearer = _mm256_min_ps(old, _mm256_fmadd_ps(depthA, px, rowDepth));
+                    _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, nearer, inside));
+                }
+            }
+        }
+
+#endif
+
+        // farthest of a blockWidth x blockHeight block
+        auto farthest(const float *pixels, int stride) -> float {
+#ifdef SCENE_X86
+            auto far = _mm_loadu_ps(pixels);
+            for (int y = 0; y < OcclusionBuffer::blockHeight; y++) {
+                const auto *row = pixels + (std::size_t) y * stride;
+                far = _mm_max_ps(far, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+            }
+            far = _mm_max_ps(far, _mm_movehl_ps(far, far));
+            far = _mm_max_ss(far, _mm_shuffle_ps(far, far, 1));
+            return _mm_cvtss_f32(far);
+#else
+            float far = pixels[0];
+            for (int y = 0; y < OcclusionBuffer::blockHeight; y++) {
+                for (int x = 0; x < OcclusionBuffer::blockWidth; x++) far = std::max(far, pixels[y * stride + x]);
+            }
+            return far;
+#endif
+        }
+    }
+
+    auto occluderMesh::box(const glm::vec3 &min, const glm::vec3 &max) -> occluderMesh {
+        occluderMesh mesh;
+        for (int corner = 0; corner < 8; corner++) {
+            mesh.positions.emplace_back(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y,
+                                        corner & 4 ? max.z : min.z);
+        }
+        // two triangles per face; winding does not matter, the rasterizer is two-sided
+        mesh.indices = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+                        2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+        return mesh;
+    }
+
+
+    OcclusionBuffer::OcclusionBuffer(int width, int height)
+            : tilesX((std::max(width, 1) + tileWidth - 1) / tileWidth),
+              tilesY((std::max(height, 1) + tileHeight - 1) / tileHeight) {
+        bufferWidth = tilesX * tileWidth;
+        bufferHeight = tilesY * tileHeight;
+        pixels.assign((std::size_t) bufferWidth * bufferHeight, 1.0f);
+        blockMax.assign(pixels.size() / (blockWidth * blockHeight), 1.0f);
+        tileMax.assign((std::size_t) tilesX * tilesY, 1.0f);
+        bins.resize(tileMax.size());
+    }
+
+    auto OcclusionBuffer::begin(const glm::mat4 &matrix) -> void {
+        viewProjection = matrix;
+        occluders.clear();
+        stats = {};
+    }
+
+    auto OcclusionBuffer::addOccluder(const occluderMesh &mesh, const glm::mat4 &model) -> void {
+        occluders.push_back({&mesh, viewProjection * model});
+        stats.triangles += mesh.indices.size() / 3;
+    }
+
+    auto OcclusionBuffer::render(job::JobSystem *jobs) -> void {
+        // every occluder writes its own range of triangle slots, so they set up in parallel
+        std::vector<std::size_t> first(occluders.size() + 1, 0);
+        for (std::size_t i = 0; i < occluders.size(); i++) {
+            first[i + 1] = first[i] + occluders[i].mesh->indices.size() / 3;
+        }
+        triangles.resize(first.back());
+        accepted.assign(first.back(), 0);
+        auto setupRange = [this, &first](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++) setup(i, first[i]);
+        };
+        if (jobs) jobs->parallelFor(occluders.size(), 4, setupRange);
+        else setupRange(0, occluders.size());
+
+        for (auto &bin: bins) bin.clear();
+        for (std::uint32_t i = 0; i < triangles.size(); i++) {
+            if (!accepted[i]) continue;
+            stats.rasterized++;
+            const auto &t = triangles[i];
+            for (int ty = t.minY / tileHeight; ty <= t.maxY / tileHeight; ty++) {
+                for (int tx = t.minX / tileWidth; tx <= t.maxX / tileWidth; tx++) bins[ty * tilesX + tx].push_back(i);
+            }
+        }
+
+        auto rasterRange = [this](std::size_t begin, std::size_t end) {
+            for (auto tile = begin; tile < end; tile++) rasterTile((int) tile);
+        };
+        if (jobs) jobs->parallelFor(bins.size(), 1, rasterRange);
+        else rasterRange(0, bins.size());
+    }
+
+    auto OcclusionBuffer::setup(std::size_t occluderIndex, std::size_t firstTriangle) -> void {
+        const auto &[mesh, matrix] = occluders[occluderIndex];
+        thread_local std::vector<glm::vec4> clip;
+        clip.resize(mesh->positions.size());
+        for (std::size_t i = 0; i < clip.size(); i++) clip[i] = matrix * glm::vec4{mesh->positions[i], 1.0f};
+
+        const auto halfWidth = (float) bufferWidth * 0.5f, halfHeight = (float) bufferHeight * 0.5f;
+        for (std::size_t i = 0; i < mesh->indices.size() / 3; i++) {
+            glm::vec3 screen[3];
+            bool crossesNear = false;
+            for (int c = 0; c < 3; c++) {
+                const auto &v = clip[mesh->indices[i * 3 + c]];
+                crossesNear = crossesNear || v.w < nearW;
+                screen[c] = {(v.x / v.w + 1.0f) * halfWidth, (v.y / v.w + 1.0f) * halfHeight, v.z / v.w};
+            }
+            if (crossesNear) continue;
+
+            auto area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+                        (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+            if (std::abs(area) < 1e-8f) continue;
+            if (area < 0) {
+                std::swap(screen[1], screen[2]);
+                area = -area;
+            }
+
+            auto low = glm::min(screen[0], glm::min(screen[1], screen[2]));
+            auto high = glm::max(screen[0], glm::max(screen[1], screen[2]));
+            if (high.x < 0 || high.y < 0 || low.x >= (float) bufferWidth || low.y >= (float) bufferHeight) continue;
+
+            auto &t = triangles[firstTriangle + i];
+            t.minX = std::max(0, (int) std::floor(low.x));
+            t.minY = std::max(0, (int) std::floor(low.y));
+            t.maxX = std::min(bufferWidth - 1, (int) std::ceil(high.x));
+            t.maxY = std::min(bufferHeight - 1, (int) std::ceil(high.y));
+            for (int e = 0; e < 3; e++) {
+                const auto &from = screen[e], &to = screen[(e + 1) % 3];
+                t.edgeA[e] = from.y - to.y;
+                t.edgeB[e] = to.x - from.x;
+                t.edgeC[e] = -(t.edgeA[e] * from.x + t.edgeB[e] * from.y);
+            }
+            auto dz1 = screen[1].z - screen[0].z, dz2 = screen[2].z - screen[0].z;
+            t.depthA = (dz1 * (screen[2].y - screen[0].y) - dz2 * (screen[1].y - screen[0].y)) / area;
+            t.depthB = (dz2 * (screen[1].x - screen[0].x) - dz1 * (screen[2].x - screen[0].x)) / area;
+            t.depthC = screen[0].z - t.depthA * screen[0].x - t.depthB * screen[0].y;
+            accepted[firstTriangle + i] = 1;
+        }
+    }
+
+    auto OcclusionBuffer::rasterTile(int tile) -> void {
+        auto x0 = tile % tilesX * tileWidth, y0 = tile / tilesX * tileHeight;
+        for (int y = y0; y < y0 + tileHeight; y++) {
+            std::fill_n(&pixels[(std::size_t) y * bufferWidth + x0], tileWidth, 1.0f);
+        }
+
+        auto kernel = transform::activeKernel();
+        for (auto index: bins[tile]) {
+            const auto &t = triangles[index];
+            span s{std::max(t.minX, x0) & ~(blockWidth - 1), std::min(t.maxX, x0 + tileWidth - 1),
+                   std::max(t.minY, y0), std::min(t.maxY, y0 + tileHeight - 1)};
+            switch (kernel) {
+#ifdef SCENE_X86
+                case transform::kernel::avx2:
+                    rasterAVX2(t, s, pixels.data(), bufferWidth);
+                    break;
+                case transform::kernel::sse:
+                    rasterSSE(t, s, pixels.data(), bufferWidth);
+                    break;
+#endif
+                default:
+                    rasterScalar(t, s, pixels.data(), bufferWidth);
+            }
+        }
+
+        auto blocksX = bufferWidth / blockWidth;
+        float tileFar = 0;
+        for (int y = y0; y < y0 + tileHeight; y += blockHeight) {
+            for (int x = x0; x < x0 + tileWidth; x += blockWidth) {
+                auto far = farthest(&pixels[(std::size_t) y * bufferWidth + x], bufferWidth);
+                blockMax[(std::size_t) (y / blockHeight) * blocksX + x / blockWidth] = far;
+                tileFar = std::max(tileFar, far);
+            }
+        }
+        tileMax[tile] = tileFar;
+    }
+
+    auto OcclusionBuffer::visible(const aabb &bounds) const -> bool {
+        glm::vec2 low{std::numeric_limits<float>::max()}, high{std::numeric_limits<float>::lowest()};
+        float nearest = std::numeric_limits<float>::max();
+        // the matrix column times each extent of each axis, so a corner is two additions
+        glm::vec4 alongX[2] = {viewProjection[0] * bounds.min.x, viewProjection[0] * bounds.max.x};
+        glm::vec4 alongY[2] = {viewProjection[1] * bounds.min.y, viewProjection[1] * bounds.max.y};
+        glm::vec4 alongZ[2] = {viewProjection[2] * bounds.min.z + viewProjection[3],
+                               viewProjection[2] * bounds.max.z + viewProjection[3]};
+        for (int corner = 0; corner < 8; corner++) {
+            auto clip = alongX[corner & 1] + alongY[corner >> 1 & 1] + alongZ[corner >> 2];
+            if (clip.w < nearW) return true;
+            auto ndc = glm::vec3{clip} * (1.0f / clip.w);
+            low = glm::min(low, glm::vec2{ndc});
+            high = glm::max(high, glm::vec2{ndc});
+            nearest = std::min(nearest, ndc.z);
+        }
+        auto toPixel = [](float ndc, int size) { return (ndc + 1.0f) * 0.5f * (float) size; };
+        auto x0 = toPixel(low.x, bufferWidth), x1 = toPixel(high.x, bufferWidth);
+        auto y0 = toPixel(low.y, bufferHeight), y1 = toPixel(high.y, bufferHeight);
+        if (x1 < 0 || y1 < 0 || x0 >= (float) bufferWidth || y0 >= (float) bufferHeight) return false;
+
+        auto blocksX = bufferWidth / blockWidth;
+        auto bx0 = std::max(0, (int) x0) / blockWidth, bx1 = std::min(bufferWidth - 1, (int) x1) / blockWidth;
+        auto by0 = std::max(0, (int) y0) / blockHeight, by1 = std::min(bufferHeight - 1, (int) y1) / blockHeight;
+        constexpr int blocksPerTileX = tileWidth / blockWidth, blocksPerTileY = tileHeight / blockHeight;
+        for (int ty = by0 / blocksPerTileY; ty <= by1 / blocksPerTileY; ty++) {
+            for (int tx = bx0 / blocksPerTileX; tx <= bx1 / blocksPerTileX; tx++) {
+                // a tile entirely in front of the box hides its part of the box without looking at the blocks
+                if (tileMax[ty * tilesX + tx] < nearest) continue;
+                auto rowEnd = std::min(by1, ty * blocksPerTileY + blocksPerTileY - 1);
+                auto columnEnd = std::min(bx1, tx * blocksPerTileX + blocksPerTileX - 1);
+                for (auto by = std::max(by0, ty * blocksPerTileY); by <= rowEnd; by++) {
+                    for (auto bx = std::max(bx0, tx * blocksPerTileX); bx <= columnEnd; bx++) {
+                        if (blockMax[(std::size_t) by * blocksX + bx] >= nearest) return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    auto OcclusionBuffer::cull(const BVH &bvh, std::vector<std::uint32_t> &ids) -> void {
+        auto kept = std::remove_if(ids.begin(), ids.end(), [&](std::uint32_t id) { return !visible(bvh.bounds(id)); });
+        stats.tested += ids.size();
+        stats.occluded += (std::size_t) (ids.end() - kept);
+        ids.erase(kept, ids.end());
+    }
+
+    auto OcclusionBuffer::width() const -> int {
+        return bufferWidth;
+    }
+
+    auto OcclusionBuffer::height() const -> int {
+        return bufferHeight;
+    }
+
+    auto OcclusionBuffer::depth() const -> const std::vector<float> & {
+        return pixels;
+    }
+
+    auto OcclusionBuffer::statistics() const -> const occlusionStatistics & {
+        return stats;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bvh.hpp"
+
+namespace job {
+    class JobSystem;
+}
+
+namespace scene {
+
+    // Low-poly stand-in for an object that hides what is behind it, in object space.
+    struct occluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<std::uint32_t> indices;
+
+        static auto box(const glm::vec3 &min, const glm::vec3 &max) -> occluderMesh;
+    };
+
+    // edge functions and depth plane in pixels, inside where all three edges are >= 0; bounds inclusive
+    struct rasterTriangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, minY, maxX, maxY;
+    };
+
+    struct occlusionStatistics {
+        std::size_t triangles{};           // submitted by occluders
+        std::size_t rasterized{};          // left after near plane and screen rejection
+        std::size_t tested{}, occluded{};  // objects passed through cull()
+    };
+
+    // Software depth buffer for occlusion culling. Occluders are rasterized on the CPU at low resolution into
+    // NDC depth, one tile per job with rows of 4 (SSE) or 8 (AVX2) pixels per step, following
+    // transform::activeKernel(). Every tile keeps its farthest depth and so does every 8x4 block inside it;
+    // object boxes are tested against those two levels only, so a hidden box never touches the pixels.
+    // Triangles are two-sided and those crossing the near plane are skipped, both errs on the visible side.
+    class OcclusionBuffer {
+    public:
+        static constexpr int tileWidth = 64, tileHeight = 32;
+        static constexpr int blockWidth = 8, blockHeight = 4;
+
+        // rounded up to whole tiles
+        explicit OcclusionBuffer(int width = 256, int height = 128);
+
+        // clears the occluder list; the buffer itself is cleared while rasterizing
+        auto begin(const glm::mat4 &viewProjection) -> void;
+
+        // the mesh is read in render(), so it has to live until then
+        auto addOccluder(const occluderMesh &mesh, const glm::mat4 &model) -> void;
+
+        // sets up the triangles per occluder and rasterizes the tiles, as jobs when given a job system
+        auto render(job::JobSystem *jobs = nullptr) -> void;
+
+        // false only if every block the box covers on screen is in front of its nearest point, or it is
+        // off screen; boxes reaching behind the eye are always visible
+        [[nodiscard]] auto visible(const aabb &bounds) const -> bool;
+
+        // drops the hidden ids from the list, keeping the order of the rest
+        auto cull(const BVH &bvh, std::vector<std::uint32_t> &ids) -> void;
+
+        [[nodiscard]] auto width() const -> int;
+
+        [[nodiscard]] auto height() const -> int;
+
+        // row-major from the bottom left, 1 where nothing was drawn
+        [[nodiscard]] auto depth() const -> const std::vector<float> &;
+
+        [[nodiscard]] auto statistics() const -> const occlusionStatistics &;
+
+    private:
+        struct occluder {
+            const occluderMesh *mesh;
+            glm::mat4 modelViewProjection;
+        };
+
+        int bufferWidth, bufferHeight, tilesX, tilesY;
+        glm::mat4 viewProjection{1};
+        std::vector<occluder> occluders{};
+        std::vector<rasterTriangle> triangles{};
+        std::vector<std::uint8_t> accepted{};
+        std::vector<std::vector<std::uint32_t>> bins{};
+        std::vector<float> pixels{}, blockMax{}, tileMax{};
+        occlusionStatistics stats{};
+
+        auto setup(std::size_t occluderIndex, std::size_t firstTriangle) -> void;
+
+        auto rasterTile(int tile) -> void;
+    };
+}
@@ -0,0 +1,128 @@
+#include <glad/glad.h>
+
+#include "programCache.hpp"
+#include "shader.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace shader {
+
+    namespace {
+        constexpr char cacheMagic[4] = {'L', 'P', 'B', 'C'};
+        // far above any real program binary; a larger length means the entry is corrupt
+        constexpr std::uint64_t maxBinaryLength = 64u << 20;
+
+        struct cacheHeader {
+            char magic[4];
+            std::uint32_t binaryFormat;
+            std::uint64_t key;
+            std::uint64_t length;
+        };
+
+        auto glString(GLenum name) -> std::string {
+            auto *value = (const char *) glGetString(name);
+            return value ? value : "";
+        }
+    }
+
+    ProgramCache::ProgramCache(std::filesystem::path directory) : directory(std::move(directory)) {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+    }
+
+    auto ProgramCache::available() const -> bool {
+        if (!glad_glProgramBinary || !glad_glGetProgramBinary || !glad_glProgramParameteri) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    auto ProgramCache::key(const std::vector<Shader> &stages) const -> std::uint64_t {
+        if (driver.empty()) {
+            driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+        }
+        std::string material = driver;
+        for (const auto &stage: stages) {
+            material += '\n' + std::to_string(stage.getType()) + ':' + std::to_string(stage.getSource().size()) + '\n';
+            material += stage.getSource();
+        }
+        return hashName(material);
+    }
+
+    auto ProgramCache::tryLoad(unsigned int programID, std::uint64_t key) -> bool {
+        auto path = pathFor(key);
+        std::ifstream file{path, std::ios::binary};
+        cacheHeader head{};
+        if (!file || !file.read((char *) &head, sizeof(head)) ||
+            std::memcmp(head.magic, cacheMagic, sizeof(cacheMagic)) != 0 || head.key != key) {
+            stats.misses++;
+            return false;
+        }
+        // a truncated or corrupt entry is a miss, not an allocation of whatever length it claims
+        std::error_code error;
+        auto fileSize = std::filesystem::file_size(path, error);
+        if (error || head.length == 0 || head.length > maxBinaryLength || head.length != fileSize - sizeof(head)) {
+            stats.misses++;
+            return false;
+        }
+        std::vector<char> binary(head.length);
+        if (!file.read(binary.data(), (std::streamsize) binary.size())) {
+            stats.misses++;
+            return false;
+        }
+
+        glProgramBinary(programID, head.binaryFormat, binary.data(), (GLsizei) binary.size());
+        GLint success = 0;
+        glGetProgramiv(programID, GL_LINK_STATUS, &success);
+        if (!success) {
+            // driver update or different GPU, the caller recompiles and overwrites the entry
+            stats.rejected++;
+            return false;
+        }
+        stats.hits++;
+        return true;
+    }
+
+    auto ProgramCache::store(unsigned int programID, std::uint64_t key) -> void {
+        GLint length = 0;
+        glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        cacheHeader head{};
+        std::memcpy(head.magic, cacheMagic, sizeof(cacheMagic));
+        head.key = key;
+        glGetProgramBinary(programID, length, &length, &head.binaryFormat, binary.data());
+        head.length = (std::uint64_t) length;
+
+        // write then rename, so a concurrent reader never sees a partial entry
+        auto path = pathFor(key);
+        auto temporary = path;
+        temporary += ".tmp";
+        {
+            std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+            file.write((const char *) &head, sizeof(head));
+            file.write(binary.data(), length);
+            if (!file) {
+                std::cerr << "ERROR::COULD_NOT_WRITE_PROGRAM_CACHE: " << temporary << std::endl;
+                return;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (!error) stats.stored++;
+    }
+
+    auto ProgramCache::getStatistics() const -> const statistics & {
+        return stats;
+    }
+
+    auto ProgramCache::pathFor(std::uint64_t key) const -> std::filesystem::path {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+        return directory / name;
+    }
+}
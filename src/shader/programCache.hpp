@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace shader {
+
+    class Shader;
+
+    // Stores glGetProgramBinary output under a directory, keyed by a hash of the program's stage sources and
+    // the driver's vendor/renderer/version strings. A binary the driver rejects is treated as a miss.
+    class ProgramCache {
+    public:
+        struct statistics {
+            std::uint64_t hits, misses, rejected, stored;
+        };
+
+        explicit ProgramCache(std::filesystem::path directory);
+
+        // binaries need glProgramBinary/glGetProgramBinary and at least one binary format
+        [[nodiscard]] auto available() const -> bool;
+
+        [[nodiscard]] auto key(const std::vector<Shader> &stages) const -> std::uint64_t;
+
+        auto tryLoad(unsigned int programID, std::uint64_t key) -> bool;
+
+        auto store(unsigned int programID, std::uint64_t key) -> void;
+
+        [[nodiscard]] auto getStatistics() const -> const statistics &;
+
+    private:
+        std::filesystem::path directory;
+        mutable std::string driver;
+        statistics stats{};
+
+        [[nodiscard]] auto pathFor(std::uint64_t key) const -> std::filesystem::path;
+    };
+}
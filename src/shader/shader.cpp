@@ -2,32 +2,90 @@
 
 #include "shader.hpp"
 
-#include <sstream>
-#include <fstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
 
 namespace shader {
 
-    Shader::Shader(const char *path, GLenum shaderType) {
-        std::ifstream shaderFile;
-        std::string shaderCode;
-
-        shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            shaderFile.open(path);
-            std::stringstream codeStream;
-            codeStream << shaderFile.rdbuf();
-            shaderCode = codeStream.str();
-        } catch (std::fstream::failure &e) {
-            std::cerr << "ERROR::COULD_NOT_OPEN_FILE" << std::endl << e.what() << std::endl;
-            throw shaderFileLoadException();
-        }
-        shaderID = glCreateShader(shaderType);
-        const char *fShaderCode = shaderCode.c_str();
+    namespace {
+        // KHR_parallel_shader_compile / ARB_parallel_shader_compile share this token
+        constexpr GLenum GL_COMPLETION_STATUS_KHR = 0x91B1;
+
+        auto parallelCompileSupported() -> bool {
+            static const bool supported = [] {
+                GLint count = 0;
+                glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+                for (GLint i = 0; i < count; i++) {
+                    auto *name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+                    if (name && (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0 ||
+                                 std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0)) {
+                        return true;
+                    }
+                }
+                return false;
+            }();
+            return supported;
+        }
+
+        auto uniformSize(GLenum type) -> std::uint32_t {
+            switch (type) {
+                case GL_FLOAT:
+                case GL_INT:
+                case GL_UNSIGNED_INT:
+                case GL_BOOL:
+                    return 4;
+                case GL_FLOAT_VEC2:
+                case GL_INT_VEC2:
+                case GL_UNSIGNED_INT_VEC2:
+                case GL_BOOL_VEC2:
+                    return 8;
+                case GL_FLOAT_VEC3:
+                case GL_INT_VEC3:
+                case GL_UNSIGNED_INT_VEC3:
+                case GL_BOOL_VEC3:
+                    return 12;
+                case GL_FLOAT_VEC4:
+                case GL_INT_VEC4:
+                case GL_UNSIGNED_INT_VEC4:
+                case GL_BOOL_VEC4:
+                case GL_FLOAT_MAT2:
+                    return 16;
+                case GL_FLOAT_MAT3:
+                    return 36;
+                case GL_FLOAT_MAT4:
+                    return 64;
+                default:
+                    // samplers are set through an int, anything larger is still at most a dmat4
+                    return 128;
+            }
+        }
+    }
+
+    Shader::Shader(const char *path, GLenum shaderType) : Shader(path, shaderType, {}) {}
+
+    Shader::Shader(const char *path, GLenum shaderType, const std::vector<std::string> &defines)
+            : type(shaderType), path(path), source(preprocess(path, defines)) {}
+
+    Shader::Shader(Shader &&shader) noexcept
+            : type(shader.type), path(std::move(shader.path)), source(std::move(shader.source)),
+              shaderID(std::exchange(shader.shaderID, 0)), compileChecked(shader.compileChecked) {}
+
+    auto Shader::compile() const -> unsigned int {
+        if (shaderID) return shaderID;
+        shaderID = glCreateShader(type);
+        const char *fShaderCode = source.c_str();
         glShaderSource(shaderID, 1, &fShaderCode, nullptr);
         glCompileShader(shaderID);
+        return shaderID;
+    }
 
+    auto Shader::checkCompile() const -> void {
+        if (compileChecked) return;
+        compile();
         int success;
         glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
         if (!success) {
@@ -36,9 +94,11 @@ namespace shader {
             std::cerr << "ERROR::COMPILE::SHADER: " << log << std::endl;
             throw shaderCompileError();
         }
+        compileChecked = true;
     }
 
     auto Shader::GetShader() const -> unsigned int {
+        checkCompile();
         return shaderID;
     }
 
@@ -46,15 +106,23 @@ namespace shader {
         return GetShader();
     }
 
+    auto Shader::getType() const -> GLenum {
+        return type;
+    }
+
+    auto Shader::getSource() const -> const std::string & {
+        return source;
+    }
+
+    auto Shader::getPath() const -> const std::string & {
+        return path;
+    }
+
 
     ShaderProgram::ShaderProgram(const char *vShaderPath, const char *fShaderPath) {
-        Shader vShader{vShaderPath, GL_VERTEX_SHADER};
-        Shader fShader{fShaderPath, GL_FRAGMENT_SHADER};
-        std::cout << vShader << std::endl << fShader << std::endl;
-        programID = glCreateProgram();
-        glAttachShader(programID, vShader);
-        glAttachShader(programID, fShader);
-        linkShader();
+        add(Shader{vShaderPath, GL_VERTEX_SHADER});
+        add(Shader{fShaderPath, GL_FRAGMENT_SHADER});
+        load();
     }
 
     auto ShaderProgram::getProgram() const -> unsigned int {
@@ -67,36 +135,101 @@ namespace shader {
 
     auto ShaderProgram::use() const -> void {
         if (!programIsReady) throw programNotConstructedException();
-        glUseProgram(programID);
+        render::GLState::current().useProgram(programID);
     }
 
 
     auto ShaderProgram::set(const std::string &name, float value) const -> void {
-        auto location = glGetUniformLocation(programID, name.c_str());
-        glUniform1f(location, value);
+        set<float>(uniformName{name}, value);
     }
 
     auto ShaderProgram::set(const std::string &name, int value) const -> void {
-        auto location = glGetUniformLocation(programID, name.c_str());
-        glUniform1i(location, value);
+        set<int>(uniformName{name}, value);
+    }
+
+    auto ShaderProgram::getUniforms() const -> const std::vector<uniformSlot> & {
+        return uniforms;
     }
 
     auto ShaderProgram::add(Shader &&shader) -> ShaderProgram & {
-        shaderChain.push_back(shader);
+        shaderChain.push_back(std::move(shader));
+        return *this;
+    }
+
+    auto ShaderProgram::setCache(ProgramCache *programCache) -> ShaderProgram & {
+        cache = programCache;
         return *this;
     }
 
     auto ShaderProgram::load() -> void {
+        beginLoad();
+        finishLoad();
+    }
+
+    auto ShaderProgram::beginLoad() -> void {
         programID = glCreateProgram();
+        loadedFromCache = false;
+        bool cacheable = cache && cache->available();
+        if (cacheable) {
+            cacheKey = cache->key(shaderChain);
+            if (cache->tryLoad(programID, cacheKey)) {
+                loadedFromCache = true;
+                return;
+            }
+        }
         for (const auto &shader: shaderChain) {
-            glAttachShader(programID, shader);
+            glAttachShader(programID, shader.compile());
+        }
+        if (cacheable) glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(programID);
+    }
+
+    auto ShaderProgram::isLoadComplete() const -> bool {
+        if (loadedFromCache || !parallelCompileSupported()) return true;
+        GLint complete = GL_FALSE;
+        glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    auto ShaderProgram::finishLoad() -> void {
+        if (!loadedFromCache) {
+            // compile errors explain a failed link better than the link log does
+            for (const auto &shader: shaderChain) {
+                shader.checkCompile();
+            }
+            checkLink();
+            if (cache && cache->available()) cache->store(programID, cacheKey);
         }
-        linkShader();
+        reflectUniforms();
+        bindSharedBlocks();
         programIsReady = true;
     }
 
-    auto ShaderProgram::linkShader() const -> void {
-        glLinkProgram(programID);
+    auto ShaderProgram::setFeatures(std::vector<std::string> featureDefines) -> ShaderProgram & {
+        features = std::move(featureDefines);
+        return *this;
+    }
+
+    auto ShaderProgram::variant(std::uint32_t mask) -> ShaderProgram & {
+        // bits without a feature change nothing, so they must not make a second program under another key
+        if (features.size() < 32) mask &= (1u << features.size()) - 1;
+        if (mask == 0) return *this;
+        auto found = variants.find(mask);
+        if (found != variants.end()) return *found->second;
+
+        std::vector<std::string> defines;
+        for (std::size_t bit = 0; bit < features.size(); bit++) {
+            if (mask & (1u << bit)) defines.push_back(features[bit]);
+        }
+        auto specialized = std::make_unique<ShaderProgram>();
+        for (const auto &shader: shaderChain) {
+            specialized->add(Shader{shader.getPath().c_str(), shader.getType(), defines});
+        }
+        specialized->setCache(cache).load();
+        return *variants.emplace(mask, std::move(specialized)).first->second;
+    }
+
+    auto ShaderProgram::checkLink() const -> void {
         int success;
         glGetProgramiv(programID, GL_LINK_STATUS, &success);
         if (!success) {
@@ -107,8 +240,95 @@ namespace shader {
         }
     }
 
-    auto ShaderProgram::setTrans(const std::string &name, glm::mat4 &trans) const -> void {
-        auto transformLoc = glGetUniformLocation(programID, name.c_str());
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
+    auto ShaderProgram::reflectUniforms() -> void {
+        uniforms.clear();
+        uniformCache.clear();
+
+        int count = 0, maxLength = 0;
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> nameBuffer(std::max(maxLength, 1));
+
+        std::uint32_t offset = 0;
+        for (auto i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint arraySize = 0;
+            GLenum type = 0;
+            glGetActiveUniform(programID, i, (GLsizei) nameBuffer.size(), &length, &arraySize, &type,
+                               nameBuffer.data());
+            std::string_view name{nameBuffer.data(), (std::size_t) length};
+            // uniforms inside blocks report no location and are not set through glUniform*
+            auto location = glGetUniformLocation(programID, nameBuffer.data());
+            if (location < 0) continue;
+            // arrays are reported as "name[0]", address them by their plain name
+            if (name.ends_with("[0]")) name.remove_suffix(3);
+
+            auto size = uniformSize(type);
+            uniforms.push_back({hashName(name), location, type, offset, size, false});
+            offset += (size + 15) & ~15u;
+        }
+        uniformCache.resize(offset);
+
+        std::sort(uniforms.begin(), uniforms.end(),
+                  [](const uniformSlot &a, const uniformSlot &b) { return a.hash < b.hash; });
+        for (std::size_t i = 1; i < uniforms.size(); i++) {
+            if (uniforms[i].hash == uniforms[i - 1].hash) {
+                std::cerr << "ERROR::UNIFORM_NAME_HASH_COLLISION" << std::endl;
+                throw programLinkError();
+            }
+        }
+    }
+
+    // block bindings are not part of a program binary, so this runs after cache hits as well
+    auto ShaderProgram::bindSharedBlocks() const -> void {
+        for (const auto &block: sharedBlocks) {
+            auto index = glGetUniformBlockIndex(programID, block.name);
+            if (index != GL_INVALID_INDEX) glUniformBlockBinding(programID, index, block.binding);
+        }
+    }
+
+    auto ShaderProgram::findUniform(std::uint64_t hash) const -> int {
+        auto it = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+                                   [](const uniformSlot &slot, std::uint64_t h) { return slot.hash < h; });
+        if (it == uniforms.end() || it->hash != hash) return -1;
+        return (int) (it - uniforms.begin());
+    }
+
+    auto ShaderProgram::isSampler(GLenum type) -> bool {
+        switch (type) {
+            case GL_SAMPLER_1D:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_MULTISAMPLE:
+            case GL_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    auto ShaderProgram::setTrans(const std::string &name, const glm::mat4 &trans) const -> void {
+        set<glm::mat4>(uniformName{name}, trans);
+    }
+
+    auto loadAll(std::initializer_list<ShaderProgram *> programs) -> void {
+        for (auto *program: programs) {
+            program->beginLoad();
+        }
+        for (auto *program: programs) {
+            while (!program->isLoadComplete()) {
+                std::this_thread::yield();
+            }
+        }
+        for (auto *program: programs) {
+            program->finishLoad();
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,11 +1,103 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <initializer_list>
+#include <memory>
+#include <unordered_map>
+
+#include "programCache.hpp"
+#include "shaderPreprocessor.hpp"
+#include "../render/glState.hpp"
 
 namespace shader {
+
+    // FNV-1a, usable both at compile time (uniform literals) and at runtime (string lookups)
+    constexpr auto hashName(std::string_view name) -> std::uint64_t {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c: name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    struct uniformName {
+        std::uint64_t hash;
+        const char *name;
+
+        constexpr uniformName(std::uint64_t hash, const char *name) : hash(hash), name(name) {}
+
+        uniformName(const std::string &name) : hash(hashName(name)), name(name.c_str()) {}
+    };
+
+    namespace literals {
+        consteval auto operator ""_u(const char *name, std::size_t length) -> uniformName {
+            return {hashName({name, length}), name};
+        }
+    }
+
+    template<typename T>
+    struct uniformTraits;
+
+#define SHADER_UNIFORM_TRAIT(TYPE, GL_TYPE) \
+    template<> struct uniformTraits<TYPE> { static constexpr GLenum glType = GL_TYPE; }
+
+    SHADER_UNIFORM_TRAIT(float, GL_FLOAT);
+    SHADER_UNIFORM_TRAIT(glm::vec2, GL_FLOAT_VEC2);
+    SHADER_UNIFORM_TRAIT(glm::vec3, GL_FLOAT_VEC3);
+    SHADER_UNIFORM_TRAIT(glm::vec4, GL_FLOAT_VEC4);
+    SHADER_UNIFORM_TRAIT(int, GL_INT);
+    SHADER_UNIFORM_TRAIT(glm::ivec2, GL_INT_VEC2);
+    SHADER_UNIFORM_TRAIT(glm::ivec3, GL_INT_VEC3);
+    SHADER_UNIFORM_TRAIT(glm::ivec4, GL_INT_VEC4);
+    SHADER_UNIFORM_TRAIT(glm::mat2, GL_FLOAT_MAT2);
+    SHADER_UNIFORM_TRAIT(glm::mat3, GL_FLOAT_MAT3);
+    SHADER_UNIFORM_TRAIT(glm::mat4, GL_FLOAT_MAT4);
+
+#undef SHADER_UNIFORM_TRAIT
+
+    // Uniform blocks every program shares: a block declared under one of these names is bound to its fixed
+    // binding point at load, so one buffer range per frame serves all programs.
+    namespace blockBinding {
+        constexpr GLuint camera = 0;
+    }
+
+    struct sharedBlock {
+        const char *name;
+        GLuint binding;
+    };
+
+    inline constexpr sharedBlock sharedBlocks[] = {{"Camera", blockBinding::camera}};
+
+    class ShaderProgram;
+
+    // pre-resolved index into a program's uniform table, only valid for the program that created it
+    template<typename T>
+    class Uniform {
+    public:
+        Uniform() = default;
+
+        [[nodiscard]] auto valid() const -> bool { return slot >= 0; }
+
+    private:
+        friend class ShaderProgram;
+
+        explicit Uniform(int slot) : slot(slot) {}
+
+        int slot = -1;
+    };
+
+    // Holds a stage's source; the GL shader object is only created when a program actually needs to compile it
+    // (a program binary cache hit never does).
     class Shader {
     public:
         class shaderCompileError : std::exception {
@@ -16,15 +108,35 @@ namespace shader {
 
         explicit Shader(const char *path, GLenum shaderType);
 
+        // preprocessed with every define set to 1, includes come from the shared SourceCache
+        explicit Shader(const char *path, GLenum shaderType, const std::vector<std::string> &defines);
+
         explicit Shader(const Shader &shader) = delete;
 
+        Shader(Shader &&shader) noexcept;
 
+        // compiles on first use and waits for the result
         [[nodiscard]] auto GetShader() const -> unsigned int;
 
         operator unsigned int() const;
 
+        // issues the compile without waiting for it
+        auto compile() const -> unsigned int;
+
+        auto checkCompile() const -> void;
+
+        [[nodiscard]] auto getType() const -> GLenum;
+
+        [[nodiscard]] auto getSource() const -> const std::string &;
+
+        [[nodiscard]] auto getPath() const -> const std::string &;
+
     private:
-        unsigned int shaderID{};
+        GLenum type{};
+        std::string path;
+        std::string source;
+        mutable unsigned int shaderID{};
+        mutable bool compileChecked = false;
     };
 
 
@@ -37,6 +149,18 @@ namespace shader {
         class programLinkError : std::exception {
         };
 
+        class uniformTypeError : std::exception {
+        };
+
+        struct uniformSlot {
+            std::uint64_t hash;
+            GLint location;
+            GLenum type;
+            std::uint32_t offset;
+            std::uint32_t size;
+            mutable bool cached;
+        };
+
         explicit ShaderProgram() = default;
 
         explicit ShaderProgram(const char *vShaderPath, const char *fShaderPath);
@@ -49,19 +173,129 @@ namespace shader {
 
         auto add(Shader &&shader) -> ShaderProgram &;
 
+        // binaries are looked up in and written back to cache by every later load
+        auto setCache(ProgramCache *cache) -> ShaderProgram &;
+
         auto load() -> void;
 
+        // load() split in two: beginLoad() only issues GL work, so several programs can compile concurrently
+        // on drivers with parallel shader compilation, finishLoad() waits and reports errors
+        auto beginLoad() -> void;
+
+        [[nodiscard]] auto isLoadComplete() const -> bool;
+
+        auto finishLoad() -> void;
+
+        // bit i of a variant mask defines features[i] in every stage of that variant
+        auto setFeatures(std::vector<std::string> featureDefines) -> ShaderProgram &;
+
+        // specialized program for mask, built on first request and cached; mask 0 is this program itself, bits
+        // beyond the features are ignored
+        auto variant(std::uint32_t mask) -> ShaderProgram &;
+
+        template<typename T>
+        [[nodiscard]] auto uniform(uniformName name) const -> Uniform<T>;
+
+        template<typename T>
+        auto set(Uniform<T> handle, const std::type_identity_t<T> &value) const -> void;
+
+        template<typename T>
+        auto set(uniformName name, const T &value) const -> void;
+
         auto set(const std::string &name, float value) const -> void;
 
         auto set(const std::string &name, int value) const -> void;
 
-        auto setTrans(const std::string &name, glm::mat4 &trans) const -> void;
+        auto setTrans(const std::string &name, const glm::mat4 &trans) const -> void;
+
+        [[nodiscard]] auto getUniforms() const -> const std::vector<uniformSlot> &;
 
     private:
-        std::vector<unsigned int> shaderChain{};
+        std::vector<Shader> shaderChain{};
         unsigned int programID{};
         bool programIsReady = false;
 
-        auto linkShader() const -> void;
+        ProgramCache *cache{};
+        std::uint64_t cacheKey{};
+        bool loadedFromCache = false;
+
+        std::vector<std::string> features{};
+        std::unordered_map<std::uint32_t, std::unique_ptr<ShaderProgram>> variants{};
+
+        // sorted by hash, values of the last upload live in uniformCache at slot.offset
+        std::vector<uniformSlot> uniforms{};
+        mutable std::vector<unsigned char> uniformCache{};
+
+        auto checkLink() const -> void;
+
+        auto reflectUniforms() -> void;
+
+        auto bindSharedBlocks() const -> void;
+
+        [[nodiscard]] auto findUniform(std::uint64_t hash) const -> int;
+
+        static auto isSampler(GLenum type) -> bool;
+
+        static auto upload(GLint location, float value) -> void { glUniform1f(location, value); }
+
+        static auto upload(GLint location, int value) -> void { glUniform1i(location, value); }
+
+        static auto upload(GLint location, const glm::vec2 &value) -> void { glUniform2fv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::vec3 &value) -> void { glUniform3fv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::vec4 &value) -> void { glUniform4fv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::ivec2 &value) -> void { glUniform2iv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::ivec3 &value) -> void { glUniform3iv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::ivec4 &value) -> void { glUniform4iv(location, 1, glm::value_ptr(value)); }
+
+        static auto upload(GLint location, const glm::mat2 &value) -> void {
+            glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+
+        static auto upload(GLint location, const glm::mat3 &value) -> void {
+            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+
+        static auto upload(GLint location, const glm::mat4 &value) -> void {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
     };
-}
\ No newline at end of file
+
+
+    template<typename T>
+    auto ShaderProgram::uniform(uniformName name) const -> Uniform<T> {
+        auto slot = findUniform(name.hash);
+        if (slot < 0) return Uniform<T>{};
+        auto type = uniforms[slot].type;
+        if (type != uniformTraits<T>::glType && !(uniformTraits<T>::glType == GL_INT && isSampler(type))) {
+            std::cerr << "ERROR::UNIFORM_TYPE_MISMATCH: " << (name.name ? name.name : "?") << std::endl;
+            throw uniformTypeError();
+        }
+        return Uniform<T>{slot};
+    }
+
+    template<typename T>
+    auto ShaderProgram::set(Uniform<T> handle, const std::type_identity_t<T> &value) const -> void {
+        if (!handle.valid()) return;
+        const auto &slot = uniforms[handle.slot];
+        auto *cache = uniformCache.data() + slot.offset;
+        if (slot.cached && std::memcmp(cache, &value, sizeof(T)) == 0) return;
+        std::memcpy(cache, &value, sizeof(T));
+        slot.cached = true;
+        // glUniform* writes to the program in use
+        render::GLState::current().useProgram(programID);
+        upload(slot.location, value);
+    }
+
+    template<typename T>
+    auto ShaderProgram::set(uniformName name, const T &value) const -> void {
+        set(uniform<T>(name), value);
+    }
+
+    // begins every program, waits until all report completion, then finishes them
+    auto loadAll(std::initializer_list<ShaderProgram *> programs) -> void;
+}
@@ -0,0 +1,97 @@
+#include "shaderPreprocessor.hpp"
+#include "shader.hpp"
+#include "../util/embeddedAssets.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+namespace shader {
+
+    auto SourceCache::get(const std::filesystem::path &path) -> const std::string & {
+        auto key = path.lexically_normal().string();
+        std::lock_guard lock{mutex};
+        auto found = files.find(key);
+        if (found != files.end()) return found->second;
+        if (const auto *asset = util::embedded::find(key)) {
+            return files.emplace(key, std::string{(const char *) asset->data, asset->size}).first->second;
+        }
+
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try {
+            file.open(key);
+            std::stringstream codeStream;
+            codeStream << file.rdbuf();
+            return files.emplace(key, codeStream.str()).first->second;
+        } catch (std::fstream::failure &e) {
+            std::cerr << "ERROR::COULD_NOT_OPEN_FILE: " << key << std::endl << e.what() << std::endl;
+            throw Shader::shaderFileLoadException();
+        }
+    }
+
+    auto SourceCache::clear() -> void {
+        std::lock_guard lock{mutex};
+        files.clear();
+    }
+
+    auto SourceCache::shared() -> SourceCache & {
+        static SourceCache cache;
+        return cache;
+    }
+
+    namespace {
+        auto expand(const std::filesystem::path &path, const std::vector<std::string> &defines, SourceCache &sources,
+                    std::set<std::string> &included, int fileNumber, std::string &out, bool &defined) -> int {
+            const auto &source = sources.get(path);
+            std::istringstream lines{source};
+            std::string line;
+            int lineNumber = 0, nextFile = fileNumber + 1;
+            while (std::getline(lines, line)) {
+                lineNumber++;
+                auto first = line.find_first_not_of(" \t");
+                auto directive = first == std::string::npos ? std::string_view{} : std::string_view{line}.substr(first);
+
+                if (directive.starts_with("#include")) {
+                    auto open = line.find('"'), close = line.rfind('"');
+                    if (open == std::string::npos || close <= open) {
+                        std::cerr << "ERROR::MALFORMED_INCLUDE: " << path.string() << ":" << lineNumber << std::endl;
+                        throw Shader::shaderFileLoadException();
+                    }
+                    auto target = (path.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+                    if (included.insert(target.string()).second) {
+                        out += "#line 1 " + std::to_string(nextFile) + "\n";
+                        nextFile = expand(target, defines, sources, included, nextFile, out, defined);
+                        out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileNumber) + "\n";
+                    }
+                    continue;
+                }
+
+                out += line;
+                out += '\n';
+                if (directive.starts_with("#version") && fileNumber == 0 && !defined) {
+                    for (const auto &define: defines) out += "#define " + define + " 1\n";
+                    out += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+                    defined = true;
+                }
+            }
+            return nextFile;
+        }
+    }
+
+    auto preprocess(const std::filesystem::path &path, const std::vector<std::string> &defines,
+                    SourceCache &sources) -> std::string {
+        std::string out;
+        std::set<std::string> included{path.lexically_normal().string()};
+        bool defined = false;
+        expand(path, defines, sources, included, 0, out, defined);
+        // without a #version line nothing has to come first, so the defines go on top
+        if (!defined && !defines.empty()) {
+            std::string head;
+            for (const auto &define: defines) head += "#define " + define + " 1\n";
+            out = head + "#line 1 0\n" + out;
+        }
+        return out;
+    }
+}
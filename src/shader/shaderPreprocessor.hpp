@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace shader {
+
+    // File contents by path, so includes shared by many stages and variants are read from disk once; embedded
+    // sources are copied out of the executable instead.
+    class SourceCache {
+    public:
+        // throws Shader::shaderFileLoadException when the file cannot be read
+        auto get(const std::filesystem::path &path) -> const std::string &;
+
+        auto clear() -> void;
+
+        static auto shared() -> SourceCache &;
+
+    private:
+        std::mutex mutex;
+        std::unordered_map<std::string, std::string> files;
+    };
+
+    // Expands #include "file" (relative to the including file, each file at most once) and injects
+    // "#define NAME 1" for every define right after the root file's #version line, or at the very top when it
+    // has none. #line directives keep compiler messages pointing at the original line numbers.
+    auto preprocess(const std::filesystem::path &path, const std::vector<std::string> &defines,
+                    SourceCache &sources = SourceCache::shared()) -> std::string;
+}
@@ -0,0 +1,197 @@
+#include <glad/glad.h>
+
+#include "asyncTextureLoader.hpp"
+#include "../render/glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace texture {
+
+    namespace {
+        // copy granularity between budget checks
+        constexpr std::size_t stagingChunk = 256 * 1024;
+
+        const unsigned char placeholderPixel[4] = {255, 0, 255, 255};
+    }
+
+    AsyncTextureLoader::AsyncTextureLoader(unsigned int workerCount) {
+        workerCount = std::max(workerCount, 1u);
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back([this] { decodeLoop(); });
+        }
+    }
+
+    AsyncTextureLoader::AsyncTextureLoader(job::JobSystem &jobs) : jobs(&jobs) {}
+
+    AsyncTextureLoader::~AsyncTextureLoader() {
+        if (jobs) jobs->wait(decodes);
+        {
+            std::lock_guard lock{requestMutex};
+            stopping = true;
+        }
+        requestReady.notify_all();
+        for (auto &worker: workers) worker.join();
+
+        decoded image;
+        while (decodedQueue.tryPop(image)) stbi_image_free(image.pixels);
+        auto &glState = render::GLState::current();
+        for (auto &stage: stagings) {
+            glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, stage.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            stbi_image_free(stage.image.pixels);
+            freePBOs.push_back(stage.pbo);
+        }
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!freePBOs.empty()) glDeleteBuffers((GLsizei) freePBOs.size(), freePBOs.data());
+        for (auto pbo: freePBOs) glState.deletedBuffer(pbo);
+    }
+
+    auto AsyncTextureLoader::enqueue(unsigned int textureID, const char *texturePath, GLint imageType) -> asyncTexture {
+        auto state = std::make_shared<asyncTextureState>();
+        state->textureID = textureID;
+        state->imageType = imageType;
+        state->path = texturePath;
+
+        // uploads go through unit 0; the tracker rebinds whatever texture2DLoader::use() needs there
+        render::GLState::current().editTexture(0, GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+
+        inFlight.fetch_add(1, std::memory_order_relaxed);
+        if (jobs) {
+            jobs->run([this, state] { decode(state); }, &decodes);
+            return asyncTexture{state};
+        }
+        {
+            std::lock_guard lock{requestMutex};
+            requests.push_back(state);
+        }
+        requestReady.notify_one();
+        return asyncTexture{state};
+    }
+
+    auto AsyncTextureLoader::decodeLoop() -> void {
+        while (true) {
+            std::shared_ptr<asyncTextureState> state;
+            {
+                std::unique_lock lock{requestMutex};
+                requestReady.wait(lock, [this] { return stopping || !requests.empty(); });
+                if (stopping) return;
+                state = std::move(requests.front());
+                requests.pop_front();
+            }
+            decode(std::move(state));
+        }
+    }
+
+    auto AsyncTextureLoader::decode(std::shared_ptr<asyncTextureState> state) -> void {
+        // ask stb for exactly the channel count the upload format expects
+        int components = state->imageType == GL_RGBA ? 4 : state->imageType == GL_RED ? 1 : 3;
+        auto *pixels = stbi_load(state->path.c_str(), &state->width, &state->height, &state->nrChannels,
+                                 components);
+        if (pixels) state->nrChannels = components;
+        decodedQueue.push(decoded{std::move(state), pixels});
+    }
+
+    auto AsyncTextureLoader::pump(std::chrono::microseconds budget) -> std::size_t {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        std::size_t uploaded = 0;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (stagings.empty()) {
+                decoded image;
+                if (!decodedQueue.tryPop(image)) break;
+                if (!image.pixels) {
+                    std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << image.state->path << std::endl;
+                    image.state->failed.store(true, std::memory_order_release);
+                    inFlight.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (!beginStaging(std::move(image))) {
+                    uploaded++;
+                    continue;
+                }
+            }
+
+            auto &stage = stagings.front();
+            auto chunk = std::min(stagingChunk, stage.size - stage.copied);
+            std::memcpy(stage.mapped + stage.copied, stage.image.pixels + stage.copied, chunk);
+            stage.copied += chunk;
+            if (stage.copied == stage.size) {
+                completeStaging(stage);
+                stagings.pop_front();
+                uploaded++;
+            }
+        }
+        render::GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return uploaded;
+    }
+
+    auto AsyncTextureLoader::finish() -> void {
+        // with no spare workers the decodes only run while somebody waits for them
+        if (jobs) jobs->wait(decodes);
+        while (pending() > 0) {
+            if (pump(std::chrono::milliseconds(100)) == 0) std::this_thread::yield();
+        }
+    }
+
+    auto AsyncTextureLoader::pending() const -> std::size_t {
+        return inFlight.load(std::memory_order_relaxed);
+    }
+
+    // the PBO stays mapped across pump() calls while the copy is spread over several frames; when it cannot be
+    // mapped the image is uploaded from client memory right away instead
+    auto AsyncTextureLoader::beginStaging(decoded &&image) -> bool {
+        staging stage{std::move(image)};
+        stage.size = (std::size_t) stage.image.state->width * stage.image.state->height * stage.image.state->nrChannels;
+        if (freePBOs.empty()) {
+            glGenBuffers(1, &stage.pbo);
+        } else {
+            stage.pbo = freePBOs.back();
+            freePBOs.pop_back();
+        }
+        auto &glState = render::GLState::current();
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, stage.pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) stage.size, nullptr, GL_STREAM_DRAW);
+        stage.mapped = (unsigned char *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) stage.size,
+                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!stage.mapped) {
+            std::cerr << "ERROR::TEXTURE::PBO_MAP_FAILED: " << stage.image.state->path << std::endl;
+            freePBOs.push_back(stage.pbo);
+            glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            upload(*stage.image.state, stage.image.pixels, stage.size);
+            stbi_image_free(stage.image.pixels);
+            return false;
+        }
+        stagings.push_back(std::move(stage));
+        return true;
+    }
+
+    auto AsyncTextureLoader::completeStaging(staging &stage) -> void {
+        render::GLState::current().bindBuffer(GL_PIXEL_UNPACK_BUFFER, stage.pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        stbi_image_free(stage.image.pixels);
+        stage.image.pixels = nullptr;
+        upload(*stage.image.state, nullptr, stage.size);
+        freePBOs.push_back(stage.pbo);
+    }
+
+    // pixels is an offset into the bound GL_PIXEL_UNPACK_BUFFER, or client memory with none bound
+    auto AsyncTextureLoader::upload(asyncTextureState &state, const unsigned char *pixels, std::size_t size)
+    -> void {
+        render::GLState::current().editTexture(0, GL_TEXTURE_2D, state.textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, state.imageType, state.width, state.height, 0, state.imageType,
+                     GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        PROFILE_COUNT(uploadedBytes, size);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        state.ready.store(true, std::memory_order_release);
+        inFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
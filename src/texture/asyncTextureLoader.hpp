@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../util/mpscQueue.hpp"
+#include "../job/jobSystem.hpp"
+
+namespace texture {
+
+    // Shared between the caller, the decode workers and the GL thread. The texture object exists from the
+    // start and shows a 1x1 placeholder until the decoded image has been uploaded into it.
+    struct asyncTextureState {
+        unsigned int textureID{};
+        GLint imageType{};
+        std::string path;
+        std::atomic<bool> ready{false};
+        std::atomic<bool> failed{false};
+        int width{}, height{}, nrChannels{};
+    };
+
+    class asyncTexture {
+    public:
+        asyncTexture() = default;
+
+        explicit asyncTexture(std::shared_ptr<asyncTextureState> state) : state(std::move(state)) {}
+
+        [[nodiscard]] auto id() const -> unsigned int { return state ? state->textureID : 0; }
+
+        [[nodiscard]] auto ready() const -> bool { return state && state->ready.load(std::memory_order_acquire); }
+
+        [[nodiscard]] auto failed() const -> bool { return state && state->failed.load(std::memory_order_acquire); }
+
+        // only meaningful once ready()
+        [[nodiscard]] auto width() const -> int { return state->width; }
+
+        [[nodiscard]] auto height() const -> int { return state->height; }
+
+        [[nodiscard]] auto nrChannels() const -> int { return state->nrChannels; }
+
+    private:
+        std::shared_ptr<asyncTextureState> state;
+    };
+
+    // Decodes images on a worker pool and uploads them on the GL thread through pixel buffer objects,
+    // spending at most the given budget per pump() so loading never hitches a frame.
+    class AsyncTextureLoader {
+    public:
+        explicit AsyncTextureLoader(unsigned int workers = std::thread::hardware_concurrency());
+
+        // decodes run as jobs instead of on threads of its own; jobs must outlive the loader
+        explicit AsyncTextureLoader(job::JobSystem &jobs);
+
+        AsyncTextureLoader(const AsyncTextureLoader &) = delete;
+
+        auto operator=(const AsyncTextureLoader &) -> AsyncTextureLoader & = delete;
+
+        ~AsyncTextureLoader();
+
+        // GL thread: fills the bound texture object with the placeholder and queues the decode
+        auto enqueue(unsigned int textureID, const char *texturePath, GLint imageType) -> asyncTexture;
+
+        // GL thread, once per frame: stages and uploads decoded images until the budget is spent
+        auto pump(std::chrono::microseconds budget) -> std::size_t;
+
+        // GL thread: blocks until every queued texture is uploaded or failed
+        auto finish() -> void;
+
+        [[nodiscard]] auto pending() const -> std::size_t;
+
+    private:
+        struct decoded {
+            std::shared_ptr<asyncTextureState> state;
+            unsigned char *pixels{};
+        };
+
+        struct staging {
+            decoded image;
+            unsigned int pbo{};
+            unsigned char *mapped{};
+            std::size_t size{}, copied{};
+        };
+
+        std::vector<std::thread> workers;
+        std::mutex requestMutex;
+        std::condition_variable requestReady;
+        std::deque<std::shared_ptr<asyncTextureState>> requests;
+        bool stopping = false;
+
+        job::JobSystem *jobs = nullptr;
+        job::counter decodes;
+
+        util::mpscQueue<decoded> decodedQueue;
+        std::atomic<std::size_t> inFlight{0};
+
+        // GL thread only
+        std::deque<staging> stagings;
+        std::vector<unsigned int> freePBOs;
+
+        auto decodeLoop() -> void;
+
+        auto decode(std::shared_ptr<asyncTextureState> state) -> void;
+
+        // false when the image went up without staging
+        auto beginStaging(decoded &&image) -> bool;
+
+        auto completeStaging(staging &stage) -> void;
+
+        auto upload(asyncTextureState &state, const unsigned char *pixels, std::size_t size) -> void;
+    };
+}
@@ -0,0 +1,344 @@
+#include "blockCompression.hpp"
+#include "../job/jobSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1 0x8DBB
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+
+namespace texture::bc {
+
+    namespace {
+        // one 4x4 block, every channel present: missing color channels read 0, missing alpha 255
+        using block = int[16][4];
+
+        auto gather(const unsigned char *pixels, int width, int height, int channels, int bx, int by, block &texels)
+        -> void {
+            for (int i = 0; i < 16; i++) {
+                int x = std::min(bx * 4 + i % 4, width - 1), y = std::min(by * 4 + i / 4, height - 1);
+                const auto *pixel = pixels + ((std::size_t) y * width + x) * channels;
+                for (int c = 0; c < 4; c++) texels[i][c] = c < channels ? pixel[c] : c == 3 ? 255 : 0;
+            }
+        }
+
+        // 5/6-bit channels widen by bit replication, as the hardware does
+        auto from565(std::uint16_t color, int *rgb) -> void {
+            int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+            rgb[0] = r << 3 | r >> 2;
+            rgb[1] = g << 2 | g >> 4;
+            rgb[2] = b << 3 | b >> 2;
+        }
+
+        auto to565(const float *rgb) -> std::uint16_t {
+            auto quantize = [](float value, int maximum) {
+                return std::clamp((int) std::lround(value * (float) maximum / 255.0f), 0, maximum);
+            };
+            return (std::uint16_t) (quantize(rgb[0], 31) << 11 | quantize(rgb[1], 63) << 5 | quantize(rgb[2], 31));
+        }
+
+        auto colorPalette(std::uint16_t color0, std::uint16_t color1, bool fourColor, int (&palette)[4][3]) -> void {
+            from565(color0, palette[0]);
+            from565(color1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                if (fourColor) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                } else {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+        }
+
+        struct colorCandidate {
+            std::uint16_t color0, color1;
+            std::uint32_t indices;
+            int error;
+        };
+
+        // quantizes a pair of endpoints and picks the nearest of the four palette entries for every texel
+        auto fitColors(const block &texels, const float *high, const float *low) -> colorCandidate {
+            auto color0 = to565(high), color1 = to565(low);
+            if (color0 < color1) std::swap(color0, color1);
+            int palette[4][3];
+            colorPalette(color0, color1, true, palette);
+            colorCandidate fit{color0, color1, 0, 0};
+            // equal endpoints would select the three-color mode, index 0 is the only safe one
+            int candidates = color0 == color1 ? 1 : 4;
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestDistance = 1 << 30;
+                for (int p = 0; p < candidates; p++) {
+                    int distance = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int d = texels[i][c] - palette[p][c];
+                        distance += d * d;
+                    }
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                fit.indices |= (std::uint32_t) best << (i * 2);
+                fit.error += bestDistance;
+            }
+            return fit;
+        }
+
+        // endpoints at the extremes of the principal axis, then one least-squares refit to the chosen indices;
+        // the refit is kept when it quantizes better. Always four-color mode, which BC3 requires.
+        auto encodeColor(const block &texels, unsigned char *out) -> void {
+            float mean[3] = {};
+            for (const auto &texel: texels) {
+                for (int c = 0; c < 3; c++) mean[c] += (float) texel[c] / 16.0f;
+            }
+            float covariance[6] = {};
+            for (const auto &texel: texels) {
+                float d[3] = {(float) texel[0] - mean[0], (float) texel[1] - mean[1], (float) texel[2] - mean[2]};
+                covariance[0] += d[0] * d[0];
+                covariance[1] += d[0] * d[1];
+                covariance[2] += d[0] * d[2];
+                covariance[3] += d[1] * d[1];
+                covariance[4] += d[1] * d[2];
+                covariance[5] += d[2] * d[2];
+            }
+            float axis[3] = {1, 1, 1};
+            for (int iteration = 0; iteration < 6; iteration++) {
+                float next[3] = {covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                                 covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                                 covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+                auto length = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+                if (length < 1e-6f) break;
+                for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+            }
+            float lowest = 1e30f, highest = -1e30f;
+            for (const auto &texel: texels) {
+                float t = 0;
+                for (int c = 0; c < 3; c++) t += ((float) texel[c] - mean[c]) * axis[c];
+                lowest = std::min(lowest, t);
+                highest = std::max(highest, t);
+            }
+            float high[3], low[3];
+            auto norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            for (int c = 0; c < 3; c++) {
+                high[c] = std::clamp(mean[c] + axis[c] * highest / norm, 0.0f, 255.0f);
+                low[c] = std::clamp(mean[c] + axis[c] * lowest / norm, 0.0f, 255.0f);
+            }
+            auto fit = fitColors(texels, high, low);
+
+            if (fit.color0 != fit.color1 && fit.error > 0) {
+                constexpr float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+                float aa = 0, bb = 0, ab = 0, ax[3] = {}, bx[3] = {};
+                for (int i = 0; i < 16; i++) {
+                    auto w = weights[(fit.indices >> (i * 2)) & 3];
+                    aa += w * w;
+                    bb += (1 - w) * (1 - w);
+                    ab += w * (1 - w);
+                    for (int c = 0; c < 3; c++) {
+                        ax[c] += w * (float) texels[i][c];
+                        bx[c] += (1 - w) * (float) texels[i][c];
+                    }
+                }
+                auto determinant = aa * bb - ab * ab;
+                if (std::abs(determinant) > 1e-6f) {
+                    for (int c = 0; c < 3; c++) {
+                        high[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+                        low[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+                    }
+                    auto refit = fitColors(texels, high, low);
+                    if (refit.error < fit.error) fit = refit;
+                }
+            }
+            std::memcpy(out, &fit.color0, 2);
+            std::memcpy(out + 2, &fit.color1, 2);
+            std::memcpy(out + 4, &fit.indices, 4);
+        }
+
+        // eight-value mode: max and min as endpoints, six interpolated steps, 3-bit indices
+        auto encodeSingle(const block &texels, int channel, unsigned char *out) -> void {
+            int high = 0, low = 255;
+            for (const auto &texel: texels) {
+                high = std::max(high, texel[channel]);
+                low = std::min(low, texel[channel]);
+            }
+            std::uint64_t indices = 0;
+            if (high != low) {
+                int palette[8] = {high, low};
+                for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * high + (k - 1) * low) / 7;
+                for (int i = 0; i < 16; i++) {
+                    int best = 0, bestDistance = 1 << 30;
+                    for (int p = 0; p < 8; p++) {
+                        int distance = std::abs(texels[i][channel] - palette[p]);
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = p;
+                        }
+                    }
+                    indices |= (std::uint64_t) best << (i * 3);
+                }
+            }
+            out[0] = (unsigned char) high;
+            out[1] = (unsigned char) low;
+            for (int b = 0; b < 6; b++) out[2 + b] = (unsigned char) (indices >> (b * 8));
+        }
+
+        auto decodeColor(const unsigned char *in, bool threeColorMode, int (&texels)[16][3]) -> void {
+            std::uint16_t color0, color1;
+            std::uint32_t indices;
+            std::memcpy(&color0, in, 2);
+            std::memcpy(&color1, in + 2, 2);
+            std::memcpy(&indices, in + 4, 4);
+            int palette[4][3];
+            colorPalette(color0, color1, !(threeColorMode && color0 <= color1), palette);
+            for (int i = 0; i < 16; i++) {
+                std::memcpy(texels[i], palette[(indices >> (i * 2)) & 3], sizeof(texels[i]));
+            }
+        }
+
+        auto decodeSingle(const unsigned char *in, int (&values)[16]) -> void {
+            int high = in[0], low = in[1], palette[8] = {high, low};
+            if (high > low) {
+                for (int k = 2; k < 8; k++) palette[k] = ((8 - k) * high + (k - 1) * low) / 7;
+            } else {
+                for (int k = 2; k < 6; k++) palette[k] = ((6 - k) * high + (k - 1) * low) / 5;
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+            std::uint64_t indices = 0;
+            for (int b = 0; b < 6; b++) indices |= (std::uint64_t) in[2 + b] << (b * 8);
+            for (int i = 0; i < 16; i++) values[i] = palette[(indices >> (i * 3)) & 7];
+        }
+    }
+
+    auto blockBytes(format blocks) -> std::size_t {
+        return blocks == format::bc1 || blocks == format::bc4 ? 8 : 16;
+    }
+
+    auto internalFormat(format blocks) -> GLenum {
+        switch (blocks) {
+            case format::bc1:
+                return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case format::bc3:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case format::bc4:
+                return GL_COMPRESSED_RED_RGTC1;
+            case format::bc5:
+                return GL_COMPRESSED_RG_RGTC2;
+        }
+        return GL_NONE;
+    }
+
+    auto name(format blocks) -> const char * {
+        switch (blocks) {
+            case format::bc1:
+                return "bc1";
+            case format::bc3:
+                return "bc3";
+            case format::bc4:
+                return "bc4";
+            case format::bc5:
+                return "bc5";
+        }
+        return "?";
+    }
+
+    auto supported(format blocks) -> bool {
+        static const bool s3tc = [] {
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count; i++) {
+                const auto *extension = (const char *) glGetStringi(GL_EXTENSIONS, (GLuint) i);
+                if (extension && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0) return true;
+            }
+            return false;
+        }();
+        return blocks == format::bc4 || blocks == format::bc5 || s3tc;
+    }
+
+    auto encode(format blocks, const unsigned char *pixels, int width, int height, int channels,
+                job::JobSystem *jobs) -> std::vector<unsigned char> {
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        auto stride = blockBytes(blocks);
+        std::vector<unsigned char> result((std::size_t) blocksX * blocksY * stride);
+        auto encodeRows = [&](std::size_t begin, std::size_t end) {
+            block texels;
+            for (auto by = begin; by < end; by++) {
+                auto *out = result.data() + by * blocksX * stride;
+                for (int bx = 0; bx < blocksX; bx++, out += stride) {
+                    gather(pixels, width, height, channels, bx, (int) by, texels);
+                    switch (blocks) {
+                        case format::bc1:
+                            encodeColor(texels, out);
+                            break;
+                        case format::bc3:
+                            encodeSingle(texels, 3, out);
+                            encodeColor(texels, out + 8);
+                            break;
+                        case format::bc4:
+                            encodeSingle(texels, 0, out);
+                            break;
+                        case format::bc5:
+                            encodeSingle(texels, 0, out);
+                            encodeSingle(texels, 1, out + 8);
+                            break;
+                    }
+                }
+            }
+        };
+        if (jobs) {
+            // rows of blocks are independent; a few per job keeps scheduling cost well below encode cost
+            jobs->parallelFor((std::size_t) blocksY, std::max<std::size_t>(1, 256 / (std::size_t) blocksX),
+                              encodeRows);
+        } else {
+            encodeRows(0, (std::size_t) blocksY);
+        }
+        return result;
+    }
+
+    auto decode(format blocks, const unsigned char *data, int width, int height, int channels)
+    -> std::vector<unsigned char> {
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        auto stride = blockBytes(blocks);
+        std::vector<unsigned char> pixels((std::size_t) width * height * channels);
+        for (int by = 0; by < blocksY; by++) {
+            for (int bx = 0; bx < blocksX; bx++, data += stride) {
+                int decoded[16][4];
+                for (auto &texel: decoded) texel[0] = texel[1] = texel[2] = 0, texel[3] = 255;
+                int color[16][3], first[16], second[16];
+                switch (blocks) {
+                    case format::bc1:
+                    case format::bc3:
+                        decodeColor(blocks == format::bc1 ? data : data + 8, blocks == format::bc1, color);
+                        for (int i = 0; i < 16; i++) std::memcpy(decoded[i], color[i], sizeof(color[i]));
+                        if (blocks == format::bc3) {
+                            decodeSingle(data, first);
+                            for (int i = 0; i < 16; i++) decoded[i][3] = first[i];
+                        }
+                        break;
+                    case format::bc4:
+                    case format::bc5:
+                        decodeSingle(data, first);
+                        for (int i = 0; i < 16; i++) decoded[i][0] = first[i];
+                        if (blocks == format::bc5) {
+                            decodeSingle(data + 8, second);
+                            for (int i = 0; i < 16; i++) decoded[i][1] = second[i];
+                        }
+                        break;
+                }
+                for (int i = 0; i < 16; i++) {
+                    int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                    if (x >= width || y >= height) continue;
+                    auto *pixel = pixels.data() + ((std::size_t) y * width + x) * channels;
+                    for (int c = 0; c < channels; c++) pixel[c] = (unsigned char) decoded[i][c];
+                }
+            }
+        }
+        return pixels;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace job {
+    class JobSystem;
+}
+
+// 4x4 block compression: BC1 (S3TC DXT1, RGB), BC3 (DXT5, RGBA), BC4 (RGTC1, one channel) and BC5 (RGTC2,
+// two channels). BC4/BC5 are core since GL 3.0; BC1/BC3 need GL_EXT_texture_compression_s3tc, which nearly
+// every desktop driver has but 3.3 does not guarantee. Edge blocks repeat the last row/column. The decoders
+// are references for quality checks (within rounding of what GL samples) and the fallback for contexts
+// without S3TC.
+namespace texture::bc {
+
+    enum class format {
+        bc1, bc3, bc4, bc5
+    };
+
+    [[nodiscard]] auto blockBytes(format blocks) -> std::size_t;
+
+    [[nodiscard]] auto internalFormat(format blocks) -> GLenum;
+
+    [[nodiscard]] auto name(format blocks) -> const char *;
+
+    // whether the current context samples the format; the extension list is read once
+    [[nodiscard]] auto supported(format blocks) -> bool;
+
+    // channels of the source read by a format: bc1 rgb, bc3 rgba (opaque when there is no alpha), bc4 the first,
+    // bc5 the first two; rows of blocks are encoded in parallel when jobs is given
+    auto encode(format blocks, const unsigned char *pixels, int width, int height, int channels,
+                job::JobSystem *jobs = nullptr) -> std::vector<unsigned char>;
+
+    // back to width x height pixels of channels bytes, missing channels 0 and alpha 255
+    auto decode(format blocks, const unsigned char *data, int width, int height, int channels)
+    -> std::vector<unsigned char>;
+}
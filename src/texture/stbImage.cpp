@@ -0,0 +1,4 @@
+// the single translation unit that owns the stb_image implementation
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stb_image.h>
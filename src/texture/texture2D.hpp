@@ -1,10 +1,18 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <algorithm>
 #include <vector>
 #include <map>
 
 #include "texture2D.hpp"
+#include "asyncTextureLoader.hpp"
+#include "textureContainer.hpp"
+#include "textureArray.hpp"
+#include "textureResidency.hpp"
+#include "../util/mappedFile.hpp"
+#include "../render/glState.hpp"
+#include "../profile/profiler.hpp"
 
 #include <stb_image.h>
 
@@ -29,10 +37,19 @@ namespace texture {
         struct texture2D {
             unsigned int textureID{};
             textureAttrib attr;
+            GLenum unit{GL_TEXTURE0};
+            GLenum target{GL_TEXTURE_2D};
+            // set for textures whose mips a ResidencyManager streams; use() requests them down to level
+            ResidencyManager *residency{};
+            residentHandle handle{};
+            int level{};
+            // set while an AsyncTextureLoader has the image; attr is filled in by the first use() after it lands
+            asyncTexture loading{};
 
             texture2D() = default;
 
-            texture2D(unsigned int textureId, const textureAttrib &attr) : textureID(textureId), attr(attr) {}
+            texture2D(unsigned int textureId, const textureAttrib &attr, GLenum unit, GLenum target = GL_TEXTURE_2D)
+                    : textureID(textureId), attr(attr), unit(unit), target(target) {}
 
         };
 
@@ -44,8 +61,33 @@ namespace texture {
         template<GLint s = GL_REPEAT, GLint t = GL_REPEAT, GLint minF = GL_LINEAR, GLint magF = GL_LINEAR>
         auto addTexture(const char *texturePath, GLenum textureUnit, GLint imageType = GL_RGB) -> texture2DLoader &;
 
+        // the texture is usable immediately and shows a placeholder until asyncLoader has uploaded it; see ready()
+        template<GLint s = GL_REPEAT, GLint t = GL_REPEAT, GLint minF = GL_LINEAR, GLint magF = GL_LINEAR>
+        auto addTexture(AsyncTextureLoader &asyncLoader, const char *texturePath, GLenum textureUnit,
+                        GLint imageType = GL_RGB) -> texture2DLoader &;
+
+        // pre-baked container from textureBake: all mip levels come from the file mapping, no decode
+        template<GLint s = GL_REPEAT, GLint t = GL_REPEAT, GLint minF = GL_LINEAR_MIPMAP_LINEAR, GLint magF = GL_LINEAR>
+        auto addBakedTexture(const char *containerPath, GLenum textureUnit) -> texture2DLoader &;
+
+        // baked container whose finer mips stream in while the material is used and leave under memory pressure
+        auto addResidentTexture(ResidencyManager &residency, const char *containerPath, GLenum textureUnit)
+        -> texture2DLoader &;
+
+        // one built array of packer on textureUnit; materials sharing it differ only in the per-instance layer
+        auto addTextureArray(const TextureArrayPacker &packer, std::uint32_t array, GLenum textureUnit)
+        -> texture2DLoader &;
+
+        // resident textures want the level that fills pixels screen pixels along their larger side, from the
+        // next use() on; until the first call they want full resolution
+        auto setScreenSize(float pixels) -> void;
+
         auto use() -> void;
 
+        // false while an asynchronously added texture is still being decoded or uploaded; a failed one counts
+        // as done and keeps the placeholder
+        [[nodiscard]] auto ready() const -> bool;
+
     private:
         std::vector<texture2D> textures;
         std::map<GLenum, bool> isUnitUnique;
@@ -56,6 +98,8 @@ namespace texture {
 
         static auto loadTexture(const char *texturePath, GLint imageType) -> textureAttrib;
 
+        static auto loadContainer(const char *containerPath) -> textureAttrib;
+
     };
 
 
@@ -77,25 +121,125 @@ namespace texture {
 
         unsigned int textureID;
         glGenTextures(1, &textureID);
-        glActiveTexture(textureUnit);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        render::GLState::current().editTexture(textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, textureID);
         setDefaultParams(s, t, minF, magF);
 
         attr = loadTexture(texturePath, imageType);
-        textures.emplace_back(texture2D(textureID, attr));
+        textures.emplace_back(texture2D(textureID, attr, textureUnit));
         return *this;
     }
 
+    template<GLint s, GLint t, GLint minF, GLint magF>
     auto texture2DLoader::
+    addTexture(AsyncTextureLoader &asyncLoader, const char *texturePath, GLenum textureUnit,
+               GLint imageType) -> texture2DLoader & {
+        if (this->isUnitUnique[textureUnit]) {
+            std::cerr << "ERROR::REPEAT_TEXTURE_UNIT" << std::endl;
+            throw repeatTextureUnitException();
+        }
+        isUnitUnique[textureUnit] = true;
+
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        render::GLState::current().editTexture(textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, textureID);
+        setDefaultParams(s, t, minF, magF);
+
+        auto loading = asyncLoader.enqueue(textureID, texturePath, imageType);
+        textures.emplace_back(texture2D(textureID, textureAttrib{}, textureUnit));
+        textures.back().loading = std::move(loading);
+        return *this;
+    }
+
+    template<GLint s, GLint t, GLint minF, GLint magF>
+    auto texture2DLoader::
+    addBakedTexture(const char *containerPath, GLenum textureUnit) -> texture2DLoader & {
+        if (this->isUnitUnique[textureUnit]) {
+            std::cerr << "ERROR::REPEAT_TEXTURE_UNIT" << std::endl;
+            throw repeatTextureUnitException();
+        }
+        isUnitUnique[textureUnit] = true;
+
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        render::GLState::current().editTexture(textureUnit - GL_TEXTURE0, GL_TEXTURE_2D, textureID);
+        setDefaultParams(s, t, minF, magF);
+
+        attr = loadContainer(containerPath);
+        textures.emplace_back(texture2D(textureID, attr, textureUnit));
+        return *this;
+    }
+
+    inline auto texture2DLoader::
+    addResidentTexture(ResidencyManager &residency, const char *containerPath, GLenum textureUnit)
+    -> texture2DLoader & {
+        if (this->isUnitUnique[textureUnit]) {
+            std::cerr << "ERROR::REPEAT_TEXTURE_UNIT" << std::endl;
+            throw repeatTextureUnitException();
+        }
+        isUnitUnique[textureUnit] = true;
+
+        try {
+            auto handle = residency.add(containerPath);
+            const auto &info = residency.info(handle);
+            attr = {(int) info.width, (int) info.height, (int) info.channels};
+            textures.emplace_back(texture2D(residency.texture(handle), attr, textureUnit));
+            textures.back().residency = &residency;
+            textures.back().handle = handle;
+        } catch (util::mappedFile::mapFileException &) {
+            std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << containerPath << std::endl;
+        } catch (container::containerFormatException &) {
+            std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << containerPath << std::endl;
+        }
+        return *this;
+    }
+
+    inline auto texture2DLoader::
+    addTextureArray(const TextureArrayPacker &packer, std::uint32_t array, GLenum textureUnit) -> texture2DLoader & {
+        if (this->isUnitUnique[textureUnit]) {
+            std::cerr << "ERROR::REPEAT_TEXTURE_UNIT" << std::endl;
+            throw repeatTextureUnitException();
+        }
+        isUnitUnique[textureUnit] = true;
+
+        attr = {packer.layerSize(array), packer.layerSize(array), 0};
+        textures.emplace_back(texture2D(packer.texture(array), attr, textureUnit, GL_TEXTURE_2D_ARRAY));
+        return *this;
+    }
+
+    inline auto texture2DLoader::
+    setScreenSize(float pixels) -> void {
+        for (auto &texture: textures) {
+            if (texture.residency) {
+                texture.level = ResidencyManager::levelFor(texture.attr.width, texture.attr.height, pixels);
+            }
+        }
+    }
+
+    // every texture goes to the unit it was added on, units that already hold it cost no GL call
+    inline auto texture2DLoader::
     use() -> void {
-        if (textures.empty()) return;
-        for (const auto &texture: textures) {
-            glBindTexture(GL_TEXTURE_2D, texture.textureID);
+        auto &state = render::GLState::current();
+        for (auto &texture: textures) {
+            if (texture.loading.ready()) {
+                texture.attr = {texture.loading.width(), texture.loading.height(), texture.loading.nrChannels()};
+                texture.loading = {};
+            } else if (texture.loading.failed()) {
+                texture.loading = {};
+            }
+            state.bindTexture(texture.unit - GL_TEXTURE0, texture.target, texture.textureID);
+            if (texture.residency) texture.residency->request(texture.handle, texture.level);
         }
     }
 
+    inline auto texture2DLoader::
+    ready() const -> bool {
+        return std::all_of(textures.begin(), textures.end(), [](const texture2D &texture) {
+            return !texture.loading.id() || texture.loading.ready() || texture.loading.failed();
+        });
+    }
+
 
-    auto texture2DLoader::
+    inline auto texture2DLoader::
     setDefaultParams(GLint s, GLint t, GLint minF, GLint magF) -> void {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, s);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t);
@@ -104,7 +248,7 @@ namespace texture {
 
     }
 
-    auto texture2DLoader::
+    inline auto texture2DLoader::
     loadTexture(const char *texturePath, GLint imageType) -> texture2DLoader::textureAttrib {
         int width = 0, height = 0, nrChannels = 0;
         unsigned char *data = stbi_load(texturePath,
@@ -113,10 +257,28 @@ namespace texture {
         if (data) {
             glTexImage2D(GL_TEXTURE_2D, 0, imageType, width, height, 0, imageType, GL_UNSIGNED_BYTE, data);
             glGenerateMipmap(GL_TEXTURE_2D);
+            PROFILE_COUNT(uploadedBytes, width * height * nrChannels);
         } else {
             std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << texturePath << std::endl;
         }
         stbi_image_free(data);
         return {width, height, nrChannels};
     }
+
+    inline auto texture2DLoader::
+    loadContainer(const char *containerPath) -> texture2DLoader::textureAttrib {
+        try {
+            util::mappedFile file{containerPath};
+            // every level is uploaded right away
+            file.willNeed(0, file.size());
+            container::view baked{file.data(), file.size()};
+            baked.upload();
+            const auto &info = baked.info();
+            return {(int) info.width, (int) info.height, (int) info.channels};
+        } catch (util::mappedFile::mapFileException &) {
+        } catch (container::containerFormatException &) {
+        }
+        std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << containerPath << std::endl;
+        return {0, 0, 0};
+    }
 }
\ No newline at end of file
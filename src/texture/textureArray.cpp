@@ -0,0 +1,191 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "textureArray.hpp"
+#include "../render/glState.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace texture {
+
+    namespace {
+        // box filter over 2x1, 1x2 or 2x2 blocks; an odd last row/column is dropped, a single one is kept
+        auto halve(const std::vector<unsigned char> &source, int width, int height, int channels, bool alongX,
+                   bool alongY) -> std::vector<unsigned char> {
+            int outWidth = alongX ? std::max(1, width / 2) : width;
+            int outHeight = alongY ? std::max(1, height / 2) : height;
+            std::vector<unsigned char> result((std::size_t) outWidth * outHeight * channels);
+            for (int y = 0; y < outHeight; y++) {
+                int y0 = alongY ? std::min(y * 2, height - 1) : y;
+                int y1 = alongY ? std::min(y * 2 + 1, height - 1) : y;
+                for (int x = 0; x < outWidth; x++) {
+                    int x0 = alongX ? std::min(x * 2, width - 1) : x;
+                    int x1 = alongX ? std::min(x * 2 + 1, width - 1) : x;
+                    for (int c = 0; c < channels; c++) {
+                        int sum = source[((std::size_t) y0 * width + x0) * channels + c] +
+                                  source[((std::size_t) y0 * width + x1) * channels + c] +
+                                  source[((std::size_t) y1 * width + x0) * channels + c] +
+                                  source[((std::size_t) y1 * width + x1) * channels + c];
+                        result[((std::size_t) y * outWidth + x) * channels + c] = (unsigned char) ((sum + 2) / 4);
+                    }
+                }
+            }
+            return result;
+        }
+
+        // halves while the source is more than twice the target, so the final bilinear pass never skips texels
+        auto resample(const unsigned char *pixels, int width, int height, int channels, int size, unsigned char *out)
+        -> void {
+            std::vector<unsigned char> reduced;
+            const auto *source = pixels;
+            while (width > 2 * size || height > 2 * size) {
+                bool alongX = width > 2 * size, alongY = height > 2 * size;
+                if (reduced.empty()) reduced.assign(pixels, pixels + (std::size_t) width * height * channels);
+                reduced = halve(reduced, width, height, channels, alongX, alongY);
+                source = reduced.data();
+                if (alongX) width /= 2;
+                if (alongY) height /= 2;
+            }
+            // taps and 8-bit weights per column are shared by every row
+            struct tap {
+                std::size_t first, second;
+                int weight;
+            };
+            auto taps = [](int source, int target, std::size_t step) {
+                std::vector<tap> result(target);
+                auto scale = (float) source / (float) target;
+                for (int i = 0; i < target; i++) {
+                    auto at = std::clamp(((float) i + 0.5f) * scale - 0.5f, 0.0f, (float) (source - 1));
+                    int first = (int) at;
+                    result[i] = {first * step, std::min(first + 1, source - 1) * step,
+                                 (int) std::lround((at - (float) first) * 256.0f)};
+                }
+                return result;
+            };
+            auto columns = taps(width, size, channels), rows = taps(height, size, (std::size_t) width * channels);
+            for (int y = 0; y < size; y++) {
+                const auto *top = source + rows[y].first, *bottom = source + rows[y].second;
+                auto fy = rows[y].weight;
+                auto *row = out + (std::size_t) y * size * channels;
+                for (int x = 0; x < size; x++) {
+                    auto [left, right, fx] = columns[x];
+                    for (int c = 0; c < channels; c++) {
+                        int upper = top[left + c] * (256 - fx) + top[right + c] * fx;
+                        int lower = bottom[left + c] * (256 - fx) + bottom[right + c] * fx;
+                        row[x * channels + c] = (unsigned char) ((upper * (256 - fy) + lower * fy + 32768) >> 16);
+                    }
+                }
+            }
+        }
+
+        auto formats(int channels) -> std::pair<GLint, GLenum> {
+            switch (channels) {
+                case 1:
+                    return {GL_R8, GL_RED};
+                case 2:
+                    return {GL_RG8, GL_RG};
+                case 3:
+                    return {GL_RGB8, GL_RGB};
+                default:
+                    return {GL_RGBA8, GL_RGBA};
+            }
+        }
+    }
+
+    TextureArrayPacker::TextureArrayPacker(int minSize, int maxSize)
+            : minSize(std::max(1, minSize)), maxSize(std::max(minSize, maxSize)) {}
+
+    TextureArrayPacker::~TextureArrayPacker() {
+        for (const auto &array: arrays) {
+            if (!array.texture) continue;
+            glDeleteTextures(1, &array.texture);
+            render::GLState::current().deletedTexture(array.texture);
+        }
+    }
+
+    auto TextureArrayPacker::add(const unsigned char *pixels, int width, int height, int channels) -> arraySlot {
+        if (built) {
+            std::cerr << "ERROR::TEXTURE_ARRAY_ALREADY_BUILT" << std::endl;
+            throw packerBuiltException();
+        }
+        channels = std::clamp(channels, 1, 4);
+        auto size = sizeClass(width, height);
+        auto found = std::find_if(arrays.begin(), arrays.end(), [&](const packedArray &array) {
+            return array.size == size && array.channels == channels && array.layers < maxLayers;
+        });
+        if (found == arrays.end()) found = arrays.insert(arrays.end(), packedArray{size, channels, 0, {}, 0});
+
+        auto layerBytes = (std::size_t) size * size * channels;
+        found->pixels.resize(layerBytes * (found->layers + 1));
+        auto *layer = found->pixels.data() + layerBytes * found->layers;
+        if (width == size && height == size) {
+            std::memcpy(layer, pixels, layerBytes);
+        } else {
+            resample(pixels, width, height, channels, size, layer);
+        }
+        return {(std::uint32_t) (found - arrays.begin()), found->layers++};
+    }
+
+    auto TextureArrayPacker::add(const char *path) -> arraySlot {
+        int width = 0, height = 0, channels = 0;
+        auto *pixels = stbi_load(path, &width, &height, &channels, 0);
+        if (!pixels) {
+            std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << path << std::endl;
+            const unsigned char white[4] = {255, 255, 255, 255};
+            return add(white, 1, 1, 4);
+        }
+        auto slot = add(pixels, width, height, channels);
+        stbi_image_free(pixels);
+        return slot;
+    }
+
+    auto TextureArrayPacker::build() -> void {
+        if (built) return;
+        built = true;
+        auto &state = render::GLState::current();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (auto &array: arrays) {
+            auto [internalFormat, format] = formats(array.channels);
+            glGenTextures(1, &array.texture);
+            state.editTexture(0, GL_TEXTURE_2D_ARRAY, array.texture);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            // one upload for all layers, the mip chain is filtered per layer by the driver
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, array.size, array.size, (GLsizei) array.layers, 0,
+                         format, GL_UNSIGNED_BYTE, array.pixels.data());
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            PROFILE_COUNT(uploadedBytes, array.pixels.size());
+            std::vector<unsigned char>{}.swap(array.pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    auto TextureArrayPacker::texture(std::uint32_t array) const -> GLuint {
+        return arrays[array].texture;
+    }
+
+    auto TextureArrayPacker::arrayCount() const -> std::size_t {
+        return arrays.size();
+    }
+
+    auto TextureArrayPacker::layerCount(std::uint32_t array) const -> std::uint32_t {
+        return arrays[array].layers;
+    }
+
+    auto TextureArrayPacker::layerSize(std::uint32_t array) const -> int {
+        return arrays[array].size;
+    }
+
+    auto TextureArrayPacker::sizeClass(int width, int height) const -> int {
+        int size = minSize;
+        while (size < std::max(width, height) && size < maxSize) size *= 2;
+        return std::min(size, maxSize);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+namespace texture {
+
+    // where a packed image ended up: a layer of one of the packer's arrays
+    struct arraySlot {
+        std::uint32_t array{};
+        std::uint32_t layer{};
+    };
+
+    // Packs images into GL_TEXTURE_2D_ARRAYs, one per channel count and power-of-two size class (the image's
+    // larger side rounded up, clamped to [minSize, maxSize]). Every image is resampled to a full layer of its
+    // class, so layers need no UV transform and no padding, mips never bleed between images, and any set of
+    // images in one array is drawn with one bind and the layer as a per-instance attribute.
+    class TextureArrayPacker {
+    public:
+        class packerBuiltException : std::exception {
+        };
+
+        // GL 3.3 guarantees 256 layers; a full class continues in a new array
+        static constexpr std::uint32_t maxLayers = 256;
+
+        explicit TextureArrayPacker(int minSize = 64, int maxSize = 1024);
+
+        TextureArrayPacker(const TextureArrayPacker &) = delete;
+
+        auto operator=(const TextureArrayPacker &) -> TextureArrayPacker & = delete;
+
+        ~TextureArrayPacker();
+
+        // CPU only: the image is resampled and kept until build(); channels 1 to 4
+        auto add(const unsigned char *pixels, int width, int height, int channels) -> arraySlot;
+
+        // decodes with stb_image; an image that fails to load gets a white layer
+        auto add(const char *path) -> arraySlot;
+
+        // creates every array with a full mip chain and releases the CPU copies; needs a current context
+        auto build() -> void;
+
+        [[nodiscard]] auto texture(std::uint32_t array) const -> GLuint;
+
+        [[nodiscard]] auto arrayCount() const -> std::size_t;
+
+        [[nodiscard]] auto layerCount(std::uint32_t array) const -> std::uint32_t;
+
+        [[nodiscard]] auto layerSize(std::uint32_t array) const -> int;
+
+        [[nodiscard]] auto sizeClass(int width, int height) const -> int;
+
+    private:
+        struct packedArray {
+            int size, channels;
+            std::uint32_t layers;
+            std::vector<unsigned char> pixels;
+            GLuint texture;
+        };
+
+        int minSize, maxSize;
+        bool built = false;
+        std::vector<packedArray> arrays{};
+    };
+}
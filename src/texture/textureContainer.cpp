@@ -0,0 +1,315 @@
+#include <glad/glad.h>
+
+#include "textureContainer.hpp"
+#include "../job/jobSystem.hpp"
+#include "../profile/profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXTURE_X86 1
+
+#include <immintrin.h>
+
+#endif
+
+namespace texture::container {
+
+    namespace {
+        auto alignUp(std::size_t value) -> std::size_t {
+            return (value + levelAlignment - 1) & ~(levelAlignment - 1);
+        }
+
+        auto blocksOf(const header &head) -> std::optional<bc::format> {
+            if (!(head.flags & compressed)) return std::nullopt;
+            for (auto blocks: {bc::format::bc1, bc::format::bc3, bc::format::bc4, bc::format::bc5}) {
+                if (bc::internalFormat(blocks) == head.internalFormat) return blocks;
+            }
+            return std::nullopt;
+        }
+
+        // bytes a level of the header's format needs: whole 4x4 blocks when compressed, tightly packed rows
+        // otherwise; 0 for formats the container cannot hold
+        auto levelBytes(const header &head, const level &entry) -> std::uint64_t {
+            std::uint64_t width = entry.width, height = entry.height;
+            if (head.flags & compressed) {
+                auto blocks = blocksOf(head);
+                return blocks ? ((width + 3) / 4) * ((height + 3) / 4) * bc::blockBytes(*blocks) : 0;
+            }
+            std::uint64_t channels = head.format == GL_RGBA || head.format == GL_BGRA ? 4
+                                     : head.format == GL_RGB || head.format == GL_BGR ? 3
+                                     : head.format == GL_RG ? 2 : head.format == GL_RED ? 1 : 0;
+            std::uint64_t channelBytes = head.type == GL_UNSIGNED_BYTE ? 1
+                                         : head.type == GL_UNSIGNED_SHORT || head.type == GL_HALF_FLOAT ? 2
+                                         : head.type == GL_FLOAT ? 4 : 0;
+            return width * height * channels * channelBytes;
+        }
+
+        // sRGB byte -> linear and linear (16-bit fixed point) -> nearest sRGB byte
+        struct srgbTables {
+            float decode[256];
+            unsigned char encode[65536];
+
+            srgbTables() {
+                for (int i = 0; i < 256; i++) {
+                    auto value = (float) i / 255.0f;
+                    decode[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+                }
+                for (int i = 0; i < 65536; i++) {
+                    auto value = (float) i / 65535.0f;
+                    value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                    encode[i] = (unsigned char) std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+                }
+            }
+        };
+
+        auto tables() -> const srgbTables & {
+            static const srgbTables instance;
+            return instance;
+        }
+
+        // level as four floats per pixel, whatever the channel count, so one texel is one SSE register
+        struct floatLevel {
+            int width, height;
+            std::vector<float> texels;
+        };
+
+        // rows [begin, end) of a parallelFor, or all of them at once without a job system
+        auto forRows(job::JobSystem *jobs, int rows, int width,
+                     const std::function<void(std::size_t, std::size_t)> &fn) -> void {
+            if (jobs) {
+                jobs->parallelFor((std::size_t) rows, std::max<std::size_t>(1, 16384 / (std::size_t) width), fn);
+            } else {
+                fn(0, (std::size_t) rows);
+            }
+        }
+
+        // 2x2 box filter, the odd last row/column of a level is dropped, a single one is kept
+        auto downsample(const floatLevel &source, job::JobSystem *jobs) -> floatLevel {
+            floatLevel result{std::max(1, source.width / 2), std::max(1, source.height / 2), {}};
+            result.texels.resize((std::size_t) result.width * result.height * 4);
+            forRows(jobs, result.height, result.width, [&](std::size_t begin, std::size_t end) {
+                for (auto y = (int) begin; y < (int) end; y++) {
+                    const auto *row0 = source.texels.data() + (std::size_t) std::min(y * 2, source.height - 1) *
+                                                              source.width * 4;
+                    const auto *row1 = source.texels.data() + (std::size_t) std::min(y * 2 + 1, source.height - 1) *
+                                                              source.width * 4;
+                    auto *out = result.texels.data() + (std::size_t) y * result.width * 4;
+                    for (int x = 0; x < result.width; x++, out += 4) {
+                        auto x0 = (std::size_t) std::min(x * 2, source.width - 1) * 4;
+                        auto x1 = (std::size_t) std::min(x * 2 + 1, source.width - 1) * 4;
+#ifdef TEXTURE_X86
+                        auto sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                              _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+                        _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                        for (int c = 0; c < 4; c++) {
+                            out[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+                        }
+#endif
+                    }
+                }
+            });
+            return result;
+        }
+
+        auto toFloat(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                     job::JobSystem *jobs) -> floatLevel {
+            floatLevel result{width, height, std::vector<float>((std::size_t) width * height * 4)};
+            const auto &decode = tables().decode;
+            int colorChannels = srgb && channels >= 3 ? 3 : 0;
+            forRows(jobs, height, width, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin * width; i < end * width; i++) {
+                    for (int c = 0; c < channels; c++) {
+                        auto value = pixels[i * channels + c];
+                        result.texels[i * 4 + c] = c < colorChannels ? decode[value] : (float) value / 255.0f;
+                    }
+                }
+            });
+            return result;
+        }
+
+        auto toBytes(const floatLevel &level, int channels, bool srgb, job::JobSystem *jobs)
+        -> std::vector<unsigned char> {
+            std::vector<unsigned char> result((std::size_t) level.width * level.height * channels);
+            const auto &encode = tables().encode;
+            int colorChannels = srgb && channels >= 3 ? 3 : 0;
+            forRows(jobs, level.height, level.width, [&](std::size_t begin, std::size_t end) {
+                for (auto i = begin * level.width; i < end * level.width; i++) {
+                    for (int c = 0; c < channels; c++) {
+                        auto value = std::clamp(level.texels[i * 4 + c], 0.0f, 1.0f);
+                        result[i * channels + c] = c < colorChannels
+                                                   ? encode[(int) (value * 65535.0f + 0.5f)]
+                                                   : (unsigned char) (value * 255.0f + 0.5f);
+                    }
+                }
+            });
+            return result;
+        }
+    }
+
+    auto defaultBlocks(int channels) -> bc::format {
+        switch (channels) {
+            case 1:
+                return bc::format::bc4;
+            case 2:
+                return bc::format::bc5;
+            case 3:
+                return bc::format::bc1;
+            default:
+                return bc::format::bc3;
+        }
+    }
+
+    auto mipChain(const unsigned char *pixels, int width, int height, int channels, bool srgb, job::JobSystem *jobs)
+    -> std::vector<std::vector<unsigned char>> {
+        std::vector<std::vector<unsigned char>> levels;
+        levels.emplace_back(pixels, pixels + (std::size_t) width * height * channels);
+        if (width == 1 && height == 1) return levels;
+        auto level = toFloat(pixels, width, height, channels, srgb, jobs);
+        while (level.width > 1 || level.height > 1) {
+            level = downsample(level, jobs);
+            levels.push_back(toBytes(level, channels, srgb, jobs));
+        }
+        return levels;
+    }
+
+    auto bake(const unsigned char *pixels, int width, int height, int channels, const bakeOptions &options)
+    -> std::vector<unsigned char> {
+        if (options.blocks) {
+            auto blocks = *options.blocks;
+            int required = blocks == bc::format::bc1 ? 3 : blocks == bc::format::bc3 ? 4 :
+                           blocks == bc::format::bc5 ? 2 : 1;
+            bool exact = blocks == bc::format::bc1 || blocks == bc::format::bc3;
+            if (exact ? channels != required : channels < required) {
+                std::cerr << "ERROR::BLOCK_FORMAT_CHANNEL_MISMATCH: " << bc::name(blocks) << " with " << channels
+                          << " channels" << std::endl;
+                throw containerFormatException();
+            }
+        }
+
+        std::vector<std::vector<unsigned char>> levelPixels;
+        if (options.mipmaps) {
+            levelPixels = mipChain(pixels, width, height, channels, options.srgb, options.jobs);
+        } else {
+            levelPixels.emplace_back(pixels, pixels + (std::size_t) width * height * channels);
+        }
+        std::vector<std::pair<int, int>> levelSizes{{width, height}};
+        while (levelSizes.size() < levelPixels.size()) {
+            auto [w, h] = levelSizes.back();
+            levelSizes.emplace_back(std::max(1, w / 2), std::max(1, h / 2));
+        }
+        if (options.blocks) {
+            for (std::size_t i = 0; i < levelPixels.size(); i++) {
+                levelPixels[i] = bc::encode(*options.blocks, levelPixels[i].data(), levelSizes[i].first,
+                                            levelSizes[i].second, channels, options.jobs);
+            }
+        }
+
+        header head{};
+        std::memcpy(head.magic, magic, sizeof(magic));
+        head.version = version;
+        head.width = width;
+        head.height = height;
+        head.channels = channels;
+        head.levelCount = (std::uint32_t) levelPixels.size();
+        head.format = channels == 4 ? GL_RGBA : channels == 3 ? GL_RGB : channels == 2 ? GL_RG : GL_RED;
+        head.type = GL_UNSIGNED_BYTE;
+        if (options.blocks) {
+            head.internalFormat = bc::internalFormat(*options.blocks);
+            head.flags |= compressed;
+        } else {
+            head.internalFormat = channels == 4 ? GL_RGBA8 : channels == 3 ? GL_RGB8 : channels == 2 ? GL_RG8 : GL_R8;
+        }
+
+        std::vector<level> table(levelPixels.size());
+        auto offset = alignUp(sizeof(header) + table.size() * sizeof(level));
+        for (std::size_t i = 0; i < table.size(); i++) {
+            table[i] = {offset, levelPixels[i].size(),
+                        (std::uint32_t) levelSizes[i].first, (std::uint32_t) levelSizes[i].second};
+            offset = alignUp(offset + levelPixels[i].size());
+        }
+
+        std::vector<unsigned char> file(offset);
+        std::memcpy(file.data(), &head, sizeof(header));
+        std::memcpy(file.data() + sizeof(header), table.data(), table.size() * sizeof(level));
+        for (std::size_t i = 0; i < table.size(); i++) {
+            std::memcpy(file.data() + table[i].offset, levelPixels[i].data(), levelPixels[i].size());
+        }
+        return file;
+    }
+
+
+    view::view(const unsigned char *data, std::size_t size) : base(data) {
+        head = (const header *) data;
+        levels = (const level *) (data + sizeof(header));
+        bool valid = size >= sizeof(header) && std::memcmp(head->magic, magic, sizeof(magic)) == 0 &&
+                     head->version == version && head->levelCount > 0 &&
+                     sizeof(header) + head->levelCount * sizeof(level) <= size;
+        for (std::uint32_t i = 0; valid && i < head->levelCount; i++) {
+            // a short level would have GL read past it, into the next level or off the end of the mapping
+            auto needed = container::levelBytes(*head, levels[i]);
+            valid = levels[i].offset % levelAlignment == 0 && levels[i].offset <= size &&
+                    levels[i].size <= size - levels[i].offset &&
+                    levels[i].width > 0 && levels[i].height > 0 && needed > 0 && levels[i].size >= needed;
+        }
+        if (!valid) {
+            std::cerr << "ERROR::INVALID_TEXTURE_CONTAINER" << std::endl;
+            throw containerFormatException();
+        }
+    }
+
+    auto view::upload() const -> void {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (std::uint32_t i = 0; i < head->levelCount; i++) uploadLevel(i);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) head->levelCount - 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    auto view::levelBytes(std::uint32_t index) const -> std::size_t {
+        return container::levelBytes(*head, levels[index]);
+    }
+
+    auto view::uploadLevel(std::uint32_t index) const -> void {
+        const auto &entry = levels[index];
+        auto bytes = levelBytes(index);
+        if (decodesBlocks()) {
+            auto pixels = bc::decode(*blocksOf(*head), levelData(index), (int) entry.width, (int) entry.height,
+                                     (int) head->channels);
+            glTexImage2D(GL_TEXTURE_2D, (GLint) index, decodedFormat(), (GLsizei) entry.width,
+                         (GLsizei) entry.height, 0, head->format, GL_UNSIGNED_BYTE, pixels.data());
+        } else if (head->flags & compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) index, head->internalFormat, (GLsizei) entry.width,
+                                   (GLsizei) entry.height, 0, (GLsizei) bytes, levelData(index));
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, (GLint) index, (GLint) head->internalFormat, (GLsizei) entry.width,
+                         (GLsizei) entry.height, 0, head->format, head->type, levelData(index));
+        }
+        PROFILE_COUNT(uploadedBytes, bytes);
+    }
+
+    auto view::releaseLevel(std::uint32_t index) const -> void {
+        if (decodesBlocks()) {
+            glTexImage2D(GL_TEXTURE_2D, (GLint) index, decodedFormat(), 0, 0, 0, head->format, GL_UNSIGNED_BYTE,
+                         nullptr);
+        } else if (head->flags & compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) index, head->internalFormat, 0, 0, 0, 0, nullptr);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, (GLint) index, (GLint) head->internalFormat, 0, 0, 0, head->format,
+                         head->type, nullptr);
+        }
+    }
+
+    auto view::decodesBlocks() const -> bool {
+        auto blocks = blocksOf(*head);
+        return blocks && !bc::supported(*blocks);
+    }
+
+    auto view::decodedFormat() const -> GLint {
+        return head->channels == 4 ? GL_RGBA8 : head->channels == 3 ? GL_RGB8 : head->channels == 2 ? GL_RG8 : GL_R8;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "blockCompression.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <vector>
+
+namespace texture::container {
+
+    // Pre-baked texture file: header, level table, then every mip level tightly packed (rows without
+    // padding) and each level starting on a levelAlignment boundary, so levels upload straight from a mapping.
+    constexpr char magic[4] = {'L', 'T', 'E', 'X'};
+    constexpr std::uint32_t version = 1;
+    constexpr std::size_t levelAlignment = 16;
+
+    enum flags : std::uint32_t {
+        compressed = 1u << 0
+    };
+
+    struct header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t internalFormat;
+        std::uint32_t format;           // pixel transfer format, unused when compressed
+        std::uint32_t type;
+        std::uint32_t width, height;
+        std::uint32_t channels;
+        std::uint32_t levelCount;
+        std::uint32_t flags;
+        std::uint32_t reserved[6];
+    };
+    static_assert(sizeof(header) == 64);
+
+    struct level {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t width, height;
+    };
+    static_assert(sizeof(level) == 24);
+
+    class containerFormatException : std::exception {
+    };
+
+    struct bakeOptions {
+        bool mipmaps = true;
+        // block compressed levels: bc1 needs 3 channels, bc3 4, bc4 at least 1 and bc5 at least 2
+        std::optional<bc::format> blocks{};
+        // rgb holds sRGB encoded color, so mips are filtered in linear light; alpha and 1-2 channel data are linear
+        bool srgb = true;
+        // rows of each mip level and of each block encode run in parallel when set
+        job::JobSystem *jobs = nullptr;
+    };
+
+    // the block format that keeps every channel: bc1, bc3, bc4 or bc5 for 3, 4, 1 or 2 channels
+    [[nodiscard]] auto defaultBlocks(int channels) -> bc::format;
+
+    // every level is filtered from the full-precision previous one, never from quantized bytes; level 0 is the
+    // source itself. Needs no GL context.
+    auto mipChain(const unsigned char *pixels, int width, int height, int channels, bool srgb,
+                  job::JobSystem *jobs = nullptr) -> std::vector<std::vector<unsigned char>>;
+
+    auto bake(const unsigned char *pixels, int width, int height, int channels, const bakeOptions &options)
+    -> std::vector<unsigned char>;
+
+    // Validated view over container bytes, typically a util::mappedFile; never copies level data.
+    class view {
+    public:
+        view(const unsigned char *data, std::size_t size);
+
+        [[nodiscard]] auto info() const -> const header & { return *head; }
+
+        [[nodiscard]] auto levelInfo(std::uint32_t index) const -> const level & { return levels[index]; }
+
+        // what GL gets for a level: the size its format and dimensions imply, without any padding the file stores
+        [[nodiscard]] auto levelBytes(std::uint32_t index) const -> std::size_t;
+
+        [[nodiscard]] auto levelData(std::uint32_t index) const -> const unsigned char * {
+            return base + levels[index].offset;
+        }
+
+        // glTexImage2D / glCompressedTexImage2D for every level into the bound GL_TEXTURE_2D
+        auto upload() const -> void;
+
+        // one level into the bound GL_TEXTURE_2D, GL_UNPACK_ALIGNMENT 1; blocks the context cannot sample are
+        // decoded and uploaded as bytes
+        auto uploadLevel(std::uint32_t index) const -> void;
+
+        // respecifies a level empty, in the internal format uploadLevel gives it, to free its storage
+        auto releaseLevel(std::uint32_t index) const -> void;
+
+    private:
+        const unsigned char *base;
+        const header *head;
+        const level *levels;
+
+        // compressed levels the context cannot sample; needs a current context
+        [[nodiscard]] auto decodesBlocks() const -> bool;
+
+        [[nodiscard]] auto decodedFormat() const -> GLint;
+    };
+}
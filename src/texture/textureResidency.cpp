@@ -0,0 +1,170 @@
+#include <glad/glad.h>
+
+#include "textureResidency.hpp"
+#include "../render/glState.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace texture {
+
+    ResidencyManager::entry::entry(util::mappedFile &&mapping)
+            : file(std::move(mapping)), baked(file.data(), file.size()) {}
+
+    ResidencyManager::ResidencyManager(std::size_t budget, int tailSize) : tailSize(std::max(1, tailSize)) {
+        stats.budget = budget;
+    }
+
+    ResidencyManager::~ResidencyManager() {
+        for (const auto &texture: entries) {
+            glDeleteTextures(1, &texture.texture);
+            render::GLState::current().deletedTexture(texture.texture);
+        }
+    }
+
+    auto ResidencyManager::add(const char *containerPath) -> residentHandle {
+        entries.emplace_back(util::mappedFile{containerPath});
+        auto &texture = entries.back();
+        const auto &info = texture.baked.info();
+        auto levels = (int) info.levelCount;
+        texture.tailLevel = levels - 1;
+        for (int level = 0; level < levels; level++) {
+            const auto &size = texture.baked.levelInfo((std::uint32_t) level);
+            if ((int) std::max(size.width, size.height) <= tailSize) {
+                texture.tailLevel = level;
+                break;
+            }
+        }
+        // only the tail is uploaded now, and the levels are stored finest first, so the tail ends the file
+        auto tailOffset = (std::size_t) texture.baked.levelInfo((std::uint32_t) texture.tailLevel).offset;
+        texture.file.willNeed(tailOffset, texture.file.size() - tailOffset);
+
+        glGenTextures(1, &texture.texture);
+        render::GLState::current().editTexture(0, GL_TEXTURE_2D, texture.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = levels - 1; level >= texture.tailLevel; level--) upload(texture, level);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        texture.residentLevel = texture.wantedLevel = texture.tailLevel;
+        texture.lastUsed = frame;
+        setBaseLevel(texture);
+        return (residentHandle) (entries.size() - 1);
+    }
+
+    auto ResidencyManager::texture(residentHandle handle) const -> GLuint {
+        return entries[handle].texture;
+    }
+
+    auto ResidencyManager::info(residentHandle handle) const -> const container::header & {
+        return entries[handle].baked.info();
+    }
+
+    auto ResidencyManager::update(std::size_t uploadBudget) -> void {
+        std::vector<residentHandle> wanted;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].wantedLevel < entries[i].residentLevel) wanted.push_back((residentHandle) i);
+        }
+        // what was on screen most recently streams in first
+        std::stable_sort(wanted.begin(), wanted.end(), [this](residentHandle a, residentHandle b) {
+            return entries[a].lastUsed > entries[b].lastUsed;
+        });
+
+        // one level per texture per pass, so every wanted texture sharpens a step before any takes two
+        std::size_t spent = 0;
+        bool uploaded = false, progress = !wanted.empty();
+        if (progress) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        while (progress) {
+            progress = false;
+            for (auto handle: wanted) {
+                auto &texture = entries[handle];
+                if (texture.wantedLevel >= texture.residentLevel) continue;
+                auto bytes = texture.levelBytes(texture.residentLevel - 1);
+                if (uploaded && spent + bytes > uploadBudget) continue;
+                // room comes only from textures not requested this frame; otherwise the texture stays as it is
+                if (stats.resident - evictableBytes() + bytes > stats.budget) {
+                    texture.wantedLevel = texture.residentLevel;
+                    continue;
+                }
+                while (stats.resident + bytes > stats.budget && evictOne(true)) {}
+                render::GLState::current().editTexture(0, GL_TEXTURE_2D, texture.texture);
+                upload(texture, --texture.residentLevel);
+                setBaseLevel(texture);
+                spent += bytes;
+                uploaded = progress = true;
+            }
+        }
+        if (!wanted.empty()) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        while (stats.resident > stats.budget && evictOne(false)) {}
+        for (auto &texture: entries) texture.wantedLevel = texture.tailLevel;
+        frame++;
+    }
+
+    auto ResidencyManager::setBudget(std::size_t bytes) -> void {
+        stats.budget = bytes;
+    }
+
+    auto ResidencyManager::residentLevel(residentHandle handle) const -> int {
+        return entries[handle].residentLevel;
+    }
+
+    auto ResidencyManager::levelFor(int width, int height, float pixels) -> int {
+        auto texels = (float) std::max(width, height);
+        if (pixels <= 0) return (int) std::log2(std::max(texels, 1.0f));
+        return std::max(0, (int) std::floor(std::log2(texels / pixels)));
+    }
+
+    auto ResidencyManager::upload(entry &texture, int level) -> void {
+        auto bytes = texture.levelBytes(level);
+        texture.baked.uploadLevel((std::uint32_t) level);
+        stats.resident += bytes;
+        stats.peak = std::max(stats.peak, stats.resident);
+        stats.uploads++;
+        stats.uploadedBytes += bytes;
+    }
+
+    // the base level moves past the level first, then the level is respecified empty to release its storage
+    auto ResidencyManager::evict(entry &texture) -> void {
+        auto level = texture.residentLevel++;
+        setBaseLevel(texture);
+        texture.baked.releaseLevel((std::uint32_t) level);
+        auto bytes = texture.levelBytes(level);
+        stats.resident -= bytes;
+        stats.evictions++;
+        stats.evictedBytes += bytes;
+    }
+
+    auto ResidencyManager::evictableBytes() const -> std::size_t {
+        std::size_t bytes = 0;
+        for (const auto &texture: entries) {
+            if (texture.lastUsed == frame) continue;
+            for (int level = texture.residentLevel; level < texture.tailLevel; level++) {
+                bytes += texture.levelBytes(level);
+            }
+        }
+        return bytes;
+    }
+
+    auto ResidencyManager::evictOne(bool spareCurrentFrame) -> bool {
+        entry *oldest = nullptr;
+        for (auto &texture: entries) {
+            if (texture.residentLevel >= texture.tailLevel || (spareCurrentFrame && texture.lastUsed == frame)) {
+                continue;
+            }
+            if (!oldest || texture.lastUsed < oldest->lastUsed) oldest = &texture;
+        }
+        if (!oldest) return false;
+        evict(*oldest);
+        return true;
+    }
+
+    auto ResidencyManager::setBaseLevel(const entry &texture) -> void {
+        render::GLState::current().editTexture(0, GL_TEXTURE_2D, texture.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentLevel);
+    }
+}
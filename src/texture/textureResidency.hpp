@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "textureContainer.hpp"
+#include "../util/mappedFile.hpp"
+
+namespace texture {
+
+    using residentHandle = std::uint32_t;
+
+    // bytes are GPU level sizes as the containers' formats imply; uploads and evictions count mip levels
+    struct residencyStatistics {
+        std::size_t budget{}, resident{}, peak{};
+        std::uint64_t requests{}, hits{};
+        std::uint64_t uploads{}, evictions{};
+        std::uint64_t uploadedBytes{}, evictedBytes{};
+
+        [[nodiscard]] auto hitRate() const -> double {
+            return requests ? (double) hits / (double) requests : 1.0;
+        }
+    };
+
+    // Decides which mip levels of baked containers (textureBake) live in GPU memory. Every texture keeps its
+    // tail, the levels of at most tailSize texels a side; finer levels stream in from the file mapping for
+    // textures that were requested and fit the budget, and over budget the finest level of the least recently
+    // requested texture goes first. GL_TEXTURE_BASE_LEVEL hides what is not resident, so texture ids stay valid.
+    class ResidencyManager {
+    public:
+        explicit ResidencyManager(std::size_t budget, int tailSize = 64);
+
+        ResidencyManager(const ResidencyManager &) = delete;
+
+        auto operator=(const ResidencyManager &) -> ResidencyManager & = delete;
+
+        ~ResidencyManager();
+
+        // maps the container and uploads its tail into a new texture object; needs a current context.
+        // Throws util::mappedFile::mapFileException or container::containerFormatException.
+        auto add(const char *containerPath) -> residentHandle;
+
+        [[nodiscard]] auto texture(residentHandle handle) const -> GLuint;
+
+        [[nodiscard]] auto info(residentHandle handle) const -> const container::header &;
+
+        // usage feedback: the finest level wanted this frame, 0 for full resolution; inline for the bind path
+        auto request(residentHandle handle, int level = 0) -> void {
+            auto &texture = entries[handle];
+            level = std::clamp(level, 0, texture.tailLevel);
+            stats.requests++;
+            if (texture.residentLevel <= level) stats.hits++;
+            texture.wantedLevel = std::min(texture.wantedLevel, level);
+            texture.lastUsed = frame;
+        }
+
+        // GL thread, once per frame: streams in requested levels, coarse to fine, until uploadBudget bytes are
+        // spent (always at least one level), evicting as needed, then ends the frame
+        auto update(std::size_t uploadBudget = 4u << 20) -> void;
+
+        // a lower budget takes effect at the next update
+        auto setBudget(std::size_t bytes) -> void;
+
+        [[nodiscard]] auto residentLevel(residentHandle handle) const -> int;
+
+        [[nodiscard]] auto statistics() const -> const residencyStatistics & { return stats; }
+
+        // the finest level worth keeping for a texture spanning pixels screen pixels along its larger side
+        [[nodiscard]] static auto levelFor(int width, int height, float pixels) -> int;
+
+    private:
+        struct entry {
+            util::mappedFile file;
+            container::view baked;
+            GLuint texture{};
+            int tailLevel{}, residentLevel{}, wantedLevel{};
+            std::uint64_t lastUsed{};
+
+            explicit entry(util::mappedFile &&mapping);
+
+            [[nodiscard]] auto levelBytes(int level) const -> std::size_t {
+                return baked.levelBytes((std::uint32_t) level);
+            }
+        };
+
+        std::vector<entry> entries{};
+        int tailSize;
+        std::uint64_t frame = 1;
+        residencyStatistics stats{};
+
+        auto upload(entry &texture, int level) -> void;
+
+        auto evict(entry &texture) -> void;
+
+        // above-tail bytes of textures not requested this frame
+        [[nodiscard]] auto evictableBytes() const -> std::size_t;
+
+        // the finest level of the least recently used texture that has one above its tail
+        auto evictOne(bool spareCurrentFrame) -> bool;
+
+        auto setBaseLevel(const entry &texture) -> void;
+    };
+}
@@ -0,0 +1,331 @@
+#include "transformSoA.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRANSFORM_X86 1
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TRANSFORM_TARGET_AVX2
+#else
+#define TRANSFORM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace transform {
+
+    auto transformSoA::add(const glm::vec3 &position, const glm::vec3 &axis, float angle, float spin) -> std::size_t {
+        auto index = size();
+        positionX.push_back(position.x);
+        positionY.push_back(position.y);
+        positionZ.push_back(position.z);
+        axisX.push_back(0);
+        axisY.push_back(0);
+        axisZ.push_back(0);
+        this->angle.push_back(0);
+        this->spin.push_back(0);
+        setRotation(index, axis, angle, spin);
+        return index;
+    }
+
+    auto transformSoA::setPosition(std::size_t index, const glm::vec3 &position) -> void {
+        positionX[index] = position.x;
+        positionY[index] = position.y;
+        positionZ[index] = position.z;
+    }
+
+    auto transformSoA::setRotation(std::size_t index, const glm::vec3 &axis, float angle, float spin) -> void {
+        auto normalized = glm::normalize(axis);
+        axisX[index] = normalized.x;
+        axisY[index] = normalized.y;
+        axisZ[index] = normalized.z;
+        this->angle[index] = angle;
+        this->spin[index] = spin;
+    }
+
+    auto transformSoA::reserve(std::size_t count) -> void {
+        for (auto *array: {&positionX, &positionY, &positionZ, &axisX, &axisY, &axisZ, &angle, &spin}) {
+            array->reserve(count);
+        }
+    }
+
+    auto transformSoA::clear() -> void {
+        for (auto *array: {&positionX, &positionY, &positionZ, &axisX, &axisY, &axisZ, &angle, &spin}) {
+            array->clear();
+        }
+    }
+
+    auto transformSoA::size() const -> std::size_t {
+        return positionX.size();
+    }
+
+
+    namespace {
+        // Cody-Waite split of pi/2 and minimax polynomials on [-pi/4, pi/4] (Cephes sinf/cosf)
+        constexpr float twoOverPi = 0.636619772367581343f;
+        constexpr float halfPi1 = 1.5703125f;
+        constexpr float halfPi2 = 4.837512969970703125e-4f;
+        constexpr float halfPi3 = 7.54978995489188216e-8f;
+        constexpr float sin1 = -1.6666654611e-1f, sin2 = 8.3321608736e-3f, sin3 = -1.9515295891e-4f;
+        constexpr float cos1 = 4.166664568298827e-2f, cos2 = -1.388731625493765e-3f, cos3 = 2.443315711809948e-5f;
+
+        auto scalarKernel(const transformSoA &o, float time, const float *vp, float *out, std::size_t stride,
+                          std::size_t begin, std::size_t end) -> void {
+            for (auto i = begin; i < end; i++) {
+                float theta = o.angle[i] + o.spin[i] * time;
+                float s = std::sin(theta), c = std::cos(theta), t = 1 - c;
+                float x = o.axisX[i], y = o.axisY[i], z = o.axisZ[i];
+                float model[16] = {
+                        t * x * x + c, t * x * y + s * z, t * x * z - s * y, 0,
+                        t * y * x - s * z, t * y * y + c, t * y * z + s * x, 0,
+                        t * z * x + s * y, t * z * y - s * x, t * z * z + c, 0,
+                        o.positionX[i], o.positionY[i], o.positionZ[i], 1
+                };
+                auto *record = out + i * stride;
+                if (!vp) {
+                    for (int e = 0; e < 16; e++) record[e] = model[e];
+                    continue;
+                }
+                for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                        float sum = 0;
+                        for (int k = 0; k < 4; k++) sum += vp[k * 4 + row] * model[column * 4 + k];
+                        record[column * 4 + row] = sum;
+                    }
+                }
+            }
+        }
+
+#ifdef TRANSFORM_X86
+
+        auto sincos4(__m128 x, __m128 &sinOut, __m128 &cosOut) -> void {
+            auto quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(twoOverPi)));
+            auto j = _mm_cvtepi32_ps(quadrant);
+            x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(halfPi1)));
+            x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(halfPi2)));
+            x = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(halfPi3)));
+            auto x2 = _mm_mul_ps(x, x);
+
+            auto s = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(sin3)), _mm_set1_ps(sin2));
+            s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(sin1));
+            s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+            auto c = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(cos3)), _mm_set1_ps(cos2));
+            c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(cos1));
+            c = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, x2), x2), _mm_sub_ps(_mm_set1_ps(1), _mm_mul_ps(x2, _mm_set1_ps(0.5f))));
+
+            // odd quadrants swap sin and cos, bit 1 of the quadrant (of quadrant + 1 for cos) flips the sign
+            auto swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+            auto sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+            auto cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+                    _mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+            sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+            cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+        }
+
+        // transposes one column of 4 objects and stores it into their records
+        auto store4(float *out, std::size_t stride, int column, __m128 a, __m128 b, __m128 c, __m128 d) -> void {
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(out + column * 4, a);
+            _mm_storeu_ps(out + stride + column * 4, b);
+            _mm_storeu_ps(out + 2 * stride + column * 4, c);
+            _mm_storeu_ps(out + 3 * stride + column * 4, d);
+        }
+
+        auto sseKernel(const transformSoA &o, float time, const float *vp, float *out, std::size_t stride,
+                       std::size_t begin, std::size_t end) -> std::size_t {
+            auto zero = _mm_setzero_ps(), one = _mm_set1_ps(1);
+            auto i = begin;
+            for (; i + 4 <= end; i += 4) {
+                auto theta = _mm_add_ps(_mm_loadu_ps(&o.angle[i]),
+                                        _mm_mul_ps(_mm_loadu_ps(&o.spin[i]), _mm_set1_ps(time)));
+                __m128 s, c;
+                sincos4(theta, s, c);
+                auto t = _mm_sub_ps(one, c);
+                auto x = _mm_loadu_ps(&o.axisX[i]), y = _mm_loadu_ps(&o.axisY[i]), z = _mm_loadu_ps(&o.axisZ[i]);
+                auto tx = _mm_mul_ps(t, x), ty = _mm_mul_ps(t, y), tz = _mm_mul_ps(t, z);
+                auto sx = _mm_mul_ps(s, x), sy = _mm_mul_ps(s, y), sz = _mm_mul_ps(s, z);
+
+                __m128 m[4][4] = {
+                        {_mm_add_ps(_mm_mul_ps(tx, x), c),  _mm_add_ps(_mm_mul_ps(tx, y), sz), _mm_sub_ps(_mm_mul_ps(tx, z), sy), zero},
+                        {_mm_sub_ps(_mm_mul_ps(ty, x), sz), _mm_add_ps(_mm_mul_ps(ty, y), c),  _mm_add_ps(_mm_mul_ps(ty, z), sx), zero},
+                        {_mm_add_ps(_mm_mul_ps(tz, x), sy), _mm_sub_ps(_mm_mul_ps(tz, y), sx), _mm_add_ps(_mm_mul_ps(tz, z), c),  zero},
+                        {_mm_loadu_ps(&o.positionX[i]),     _mm_loadu_ps(&o.positionY[i]),     _mm_loadu_ps(&o.positionZ[i]),     one}
+                };
+
+                auto *record = out + i * stride;
+                for (int column = 0; column < 4; column++) {
+                    if (!vp) {
+                        store4(record, stride, column, m[column][0], m[column][1], m[column][2], m[column][3]);
+                        continue;
+                    }
+                    __m128 r[4];
+                    for (int row = 0; row < 4; row++) {
+                        // w of the rotation columns is zero, so only the translation column needs the 4th term
+                        auto sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(vp[row]), m[column][0]),
+                                                         _mm_mul_ps(_mm_set1_ps(vp[4 + row]), m[column][1])),
+                                              _mm_mul_ps(_mm_set1_ps(vp[8 + row]), m[column][2]));
+                        r[row] = column == 3 ? _mm_add_ps(sum, _mm_set1_ps(vp[12 + row])) : sum;
+                    }
+                    store4(record, stride, column, r[0], r[1], r[2], r[3]);
+                }
+            }
+            return i;
+        }
+
+        TRANSFORM_TARGET_AVX2
+        auto sincos8(__m256 x, __m256 &sinOut, __m256 &cosOut) -> void {
+            auto quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(twoOverPi)));
+            auto j = _mm256_cvtepi32_ps(quadrant);
+            x = _mm256_fnmadd_ps(j, _mm256_set1_ps(halfPi1), x);
+            x = _mm256_fnmadd_ps(j, _mm256_set1_ps(halfPi2), x);
+            x = _mm256_fnmadd_ps(j, _mm256_set1_ps(halfPi3), x);
+            auto x2 = _mm256_mul_ps(x, x);
+
+            auto s = _mm256_fmadd_ps(x2, _mm256_set1_ps(sin3), _mm256_set1_ps(sin2));
+            s = _mm256_fmadd_ps(s, x2, _mm256_set1_ps(sin1));
+            s = _mm256_fmadd_ps(_mm256_mul_ps(s, x2), x, x);
+            auto c = _mm256_fmadd_ps(x2, _mm256_set1_ps(cos3), _mm256_set1_ps(cos2));
+            c = _mm256_fmadd_ps(c, x2, _mm256_set1_ps(cos1));
+            c = _mm256_fmadd_ps(_mm256_mul_ps(c, x2), x2, _mm256_fnmadd_ps(x2, _mm256_set1_ps(0.5f), _mm256_set1_ps(1)));
+
+            auto swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)),
+                                                               _mm256_set1_epi32(1)));
+            auto sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+            auto cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+                    _mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+            sinOut = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+            cosOut = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+        }
+
+        // 4x4 transpose inside each 128-bit half: the low half holds objects 0-3, the high half objects 4-7
+        TRANSFORM_TARGET_AVX2
+        auto store8(float *out, std::size_t stride, int column, __m256 a, __m256 b, __m256 c, __m256 d) -> void {
+            auto t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpackhi_ps(a, b);
+            auto t2 = _mm256_unpacklo_ps(c, d), t3 = _mm256_unpackhi_ps(c, d);
+            __m256 r[4] = {
+                    _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                    _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                    _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2))
+            };
+            for (int k = 0; k < 4; k++) {
+                _mm_storeu_ps(out + k * stride + column * 4, _mm256_castps256_ps128(r[k]));
+                _mm_storeu_ps(out + (k + 4) * stride + column * 4, _mm256_extractf128_ps(r[k], 1));
+            }
+        }
+
+        TRANSFORM_TARGET_AVX2
+        auto avx2Kernel(const transformSoA &o, float time, const float *vp, float *out, std::size_t stride,
+                        std::size_t begin, std::size_t end) -> std::size_t {
+            auto zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1);
+            auto i = begin;
+            for (; i + 8 <= end; i += 8) {
+                auto theta = _mm256_fmadd_ps(_mm256_loadu_ps(&o.spin[i]), _mm256_set1_ps(time),
+                                             _mm256_loadu_ps(&o.angle[i]));
+                __m256 s, c;
+                sincos8(theta, s, c);
+                auto t = _mm256_sub_ps(one, c);
+                auto x = _mm256_loadu_ps(&o.axisX[i]), y = _mm256_loadu_ps(&o.axisY[i]), z = _mm256_loadu_ps(&o.axisZ[i]);
+                auto tx = _mm256_mul_ps(t, x), ty = _mm256_mul_ps(t, y), tz = _mm256_mul_ps(t, z);
+                auto sx = _mm256_mul_ps(s, x), sy = _mm256_mul_ps(s, y), sz = _mm256_mul_ps(s, z);
+
+                __m256 m[4][4] = {
+                        {_mm256_fmadd_ps(tx, x, c),  _mm256_fmadd_ps(tx, y, sz), _mm256_fmsub_ps(tx, z, sy), zero},
+                        {_mm256_fmsub_ps(ty, x, sz), _mm256_fmadd_ps(ty, y, c),  _mm256_fmadd_ps(ty, z, sx), zero},
+                        {_mm256_fmadd_ps(tz, x, sy), _mm256_fmsub_ps(tz, y, sx), _mm256_fmadd_ps(tz, z, c),  zero},
+                        {_mm256_loadu_ps(&o.positionX[i]), _mm256_loadu_ps(&o.positionY[i]), _mm256_loadu_ps(&o.positionZ[i]), one}
+                };
+
+                auto *record = out + i * stride;
+                for (int column = 0; column < 4; column++) {
+                    if (!vp) {
+                        store8(record, stride, column, m[column][0], m[column][1], m[column][2], m[column][3]);
+                        continue;
+                    }
+                    __m256 r[4];
+                    for (int row = 0; row < 4; row++) {
+                        auto sum = _mm256_mul_ps(_mm256_set1_ps(vp[row]), m[column][0]);
+                        sum = _mm256_fmadd_ps(_mm256_set1_ps(vp[4 + row]), m[column][1], sum);
+                        sum = _mm256_fmadd_ps(_mm256_set1_ps(vp[8 + row]), m[column][2], sum);
+                        r[row] = column == 3 ? _mm256_add_ps(sum, _mm256_set1_ps(vp[12 + row])) : sum;
+                    }
+                    store8(record, stride, column, r[0], r[1], r[2], r[3]);
+                }
+            }
+            return i;
+        }
+
+#endif
+
+        kernel selected = detectKernel();
+
+        auto dispatch(const transformSoA &objects, float time, const float *vp, float *out, std::size_t stride,
+                      std::size_t begin, std::size_t end) -> void {
+            auto done = begin;
+#ifdef TRANSFORM_X86
+            if (selected == kernel::avx2) done = avx2Kernel(objects, time, vp, out, stride, begin, end);
+            else if (selected == kernel::sse) done = sseKernel(objects, time, vp, out, stride, begin, end);
+#endif
+            scalarKernel(objects, time, vp, out, stride, done, end);
+        }
+    }
+
+    auto detectKernel() -> kernel {
+#ifdef TRANSFORM_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+        bool fma = info[2] & (1 << 12);
+        __cpuidex(info, 7, 0);
+        if (osAvx && fma && (info[1] & (1 << 5))) return kernel::avx2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return kernel::avx2;
+#endif
+        return kernel::sse;
+#else
+        return kernel::scalar;
+#endif
+    }
+
+    auto activeKernel() -> kernel {
+        return selected;
+    }
+
+    auto setKernel(kernel requested) -> kernel {
+        auto best = detectKernel();
+        selected = (int) requested <= (int) best ? requested : best;
+        return selected;
+    }
+
+    auto kernelName(kernel k) -> const char * {
+        switch (k) {
+            case kernel::avx2:
+                return "avx2";
+            case kernel::sse:
+                return "sse";
+            default:
+                return "scalar";
+        }
+    }
+
+    auto computeModels(const transformSoA &objects, float time, float *out, std::size_t stride) -> void {
+        dispatch(objects, time, nullptr, out, stride, 0, objects.size());
+    }
+
+    auto computeModels(const transformSoA &objects, std::size_t begin, std::size_t end, float time, float *out,
+                       std::size_t stride) -> void {
+        dispatch(objects, time, nullptr, out, stride, begin, std::min(end, objects.size()));
+    }
+
+    auto computeMVP(const transformSoA &objects, float time, const glm::mat4 &viewProjection,
+                    float *out, std::size_t stride) -> void {
+        dispatch(objects, time, glm::value_ptr(viewProjection), out, stride, 0, objects.size());
+    }
+}
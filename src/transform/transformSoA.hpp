@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace transform {
+
+    // Objects placed as translate(position) * rotate(angle + spin * time, axis), one array per component
+    // so the kernels can load 4/8 objects per instruction. Axes are normalized on insertion.
+    struct transformSoA {
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> axisX, axisY, axisZ;
+        std::vector<float> angle, spin;
+
+        auto add(const glm::vec3 &position, const glm::vec3 &axis, float angle, float spin = 0) -> std::size_t;
+
+        auto setPosition(std::size_t index, const glm::vec3 &position) -> void;
+
+        auto setRotation(std::size_t index, const glm::vec3 &axis, float angle, float spin = 0) -> void;
+
+        auto reserve(std::size_t count) -> void;
+
+        auto clear() -> void;
+
+        [[nodiscard]] auto size() const -> std::size_t;
+    };
+
+    enum class kernel {
+        scalar,
+        sse,
+        avx2
+    };
+
+    // best kernel the running CPU supports, detected once
+    [[nodiscard]] auto detectKernel() -> kernel;
+
+    [[nodiscard]] auto activeKernel() -> kernel;
+
+    // falls back to the detected kernel when the requested one is not supported
+    auto setKernel(kernel requested) -> kernel;
+
+    [[nodiscard]] auto kernelName(kernel k) -> const char *;
+
+    // Writes one column-major mat4 per object, object i at out + i * stride floats, so the result can
+    // go straight into an instance buffer record.
+    auto computeModels(const transformSoA &objects, float time, float *out, std::size_t stride = 16) -> void;
+
+    // objects [begin, end) only, still written at out + i * stride, so ranges can run as separate jobs
+    auto computeModels(const transformSoA &objects, std::size_t begin, std::size_t end, float time, float *out,
+                       std::size_t stride = 16) -> void;
+
+    auto computeMVP(const transformSoA &objects, float time, const glm::mat4 &viewProjection,
+                    float *out, std::size_t stride = 16) -> void;
+}
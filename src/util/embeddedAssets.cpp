@@ -0,0 +1,43 @@
+#include "embeddedAssets.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace util::embedded {
+
+    namespace {
+#ifdef LEARNOPENGL_EMBED_ASSETS
+        // generated at build time: `blob`, every file 64-byte aligned, and `table`, sorted by path
+#include "embeddedAssets.inc"
+
+        static_assert(std::is_sorted(std::begin(table), std::end(table), [](const asset &a, const asset &b) {
+            return a.path < b.path;
+        }), "embedded asset table must be sorted by path");
+
+        constexpr std::span<const asset> all{table};
+#else
+        constexpr std::span<const asset> all{};
+#endif
+
+        constexpr std::string_view staticRoot = STATIC_FILE_PATH"/", bakedRoot = BAKED_FILE_PATH"/";
+    }
+
+    auto assets() -> std::span<const asset> {
+        return all;
+    }
+
+    auto find(std::string_view path) -> const asset * {
+        if (all.empty()) return nullptr;
+        std::string key{path};
+        std::replace(key.begin(), key.end(), '\\', '/');
+        // a build tree inside the source tree puts baked paths under both roots; the longer one is the right one
+        auto baked = key.starts_with(bakedRoot), source = key.starts_with(staticRoot);
+        if (baked && (!source || bakedRoot.size() > staticRoot.size())) key.replace(0, bakedRoot.size(), "baked/");
+        else if (source) key.erase(0, staticRoot.size());
+
+        auto found = std::lower_bound(all.begin(), all.end(), key, [](const asset &entry, const std::string &k) {
+            return entry.path < k;
+        });
+        return found != all.end() && found->path == key ? &*found : nullptr;
+    }
+}
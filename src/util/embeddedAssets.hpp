@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace util::embedded {
+
+    // One file packed into the executable by tools/assetPack, keyed by its path below the source tree
+    // ("static/shader/...") or below the build tree ("baked/texture2D/...").
+    struct asset {
+        std::string_view path;
+        const unsigned char *data;
+        std::size_t size;
+    };
+
+    // Every embedded asset sorted by path; empty unless built with EMBED_ASSETS.
+    auto assets() -> std::span<const asset>;
+
+    // Accepts paths under STATIC_FILE_PATH and BAKED_FILE_PATH as the loaders build them, or the keys
+    // themselves; null when the file is not embedded and has to come from disk.
+    auto find(std::string_view path) -> const asset *;
+}
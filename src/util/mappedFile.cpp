@@ -0,0 +1,106 @@
+#include "mappedFile.hpp"
+#include "embeddedAssets.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+    mappedFile::mappedFile(const char *path) {
+        // packed into the executable: already in memory, nothing to open or unmap
+        if (const auto *asset = embedded::find(path)) {
+            mapping = asset->data;
+            length = asset->size;
+            embeddedAsset = true;
+            return;
+        }
+        map(path);
+    }
+
+#ifdef _WIN32
+
+    auto mappedFile::map(const char *path) -> void {
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER fileSize{};
+        if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+            std::cerr << "ERROR::COULD_NOT_MAP_FILE: " << path << std::endl;
+            throw mapFileException();
+        }
+        length = (std::size_t) fileSize.QuadPart;
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle) mapping = (const unsigned char *) MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (!mapping) {
+            if (mappingHandle) CloseHandle(mappingHandle);
+            CloseHandle(fileHandle);
+            std::cerr << "ERROR::COULD_NOT_MAP_FILE: " << path << std::endl;
+            throw mapFileException();
+        }
+    }
+
+    auto mappedFile::willNeed(std::size_t, std::size_t) const -> void {}
+
+    mappedFile::~mappedFile() {
+        if (!mapping || embeddedAsset) return;
+        UnmapViewOfFile(mapping);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+    }
+
+#else
+
+    auto mappedFile::map(const char *path) -> void {
+        int fd = open(path, O_RDONLY);
+        struct stat status{};
+        if (fd < 0 || fstat(fd, &status) != 0 || status.st_size == 0) {
+            if (fd >= 0) close(fd);
+            std::cerr << "ERROR::COULD_NOT_MAP_FILE: " << path << std::endl;
+            throw mapFileException();
+        }
+        length = (std::size_t) status.st_size;
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        close(fd);
+        if (address == MAP_FAILED) {
+            std::cerr << "ERROR::COULD_NOT_MAP_FILE: " << path << std::endl;
+            throw mapFileException();
+        }
+        mapping = (const unsigned char *) address;
+    }
+
+    auto mappedFile::willNeed(std::size_t offset, std::size_t bytes) const -> void {
+        if (!mapping || embeddedAsset || offset >= length) return;
+        bytes = std::min(bytes, length - offset);
+        // madvise wants a page-aligned start; the mapping itself is page aligned
+        auto page = (std::size_t) sysconf(_SC_PAGESIZE);
+        auto begin = offset / page * page;
+        madvise((void *) (mapping + begin), offset + bytes - begin, MADV_WILLNEED);
+    }
+
+    mappedFile::~mappedFile() {
+        if (mapping && !embeddedAsset) munmap((void *) mapping, length);
+    }
+
+#endif
+
+    mappedFile::mappedFile(mappedFile &&other) noexcept
+            : mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0)),
+              embeddedAsset(other.embeddedAsset)
+#ifdef _WIN32
+            , fileHandle(std::exchange(other.fileHandle, nullptr)),
+              mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+    {}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+
+namespace util {
+
+    // Read-only memory mapping of a whole file; the mapping lives as long as the object. Files embedded in the
+    // executable (see embeddedAssets.hpp) are served from there without touching the disk.
+    class mappedFile {
+    public:
+        class mapFileException : std::exception {
+        };
+
+        explicit mappedFile(const char *path);
+
+        mappedFile(const mappedFile &) = delete;
+
+        auto operator=(const mappedFile &) -> mappedFile & = delete;
+
+        mappedFile(mappedFile &&other) noexcept;
+
+        ~mappedFile();
+
+        [[nodiscard]] auto data() const -> const unsigned char * { return mapping; }
+
+        [[nodiscard]] auto size() const -> std::size_t { return length; }
+
+        // hints that [offset, offset + bytes) is read soon, so the OS starts reading it ahead; nothing is
+        // read ahead unless asked, since callers often touch only part of a file
+        auto willNeed(std::size_t offset, std::size_t bytes) const -> void;
+
+    private:
+        const unsigned char *mapping{};
+        std::size_t length{};
+        bool embeddedAsset = false;
+#ifdef _WIN32
+        void *fileHandle{};
+        void *mappingHandle{};
+#endif
+
+        auto map(const char *path) -> void;
+    };
+}
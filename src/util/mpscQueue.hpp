@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace util {
+
+    // Unbounded multi-producer / single-consumer queue (Vyukov). push never blocks and never takes a lock;
+    // tryPop may only be called from one thread at a time.
+    template<typename T>
+    class mpscQueue {
+    public:
+        mpscQueue() : head(&stub), tail(&stub) {}
+
+        mpscQueue(const mpscQueue &) = delete;
+
+        auto operator=(const mpscQueue &) -> mpscQueue & = delete;
+
+        ~mpscQueue() {
+            T discard;
+            while (tryPop(discard)) {}
+            if (tail != &stub) delete tail;
+        }
+
+        auto push(T value) -> void {
+            auto *item = new node{std::move(value)};
+            auto *previous = head.exchange(item, std::memory_order_acq_rel);
+            previous->next.store(item, std::memory_order_release);
+        }
+
+        auto tryPop(T &out) -> bool {
+            auto *next = tail->next.load(std::memory_order_acquire);
+            if (!next) return false;
+            out = std::move(next->value);
+            // the popped node becomes the new stub, its value has been moved out
+            if (tail != &stub) delete tail;
+            tail = next;
+            return true;
+        }
+
+    private:
+        struct node {
+            T value{};
+            std::atomic<node *> next{nullptr};
+        };
+
+        node stub{};
+        std::atomic<node *> head;
+        node *tail;
+    };
+}
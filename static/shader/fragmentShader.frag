@@ -4,6 +4,16 @@ out vec4 FragColor;
 in vec3 ourColor;
 in vec2 TexCoord;
 
+#ifdef TEXTURE_ARRAY
+// every instance picks its own layer of one packed array
+uniform sampler2DArray textureLayers;
+flat in float Layer;
+
+void main()
+{
+    FragColor = texture(textureLayers, vec3(TexCoord, Layer));
+}
+#else
 // texture samplers
 uniform sampler2D texture1;
 uniform sampler2D texture2;
@@ -11,4 +21,5 @@ uniform sampler2D texture2;
 void main()
 {
     FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
-}
\ No newline at end of file
+}
+#endif
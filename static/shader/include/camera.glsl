@@ -0,0 +1,7 @@
+// filled once per frame by scene::Camera through render::UniformBlock, binding shader::blockBinding::camera
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
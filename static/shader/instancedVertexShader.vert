@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec2 aTexCoord;
+// per-instance, advanced once per instance via glVertexAttribDivisor
+layout (location = 3) in mat4 aModel;
+#ifdef TEXTURE_ARRAY
+layout (location = 7) in float aLayer;
+
+flat out float Layer;
+#endif
+
+out vec3 ourColor;
+out vec2 TexCoord;
+
+#include "include/camera.glsl"
+
+void main()
+{
+    gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
+    ourColor = aColor;
+    TexCoord = aTexCoord;
+#ifdef TEXTURE_ARRAY
+    Layer = aLayer;
+#endif
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+constexpr const char *usage = "usage: assetPack <output .inc> <key>=<file>...";
+
+// every asset starts on a cache line, as a mapped file starts on a page
+constexpr std::size_t alignment = 64;
+
+// Writes the blob and the table util/embeddedAssets.cpp includes when built with EMBED_ASSETS.
+auto main(int argc, char **argv) -> int {
+    struct entry {
+        std::string key, file;
+        std::size_t offset{}, size{};
+    };
+    if (argc < 3) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    std::vector<entry> entries;
+    for (int i = 2; i < argc; i++) {
+        std::string argument{argv[i]};
+        auto separator = argument.find('=');
+        if (separator == std::string::npos || separator == 0) {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+        entries.push_back({argument.substr(0, separator), argument.substr(separator + 1)});
+    }
+    std::sort(entries.begin(), entries.end(), [](const entry &a, const entry &b) { return a.key < b.key; });
+
+    std::vector<unsigned char> blob;
+    for (auto &e: entries) {
+        std::ifstream in{e.file, std::ios::binary};
+        if (!in) {
+            std::cerr << "ERROR::COULD_NOT_OPEN_FILE: " << e.file << std::endl;
+            return 1;
+        }
+        e.offset = blob.size();
+        blob.insert(blob.end(), std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+        e.size = blob.size() - e.offset;
+        blob.resize((blob.size() + alignment - 1) / alignment * alignment, 0);
+    }
+
+    std::string text = "// generated by assetPack, do not edit\n";
+    text += "alignas(" + std::to_string(alignment) + ") constexpr unsigned char blob[] = {";
+    constexpr char digits[] = "0123456789abcdef";
+    for (std::size_t i = 0; i < blob.size(); i++) {
+        text += i % 16 == 0 ? "\n        " : " ";
+        text += "0x";
+        text += digits[blob[i] >> 4];
+        text += digits[blob[i] & 15];
+        text += ',';
+    }
+    text += "\n};\n\nconstexpr asset table[] = {\n";
+    for (const auto &e: entries) {
+        text += "        {\"" + e.key + "\", blob + " + std::to_string(e.offset) + ", " + std::to_string(e.size);
+        text += "},\n";
+    }
+    text += "};\n";
+
+    auto output = std::filesystem::path{argv[1]};
+    if (output.has_parent_path()) std::filesystem::create_directories(output.parent_path());
+    std::ofstream out{output, std::ios::binary};
+    out << text;
+    if (!out) {
+        std::cerr << "ERROR::COULD_NOT_WRITE_FILE: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::cout << entries.size() << " assets, " << blob.size() / 1024 << " KiB -> " << argv[1] << std::endl;
+    return 0;
+}
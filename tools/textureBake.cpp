@@ -0,0 +1,66 @@
+#include <stb_image.h>
+
+#include "../src/job/jobSystem.hpp"
+#include "../src/texture/textureContainer.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+constexpr const char *usage =
+        "usage: textureBake [--compress | --bc1 | --bc3 | --bc4 | --bc5] [--linear] [--no-mipmaps] "
+        "<source image> <output container>";
+
+// --compress picks the block format from the image's channel count; --linear for data that is not sRGB color
+auto main(int argc, char **argv) -> int {
+    texture::container::bakeOptions options;
+    bool compress = false;
+    const char *input = nullptr, *output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--compress") == 0) compress = true;
+        else if (std::strcmp(argv[i], "--bc1") == 0) options.blocks = texture::bc::format::bc1;
+        else if (std::strcmp(argv[i], "--bc3") == 0) options.blocks = texture::bc::format::bc3;
+        else if (std::strcmp(argv[i], "--bc4") == 0) options.blocks = texture::bc::format::bc4;
+        else if (std::strcmp(argv[i], "--bc5") == 0) options.blocks = texture::bc::format::bc5;
+        else if (std::strcmp(argv[i], "--linear") == 0) options.srgb = false;
+        else if (std::strcmp(argv[i], "--no-mipmaps") == 0) options.mipmaps = false;
+        else if (!input) input = argv[i];
+        else output = argv[i];
+    }
+    if (!input || !output) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    int width = 0, height = 0, channels = 0;
+    auto *pixels = stbi_load(input, &width, &height, &channels, 0);
+    if (!pixels) {
+        std::cerr << "ERROR::FAILED_TO_LOAD_TEXTURE: " << input << std::endl;
+        return 1;
+    }
+    if (compress && !options.blocks) options.blocks = texture::container::defaultBlocks(channels);
+    job::JobSystem jobs;
+    options.jobs = &jobs;
+    std::vector<unsigned char> file;
+    try {
+        file = texture::container::bake(pixels, width, height, channels, options);
+    } catch (texture::container::containerFormatException &) {
+        stbi_image_free(pixels);
+        return 1;
+    }
+    stbi_image_free(pixels);
+
+    auto parent = std::filesystem::path{output}.parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+    std::ofstream out{output, std::ios::binary};
+    out.write((const char *) file.data(), (std::streamsize) file.size());
+    if (!out) {
+        std::cerr << "ERROR::COULD_NOT_WRITE_FILE: " << output << std::endl;
+        return 1;
+    }
+    std::cout << input << " -> " << output << " (" << width << "x" << height << ", "
+              << (options.blocks ? texture::bc::name(*options.blocks) : "uncompressed") << ", " << file.size()
+              << " bytes)" << std::endl;
+    return 0;
+}